@@ -0,0 +1,1269 @@
+/* Copyright 2013-2016, Mansour Moufid <mansourmoufid@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Benchmarks
+ *
+ * Usage:  bench-udsp [-r reps] [-m max] [name ...]
+ *
+ * Time the public functions of the library over a sweep of lengths:
+ * the powers of two and some lengths with factors of 3 and 5, from 16
+ * up to UDSP_FFT_SIZE_MAX, or max, and the largest prime below each
+ * power of four up to a quarter of that, past which a transform of
+ * prime length, with its direct pass of that order, takes seconds.  A
+ * function of a state stops short of UDSP_FFT_SIZE_MAX, and one of
+ * two signals at half the maximum.  Only the functions whose names
+ * start with one of the given names are timed.
+ *
+ * Each function is called until a sample takes BENCH_SAMPLE_NS, which
+ * also warms the caches, BENCH_WARMUP more samples are discarded, and
+ * the time per call of reps samples, BENCH_REPS by default, or fewer
+ * if they would take more than BENCH_CASE_NS in all, is reported in
+ * JSON on the standard output, with the number of samples:  the
+ * median, the 99th percentile and the minimum in nanoseconds, the
+ * throughput in millions of input samples per second, and an estimate
+ * of GFLOPS, from the nominal count of 2.5 n log2(n) operations for a
+ * real FFT of length n and 5 n log2(n) for a complex one, or null
+ * where no such count is meaningful.  The inputs stay in the caches
+ * between calls.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "nclock.h"
+#include "udsp.h"
+
+#define BENCH_SAMPLE_NS 50000
+#define BENCH_CALLS_MAX (1 << 20)
+#define BENCH_WARMUP 3
+#define BENCH_CASE_NS UINT64_C(1000000000)
+#define BENCH_REPS 101
+
+/* Batches, channels and streams are this many lengths long */
+#define BENCH_HOWMANY 8
+#define BENCH_BINS 8
+#define BENCH_LAGS 64
+#define BENCH_BLOCK 1024
+#define BENCH_SCALE (1.f / 32768.f)
+
+/* Time the function with each FFT method */
+#define BENCH_METHOD 1
+/* The function takes two signals of the swept length, or a batch */
+#define BENCH_HALF 2
+/* The function takes a state, shorter than UDSP_FFT_SIZE_MAX */
+#define BENCH_STATE 4
+
+struct bench_data {
+    int method;
+    size_t n;
+    udsp_state_t *st;
+    udsp_state_d_t *sd;
+    udsp_plan_t *plan;
+    udsp_pool_t *pool;
+    void *obj;
+    float *x;
+    float *y;
+    float *r;
+    udsp_complex_t *u;
+    udsp_complex_t *v;
+    double *xd;
+    double *yd;
+    double *rd;
+    udsp_complex_d_t *ud;
+    int16_t *s16;
+    int32_t *s32;
+    size_t bins[BENCH_BINS];
+    float fbins[BENCH_BINS];
+};
+
+struct bench {
+    const char *name;
+    int flags;
+    void (*setup)(struct bench_data *);
+    void (*run)(struct bench_data *);
+    void (*teardown)(struct bench_data *);
+    size_t (*samples)(const size_t);
+    double (*flops)(const size_t);
+};
+
+static void *
+xmalloc(const size_t size)
+{
+    void *p;
+    p = calloc(1, size);
+    if (p == NULL) {
+        fprintf(stderr, "bench-udsp: out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+/*
+ * Input samples and operations per call
+ */
+
+static size_t
+samples_n(const size_t n)
+{
+    return n;
+}
+
+static size_t
+samples_2n(const size_t n)
+{
+    return 2 * n;
+}
+
+static size_t
+samples_batch(const size_t n)
+{
+    return BENCH_HOWMANY * n;
+}
+
+static size_t
+samples_pool_conv(const size_t n)
+{
+    return 2 * BENCH_HOWMANY * n;
+}
+
+static size_t
+samples_block(const size_t n)
+{
+    (void) n;
+    return BENCH_BLOCK;
+}
+
+static double
+flops_rfft(const size_t n)
+{
+    return 2.5 * (double) n * log2((double) n);
+}
+
+static double
+flops_cfft(const size_t n)
+{
+    return 5.0 * (double) n * log2((double) n);
+}
+
+static double
+flops_pow(const size_t n)
+{
+    return flops_rfft(n) + 3.0 * (double) n;
+}
+
+static double
+flops_batch(const size_t n)
+{
+    return BENCH_HOWMANY * flops_rfft(n);
+}
+
+/* Two forward transforms, a product of spectra and an inverse */
+static double
+flops_conv(const size_t n)
+{
+    size_t l;
+    l = udsp_fft_fast_size(2 * n - 1);
+    return 3.0 * flops_rfft(l) + 6.0 * (double) (l / 2 + 1);
+}
+
+static double
+flops_pool_conv(const size_t n)
+{
+    return BENCH_HOWMANY * flops_conv(n);
+}
+
+static double
+flops_nxcor(const size_t n)
+{
+    size_t l;
+    l = udsp_fft_fast_size(n + n / BENCH_HOWMANY);
+    return 3.0 * flops_rfft(l) + 6.0 * (double) (l / 2 + 1);
+}
+
+/* Segments of length n overlapping by half */
+static double
+flops_welch(const size_t n)
+{
+    size_t segments;
+    segments = 2 * BENCH_HOWMANY - 1;
+    return (double) segments * (flops_rfft(n) + 4.0 * (double) n);
+}
+
+static double
+flops_stft(const size_t n)
+{
+    return 2 * BENCH_HOWMANY * (flops_rfft(n) + (double) n);
+}
+
+/* A transform per channel and an inverse per pair of the upper half */
+static double
+flops_xcor_matrix(const size_t n)
+{
+    size_t l, pairs;
+    l = udsp_fft_fast_size(2 * n - 1);
+    pairs = BENCH_HOWMANY * (BENCH_HOWMANY + 1) / 2;
+    return (double) (BENCH_HOWMANY + pairs) * flops_rfft(l)
+        + 6.0 * (double) (pairs * (l / 2 + 1));
+}
+
+static double
+flops_goertzel(const size_t n)
+{
+    return 4.0 * (double) (BENCH_BINS * n);
+}
+
+static double
+flops_sdft(const size_t n)
+{
+    return 8.0 * (double) (BENCH_BINS * n);
+}
+
+/*
+ * Setup
+ */
+
+static void
+setup_state(struct bench_data *d)
+{
+    udsp_fft_init(d->st, d->method, d->n);
+    udsp_fft(d->st, d->x, d->n, d->u);
+    return;
+}
+
+static void
+setup_state_d(struct bench_data *d)
+{
+    udsp_fft_init_d(d->sd, d->method, d->n);
+    udsp_fft_d(d->sd, d->xd, d->n, d->ud);
+    return;
+}
+
+static void
+setup_plan(struct bench_data *d)
+{
+    d->plan = udsp_plan_create(d->method, d->n);
+    if (d->plan == NULL) {
+        exit(1);
+    }
+    udsp_plan_fft(d->plan, d->x, d->n, d->u);
+    return;
+}
+
+static void
+setup_plan_complex(struct bench_data *d)
+{
+    d->plan = udsp_plan_create_complex(d->method, d->n);
+    if (d->plan == NULL) {
+        exit(1);
+    }
+    return;
+}
+
+static void
+setup_plan_batch(struct bench_data *d)
+{
+    d->plan = udsp_plan_create_batch(d->method, d->n, BENCH_HOWMANY);
+    if (d->plan == NULL) {
+        exit(1);
+    }
+    udsp_plan_execute_r2c_batch(d->plan, BENCH_HOWMANY,
+        d->x, 1, d->n, d->u, 1, d->n / 2 + 1);
+    return;
+}
+
+static void
+teardown_plan(struct bench_data *d)
+{
+    udsp_plan_destroy(d->plan);
+    d->plan = NULL;
+    return;
+}
+
+static void
+setup_welch(struct bench_data *d)
+{
+    d->obj = udsp_welch_create(d->method, d->n, d->n / 2,
+        UDSP_WINDOW_HANN, UDSP_WELCH_ONESIDED, UDSP_WELCH_DENSITY);
+    if (d->obj == NULL) {
+        exit(1);
+    }
+    return;
+}
+
+static void
+teardown_welch(struct bench_data *d)
+{
+    udsp_welch_destroy(d->obj);
+    d->obj = NULL;
+    return;
+}
+
+static void
+setup_xcor_matrix(struct bench_data *d)
+{
+    d->obj = udsp_xcor_matrix_create(d->method, BENCH_HOWMANY, d->n);
+    if (d->obj == NULL) {
+        exit(1);
+    }
+    return;
+}
+
+static void
+teardown_xcor_matrix(struct bench_data *d)
+{
+    udsp_xcor_matrix_destroy(d->obj);
+    d->obj = NULL;
+    return;
+}
+
+static void
+setup_convolver(struct bench_data *d)
+{
+    d->obj = udsp_convolver_create(d->method, d->y, d->n, 0);
+    if (d->obj == NULL) {
+        exit(1);
+    }
+    return;
+}
+
+static void
+teardown_convolver(struct bench_data *d)
+{
+    udsp_convolver_destroy(d->obj);
+    d->obj = NULL;
+    return;
+}
+
+static void
+setup_stft(struct bench_data *d)
+{
+    d->obj = udsp_stft_create(d->method, d->n, d->n / 2, UDSP_WINDOW_HANN);
+    if (d->obj == NULL) {
+        exit(1);
+    }
+    return;
+}
+
+static void
+setup_istft(struct bench_data *d)
+{
+    d->obj = udsp_istft_create(d->method, d->n, d->n / 2,
+        UDSP_WINDOW_HANN);
+    if (d->obj == NULL) {
+        exit(1);
+    }
+    return;
+}
+
+static void
+teardown_stft(struct bench_data *d)
+{
+    udsp_stft_destroy(d->obj);
+    d->obj = NULL;
+    return;
+}
+
+static void
+setup_sdft(struct bench_data *d)
+{
+    size_t i;
+    for (i = 0; i < BENCH_BINS; i++) {
+        d->bins[i] = i * d->n / BENCH_BINS;
+    }
+    d->obj = udsp_sdft_create(d->n, d->bins, BENCH_BINS);
+    if (d->obj == NULL) {
+        exit(1);
+    }
+    return;
+}
+
+static void
+teardown_sdft(struct bench_data *d)
+{
+    udsp_sdft_destroy(d->obj);
+    d->obj = NULL;
+    return;
+}
+
+static void
+setup_goertzel(struct bench_data *d)
+{
+    size_t i;
+    for (i = 0; i < BENCH_BINS; i++) {
+        d->fbins[i] = (float) (i * d->n / BENCH_BINS) + 0.5f;
+    }
+    return;
+}
+
+/*
+ * Functions of a state
+ */
+
+static void
+run_fft_init(struct bench_data *d)
+{
+    udsp_fft_init(d->st, d->method, d->n);
+    return;
+}
+
+static void
+run_fft(struct bench_data *d)
+{
+    udsp_fft(d->st, d->x, d->n, d->u);
+    return;
+}
+
+static void
+run_ifft(struct bench_data *d)
+{
+    udsp_ifft(d->st, d->u, d->n, d->r);
+    return;
+}
+
+static void
+run_rfft(struct bench_data *d)
+{
+    udsp_rfft(d->st, d->x, d->n, d->v);
+    return;
+}
+
+static void
+run_irfft(struct bench_data *d)
+{
+    udsp_irfft(d->st, d->u, d->n / 2 + 1, d->r);
+    return;
+}
+
+static void
+run_fft_s16(struct bench_data *d)
+{
+    udsp_fft_s16(d->st, d->s16, d->n, BENCH_SCALE, d->v);
+    return;
+}
+
+static void
+run_fft_s32(struct bench_data *d)
+{
+    udsp_fft_s32(d->st, d->s32, d->n, BENCH_SCALE, d->v);
+    return;
+}
+
+static void
+run_rfft_s16(struct bench_data *d)
+{
+    udsp_rfft_s16(d->st, d->s16, d->n, BENCH_SCALE, d->v);
+    return;
+}
+
+static void
+run_rfft_s32(struct bench_data *d)
+{
+    udsp_rfft_s32(d->st, d->s32, d->n, BENCH_SCALE, d->v);
+    return;
+}
+
+static void
+run_ifft_s16(struct bench_data *d)
+{
+    udsp_ifft_s16(d->st, d->u, d->n / 2 + 1, BENCH_SCALE, d->s16);
+    return;
+}
+
+static void
+run_cfft(struct bench_data *d)
+{
+    udsp_cfft(d->st, d->u, d->n, d->v);
+    return;
+}
+
+static void
+run_icfft(struct bench_data *d)
+{
+    udsp_icfft(d->st, d->u, d->n, d->v);
+    return;
+}
+
+static void
+run_dct(struct bench_data *d)
+{
+    udsp_dct(d->st, 2, d->x, d->n, d->r);
+    return;
+}
+
+static void
+run_dst(struct bench_data *d)
+{
+    udsp_dst(d->st, 2, d->x, d->n, d->r);
+    return;
+}
+
+static void
+run_pow(struct bench_data *d)
+{
+    udsp_pow(d->st, d->x, d->n, d->r);
+    return;
+}
+
+#define DEFINE_RUN_CONV_FN(NAME, FN)                            \
+        static void                                             \
+        NAME(struct bench_data *d)                              \
+        {                                                       \
+            FN(d->st, d->x, d->n, d->y, d->n, d->r);            \
+            return;                                             \
+        }
+
+DEFINE_RUN_CONV_FN(run_conv, udsp_conv)
+DEFINE_RUN_CONV_FN(run_xcov, udsp_xcov)
+DEFINE_RUN_CONV_FN(run_xcor, udsp_xcor)
+
+static void
+run_nxcor(struct bench_data *d)
+{
+    udsp_nxcor(d->st, d->x, d->n, d->y, d->n / BENCH_HOWMANY, d->r);
+    return;
+}
+
+static void
+run_xcov_lags(struct bench_data *d)
+{
+    udsp_xcov_lags(d->st, d->x, d->n, d->y, d->n, BENCH_LAGS, d->r);
+    return;
+}
+
+static void
+run_xcor_lags(struct bench_data *d)
+{
+    udsp_xcor_lags(d->st, d->x, d->n, d->y, d->n, BENCH_LAGS, d->r);
+    return;
+}
+
+/*
+ * Double precision
+ */
+
+static void
+run_fft_init_d(struct bench_data *d)
+{
+    udsp_fft_init_d(d->sd, d->method, d->n);
+    return;
+}
+
+static void
+run_fft_d(struct bench_data *d)
+{
+    udsp_fft_d(d->sd, d->xd, d->n, d->ud);
+    return;
+}
+
+static void
+run_ifft_d(struct bench_data *d)
+{
+    udsp_ifft_d(d->sd, d->ud, d->n, d->rd);
+    return;
+}
+
+static void
+run_pow_d(struct bench_data *d)
+{
+    udsp_pow_d(d->sd, d->xd, d->n, d->rd);
+    return;
+}
+
+#define DEFINE_RUN_CONV_D_FN(NAME, FN)                          \
+        static void                                             \
+        NAME(struct bench_data *d)                              \
+        {                                                       \
+            FN(d->sd, d->xd, d->n, d->yd, d->n, d->rd);         \
+            return;                                             \
+        }
+
+DEFINE_RUN_CONV_D_FN(run_conv_d, udsp_conv_d)
+DEFINE_RUN_CONV_D_FN(run_xcov_d, udsp_xcov_d)
+DEFINE_RUN_CONV_D_FN(run_xcor_d, udsp_xcor_d)
+
+/*
+ * Plans
+ */
+
+static void
+run_plan_create(struct bench_data *d)
+{
+    udsp_plan_t *plan;
+    plan = udsp_plan_create(d->method, d->n);
+    if (plan == NULL) {
+        exit(1);
+    }
+    udsp_plan_destroy(plan);
+    return;
+}
+
+static void
+run_plan_fft(struct bench_data *d)
+{
+    udsp_plan_fft(d->plan, d->x, d->n, d->u);
+    return;
+}
+
+static void
+run_plan_ifft(struct bench_data *d)
+{
+    udsp_plan_ifft(d->plan, d->u, d->n, d->r);
+    return;
+}
+
+static void
+run_plan_rfft(struct bench_data *d)
+{
+    udsp_plan_rfft(d->plan, d->x, d->n, d->v);
+    return;
+}
+
+static void
+run_plan_irfft(struct bench_data *d)
+{
+    udsp_plan_irfft(d->plan, d->u, d->n / 2 + 1, d->r);
+    return;
+}
+
+static void
+run_plan_r2c(struct bench_data *d)
+{
+    udsp_plan_execute_r2c(d->plan, d->x, d->v);
+    return;
+}
+
+static void
+run_plan_c2r(struct bench_data *d)
+{
+    udsp_plan_execute_c2r(d->plan, d->u, d->r);
+    return;
+}
+
+static void
+run_plan_cfft(struct bench_data *d)
+{
+    udsp_plan_cfft(d->plan, d->u, d->n, d->v);
+    return;
+}
+
+static void
+run_plan_icfft(struct bench_data *d)
+{
+    udsp_plan_icfft(d->plan, d->u, d->n, d->v);
+    return;
+}
+
+static void
+run_plan_r2c_batch(struct bench_data *d)
+{
+    udsp_plan_execute_r2c_batch(d->plan, BENCH_HOWMANY,
+        d->x, 1, d->n, d->v, 1, d->n / 2 + 1);
+    return;
+}
+
+static void
+run_plan_c2r_batch(struct bench_data *d)
+{
+    udsp_plan_execute_c2r_batch(d->plan, BENCH_HOWMANY,
+        d->u, 1, d->n / 2 + 1, d->r, 1, d->n);
+    return;
+}
+
+/*
+ * Streams and estimators
+ */
+
+static void
+run_welch(struct bench_data *d)
+{
+    udsp_welch(d->obj, d->x, BENCH_HOWMANY * d->n, d->r);
+    return;
+}
+
+static void
+run_xcor_matrix(struct bench_data *d)
+{
+    udsp_xcor_matrix(d->obj, d->x, d->n, 1, d->r, 2 * d->n - 1);
+    return;
+}
+
+static void
+run_convolver(struct bench_data *d)
+{
+    udsp_convolver_process(d->obj, d->x, BENCH_BLOCK, d->r);
+    return;
+}
+
+static void
+run_stft(struct bench_data *d)
+{
+    (void) udsp_stft_process(d->obj, d->x, BENCH_HOWMANY * d->n,
+        UDSP_STFT_COMPLEX, d->v);
+    return;
+}
+
+static void
+run_istft(struct bench_data *d)
+{
+    udsp_istft_process(d->obj, d->u, 2 * BENCH_HOWMANY, d->r);
+    return;
+}
+
+static void
+run_goertzel(struct bench_data *d)
+{
+    udsp_goertzel(d->x, d->n, d->fbins, BENCH_BINS, d->v);
+    return;
+}
+
+static void
+run_sdft(struct bench_data *d)
+{
+    udsp_sdft_process(d->obj, d->x, d->n, NULL);
+    return;
+}
+
+static void
+run_fft_shift(struct bench_data *d)
+{
+    udsp_fft_shift(d->u, d->n);
+    return;
+}
+
+static void
+run_ifft_shift(struct bench_data *d)
+{
+    udsp_ifft_shift(d->u, d->n);
+    return;
+}
+
+static void
+run_fft_fast_size(struct bench_data *d)
+{
+    volatile size_t l;
+    l = udsp_fft_fast_size(d->n);
+    (void) l;
+    return;
+}
+
+/*
+ * Thread pools
+ */
+
+static void
+run_pool_r2c(struct bench_data *d)
+{
+    udsp_pool_execute_r2c(d->pool, d->plan, d->x, d->v);
+    return;
+}
+
+static void
+run_pool_c2r(struct bench_data *d)
+{
+    udsp_pool_execute_c2r(d->pool, d->plan, d->u, d->r);
+    return;
+}
+
+static void
+run_pool_r2c_batch(struct bench_data *d)
+{
+    udsp_pool_execute_r2c_batch(d->pool, d->plan, BENCH_HOWMANY,
+        d->x, 1, d->n, d->v, 1, d->n / 2 + 1);
+    return;
+}
+
+static void
+run_pool_c2r_batch(struct bench_data *d)
+{
+    udsp_pool_execute_c2r_batch(d->pool, d->plan, BENCH_HOWMANY,
+        d->u, 1, d->n / 2 + 1, d->r, 1, d->n);
+    return;
+}
+
+#define DEFINE_RUN_POOL_CONV_FN(NAME, FN)                       \
+        static void                                             \
+        NAME(struct bench_data *d)                              \
+        {                                                       \
+            (void) FN(d->pool, BENCH_HOWMANY,                   \
+                d->x, d->n, d->n, d->y, d->n, d->n,             \
+                d->r, 2 * d->n - 1);                            \
+            return;                                             \
+        }
+
+DEFINE_RUN_POOL_CONV_FN(run_pool_conv, udsp_pool_conv)
+DEFINE_RUN_POOL_CONV_FN(run_pool_xcov, udsp_pool_xcov)
+DEFINE_RUN_POOL_CONV_FN(run_pool_xcor, udsp_pool_xcor)
+
+static void
+run_pool_welch(struct bench_data *d)
+{
+    udsp_pool_welch(d->pool, d->obj, d->x, BENCH_HOWMANY * d->n, d->r);
+    return;
+}
+
+static void
+run_pool_xcor_matrix(struct bench_data *d)
+{
+    udsp_pool_xcor_matrix(d->pool, d->obj, d->x, d->n, 1,
+        d->r, 2 * d->n - 1);
+    return;
+}
+
+#define M BENCH_METHOD
+#define H BENCH_HALF
+#define S BENCH_STATE
+
+static const struct bench benches[] = {
+    {"udsp_fft_init", M | S, NULL, run_fft_init, NULL, samples_n, NULL},
+    {"udsp_fft", M | S, setup_state, run_fft, NULL, samples_n, flops_rfft},
+    {"udsp_ifft", M | S, setup_state, run_ifft, NULL, samples_n, flops_rfft},
+    {"udsp_rfft", M | S, setup_state, run_rfft, NULL, samples_n, flops_rfft},
+    {"udsp_irfft", M | S, setup_state, run_irfft, NULL,
+        samples_n, flops_rfft},
+    {"udsp_fft_s16", M | S, setup_state, run_fft_s16, NULL,
+        samples_n, flops_rfft},
+    {"udsp_fft_s32", M | S, setup_state, run_fft_s32, NULL,
+        samples_n, flops_rfft},
+    {"udsp_rfft_s16", M | S, setup_state, run_rfft_s16, NULL,
+        samples_n, flops_rfft},
+    {"udsp_rfft_s32", M | S, setup_state, run_rfft_s32, NULL,
+        samples_n, flops_rfft},
+    {"udsp_ifft_s16", M | S, setup_state, run_ifft_s16, NULL,
+        samples_n, flops_rfft},
+    {"udsp_cfft", M | S, setup_state, run_cfft, NULL, samples_n, flops_cfft},
+    {"udsp_icfft", M | S, setup_state, run_icfft, NULL,
+        samples_n, flops_cfft},
+    {"udsp_dct", M | S, setup_state, run_dct, NULL, samples_n, flops_rfft},
+    {"udsp_dst", M | S, setup_state, run_dst, NULL, samples_n, flops_rfft},
+    {"udsp_fft_shift", 0, NULL, run_fft_shift, NULL, samples_n, NULL},
+    {"udsp_ifft_shift", 0, NULL, run_ifft_shift, NULL, samples_n, NULL},
+    {"udsp_fft_fast_size", 0, NULL, run_fft_fast_size, NULL,
+        samples_n, NULL},
+    {"udsp_conv", H, NULL, run_conv, NULL, samples_2n, flops_conv},
+    {"udsp_xcov", H, NULL, run_xcov, NULL, samples_2n, flops_conv},
+    {"udsp_xcor", H, NULL, run_xcor, NULL, samples_2n, flops_conv},
+    {"udsp_nxcor", H, NULL, run_nxcor, NULL, samples_n, flops_nxcor},
+    {"udsp_xcov_lags", H, NULL, run_xcov_lags, NULL, samples_2n, NULL},
+    {"udsp_xcor_lags", H, NULL, run_xcor_lags, NULL, samples_2n, NULL},
+    {"udsp_pow", S, NULL, run_pow, NULL, samples_n, flops_pow},
+    {"udsp_fft_init_d", M | S, NULL, run_fft_init_d, NULL, samples_n, NULL},
+    {"udsp_fft_d", M | S, setup_state_d, run_fft_d, NULL,
+        samples_n, flops_rfft},
+    {"udsp_ifft_d", M | S, setup_state_d, run_ifft_d, NULL,
+        samples_n, flops_rfft},
+    {"udsp_conv_d", H, NULL, run_conv_d, NULL, samples_2n, flops_conv},
+    {"udsp_xcov_d", H, NULL, run_xcov_d, NULL, samples_2n, flops_conv},
+    {"udsp_xcor_d", H, NULL, run_xcor_d, NULL, samples_2n, flops_conv},
+    {"udsp_pow_d", S, NULL, run_pow_d, NULL, samples_n, flops_pow},
+    {"udsp_plan_create", M, NULL, run_plan_create, NULL, samples_n, NULL},
+    {"udsp_plan_fft", M, setup_plan, run_plan_fft, teardown_plan,
+        samples_n, flops_rfft},
+    {"udsp_plan_ifft", M, setup_plan, run_plan_ifft, teardown_plan,
+        samples_n, flops_rfft},
+    {"udsp_plan_rfft", M, setup_plan, run_plan_rfft, teardown_plan,
+        samples_n, flops_rfft},
+    {"udsp_plan_irfft", M, setup_plan, run_plan_irfft, teardown_plan,
+        samples_n, flops_rfft},
+    {"udsp_plan_execute_r2c", M, setup_plan, run_plan_r2c, teardown_plan,
+        samples_n, flops_rfft},
+    {"udsp_plan_execute_c2r", M, setup_plan, run_plan_c2r, teardown_plan,
+        samples_n, flops_rfft},
+    {"udsp_plan_cfft", M, setup_plan_complex, run_plan_cfft,
+        teardown_plan, samples_n, flops_cfft},
+    {"udsp_plan_icfft", M, setup_plan_complex, run_plan_icfft,
+        teardown_plan, samples_n, flops_cfft},
+    {"udsp_plan_execute_r2c_batch", M, setup_plan_batch,
+        run_plan_r2c_batch, teardown_plan, samples_batch, flops_batch},
+    {"udsp_plan_execute_c2r_batch", M, setup_plan_batch,
+        run_plan_c2r_batch, teardown_plan, samples_batch, flops_batch},
+    {"udsp_welch", M, setup_welch, run_welch, teardown_welch,
+        samples_batch, flops_welch},
+    {"udsp_xcor_matrix", M | H, setup_xcor_matrix, run_xcor_matrix,
+        teardown_xcor_matrix, samples_batch, flops_xcor_matrix},
+    {"udsp_convolver_process", M, setup_convolver, run_convolver,
+        teardown_convolver, samples_block, NULL},
+    {"udsp_stft_process", M, setup_stft, run_stft, teardown_stft,
+        samples_batch, flops_stft},
+    {"udsp_istft_process", M, setup_istft, run_istft, teardown_stft,
+        samples_batch, flops_stft},
+    {"udsp_goertzel", 0, setup_goertzel, run_goertzel, NULL,
+        samples_n, flops_goertzel},
+    {"udsp_sdft_process", 0, setup_sdft, run_sdft, teardown_sdft,
+        samples_n, flops_sdft},
+    {"udsp_pool_execute_r2c", M, setup_plan, run_pool_r2c, teardown_plan,
+        samples_n, flops_rfft},
+    {"udsp_pool_execute_c2r", M, setup_plan, run_pool_c2r, teardown_plan,
+        samples_n, flops_rfft},
+    {"udsp_pool_execute_r2c_batch", M, setup_plan_batch,
+        run_pool_r2c_batch, teardown_plan, samples_batch, flops_batch},
+    {"udsp_pool_execute_c2r_batch", M, setup_plan_batch,
+        run_pool_c2r_batch, teardown_plan, samples_batch, flops_batch},
+    {"udsp_pool_conv", H, NULL, run_pool_conv, NULL,
+        samples_pool_conv, flops_pool_conv},
+    {"udsp_pool_xcov", H, NULL, run_pool_xcov, NULL,
+        samples_pool_conv, flops_pool_conv},
+    {"udsp_pool_xcor", H, NULL, run_pool_xcor, NULL,
+        samples_pool_conv, flops_pool_conv},
+    {"udsp_pool_welch", M, setup_welch, run_pool_welch, teardown_welch,
+        samples_batch, flops_welch},
+    {"udsp_pool_xcor_matrix", M | H, setup_xcor_matrix,
+        run_pool_xcor_matrix, teardown_xcor_matrix,
+        samples_batch, flops_xcor_matrix},
+};
+
+#undef M
+#undef H
+#undef S
+
+static const size_t n_benches = sizeof(benches) / sizeof(benches[0]);
+
+/*
+ * Lengths
+ */
+
+#define SIZE_POW2 0
+#define SIZE_SMOOTH 1
+#define SIZE_PRIME 2
+
+static const char *size_kinds[] = {"pow2", "smooth", "prime"};
+
+static const size_t smooth_sizes[] = {
+    12, 45, 100, 360, 1000, 3600, 10000, 30000, 60000,
+};
+
+#define N_SMOOTH_SIZES (sizeof(smooth_sizes) / sizeof(smooth_sizes[0]))
+
+static int
+is_prime(const size_t n)
+{
+    size_t i;
+    if (n < 2) {
+        return 0;
+    }
+    for (i = 2; i * i <= n; i++) {
+        if (n % i == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static size_t
+prime_below(const size_t n)
+{
+    size_t p;
+    for (p = n - 1; p > 2 && !is_prime(p); p--) {
+        ;
+    }
+    return p;
+}
+
+struct size {
+    size_t n;
+    int kind;
+};
+
+#define N_SIZES_MAX 64
+
+static int
+compare_sizes(const void *a, const void *b)
+{
+    const struct size *x = a;
+    const struct size *y = b;
+    return (x->n > y->n) - (x->n < y->n);
+}
+
+static size_t
+make_sizes(struct size *sizes, const size_t max)
+{
+    size_t i, k, p;
+    k = 0;
+    for (p = 16; p <= max && k < N_SIZES_MAX; p *= 2) {
+        sizes[k].n = p;
+        sizes[k].kind = SIZE_POW2;
+        k++;
+    }
+    for (i = 0; i < N_SMOOTH_SIZES && k < N_SIZES_MAX; i++) {
+        if (smooth_sizes[i] <= max) {
+            sizes[k].n = smooth_sizes[i];
+            sizes[k].kind = SIZE_SMOOTH;
+            k++;
+        }
+    }
+    for (p = 16; p <= max / 4 && k < N_SIZES_MAX; p *= 4) {
+        sizes[k].n = prime_below(p);
+        sizes[k].kind = SIZE_PRIME;
+        k++;
+    }
+    qsort(sizes, k, sizeof(struct size), compare_sizes);
+    return k;
+}
+
+/*
+ * Timing
+ */
+
+static uint64_t
+time_calls(const struct bench *b, struct bench_data *d, const size_t calls)
+{
+    uint64_t t;
+    size_t i;
+    nclock_init(&t);
+    for (i = 0; i < calls; i++) {
+        b->run(d);
+    }
+    nclock_elapsed(&t);
+    return t;
+}
+
+static int
+compare_doubles(const void *a, const void *b)
+{
+    const double x = *(const double *) a;
+    const double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+struct result {
+    size_t calls;
+    size_t reps;
+    double median;
+    double p99;
+    double min;
+};
+
+static void
+measure(const struct bench *b, struct bench_data *d,
+    double *restrict ns, const size_t reps, struct result *restrict res)
+{
+    uint64_t t;
+    size_t calls, count, warmup, i;
+    calls = 1;
+    t = time_calls(b, d, calls);
+    while (t < BENCH_SAMPLE_NS && calls < BENCH_CALLS_MAX) {
+        calls *= 2;
+        t = time_calls(b, d, calls);
+    }
+    /* A slow function is sampled less, its first call the warmup */
+    warmup = BENCH_WARMUP;
+    count = reps;
+    if ((warmup + count) * t > BENCH_CASE_NS) {
+        warmup = 0;
+        count = (size_t) (BENCH_CASE_NS / t);
+        count = (count < 1) ? 1 : (count > reps) ? reps : count;
+    }
+    for (i = 0; i < warmup; i++) {
+        (void) time_calls(b, d, calls);
+    }
+    for (i = 0; i < count; i++) {
+        ns[i] = (double) time_calls(b, d, calls) / (double) calls;
+    }
+    qsort(ns, count, sizeof(double), compare_doubles);
+    res->calls = calls;
+    res->reps = count;
+    res->median = ns[count / 2];
+    res->p99 = ns[(size_t) ceil(0.99 * (double) count) - 1];
+    res->min = ns[0];
+    return;
+}
+
+static void
+print_result(const struct bench *b, const struct bench_data *d,
+    const int kind, const struct result *res,
+    const int first)
+{
+    const char *method;
+    double samples;
+    method = NULL;
+    if (b->flags & BENCH_METHOD) {
+        method = (d->method == UDSP_FFT_NATIVE) ? "native" : "fftpack";
+    }
+    samples = (double) b->samples(d->n);
+    printf("%s    {\"function\": \"%s\", ", first ? "" : ",\n", b->name);
+    if (method != NULL) {
+        printf("\"method\": \"%s\", ", method);
+    } else {
+        printf("\"method\": null, ");
+    }
+    printf("\"n\": %zu, \"sizes\": \"%s\", ", d->n, size_kinds[kind]);
+    printf("\"calls\": %zu, \"reps\": %zu, ", res->calls, res->reps);
+    printf("\"ns_median\": %.1f, \"ns_p99\": %.1f, \"ns_min\": %.1f, ",
+        res->median, res->p99, res->min);
+    printf("\"msamples_per_s\": %.3f, ", 1e3 * samples / res->median);
+    if (b->flops != NULL) {
+        printf("\"gflops\": %.3f}", b->flops(d->n) / res->median);
+    } else {
+        printf("\"gflops\": null}");
+    }
+    return;
+}
+
+/*
+ * Main
+ */
+
+static int
+selected(const char *name, char **names, const int count)
+{
+    int i;
+    if (count == 0) {
+        return 1;
+    }
+    for (i = 0; i < count; i++) {
+        if (strncmp(name, names[i], strlen(names[i])) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int
+usage(void)
+{
+    fprintf(stderr, "usage: bench-udsp [-r reps] [-m max] [name ...]\n");
+    return 1;
+}
+
+static void
+fill_data(struct bench_data *d, const size_t len)
+{
+    size_t i;
+    for (i = 0; i < len; i++) {
+        d->x[i] = (float) rand() / (float) RAND_MAX - 0.5f;
+        d->y[i] = (float) rand() / (float) RAND_MAX - 0.5f;
+        d->xd[i] = (double) d->x[i];
+        d->yd[i] = (double) d->y[i];
+        d->u[i].real = d->x[i];
+        d->u[i].imag = d->y[i];
+        d->s16[i] = (int16_t) (rand() % 65536 - 32768);
+        d->s32[i] = (int32_t) (rand() % 65536 - 32768) * 65536;
+    }
+    return;
+}
+
+int
+main(int argc, char **argv)
+{
+    struct bench_data d;
+    struct size sizes[N_SIZES_MAX];
+    struct result res;
+    double *ns;
+    size_t reps, max, len, n_sizes, i, j;
+    long threads;
+    int methods[2] = {UDSP_FFT_FFTPACK, UDSP_FFT_NATIVE};
+    int k, m, first;
+
+    reps = BENCH_REPS;
+    max = udsp_fft_max_size();
+    for (k = 1; k + 1 < argc && argv[k][0] == '-'; k += 2) {
+        if (strcmp(argv[k], "-r") == 0) {
+            reps = (size_t) strtoul(argv[k + 1], NULL, 10);
+        } else if (strcmp(argv[k], "-m") == 0) {
+            max = (size_t) strtoul(argv[k + 1], NULL, 10);
+        } else {
+            return usage();
+        }
+    }
+    if (reps == 0 || max < 16 || max > udsp_fft_max_size()) {
+        return usage();
+    }
+    n_sizes = make_sizes(sizes, max);
+
+    threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) {
+        threads = 1;
+    }
+    memset(&d, 0, sizeof(d));
+    len = BENCH_HOWMANY * (udsp_fft_max_size() + 2);
+    d.st = xmalloc(2 * sizeof(udsp_state_t));
+    d.sd = xmalloc(2 * sizeof(udsp_state_d_t));
+    d.x = xmalloc(len * sizeof(float));
+    d.y = xmalloc(len * sizeof(float));
+    d.r = xmalloc(BENCH_HOWMANY * len * sizeof(float));
+    d.u = xmalloc(len * sizeof(udsp_complex_t));
+    d.v = xmalloc(len * sizeof(udsp_complex_t));
+    d.xd = xmalloc(len * sizeof(double));
+    d.yd = xmalloc(len * sizeof(double));
+    d.rd = xmalloc(len * sizeof(double));
+    d.ud = xmalloc(len * sizeof(udsp_complex_d_t));
+    d.s16 = xmalloc(len * sizeof(int16_t));
+    d.s32 = xmalloc(len * sizeof(int32_t));
+    ns = xmalloc(reps * sizeof(double));
+    d.pool = udsp_pool_create((size_t) threads);
+    if (d.pool == NULL) {
+        exit(1);
+    }
+    fill_data(&d, len);
+
+    printf("{\n");
+    printf("  \"max_size\": %zu,\n", max);
+    printf("  \"threads\": %ld,\n", threads);
+    printf("  \"results\": [\n");
+    first = 1;
+    for (i = 0; i < n_benches; i++) {
+        const struct bench *b = &benches[i];
+        if (!selected(b->name, &argv[k], argc - k)) {
+            continue;
+        }
+        for (m = 0; m < ((b->flags & BENCH_METHOD) ? 2 : 1); m++) {
+            d.method = methods[m];
+            for (j = 0; j < n_sizes; j++) {
+                d.n = sizes[j].n;
+                if ((b->flags & BENCH_HALF) && 2 * d.n > max) {
+                    continue;
+                }
+                if ((b->flags & BENCH_STATE)
+                    && d.n >= udsp_fft_max_size()) {
+                    continue;
+                }
+                if (b->setup != NULL) {
+                    b->setup(&d);
+                }
+                measure(b, &d, ns, reps, &res);
+                if (b->teardown != NULL) {
+                    b->teardown(&d);
+                }
+                print_result(b, &d, sizes[j].kind, &res, first);
+                fflush(stdout);
+                first = 0;
+            }
+        }
+    }
+    printf("\n  ]\n}\n");
+
+    udsp_pool_destroy(d.pool);
+    free(ns);
+    free(d.s32);
+    free(d.s16);
+    free(d.ud);
+    free(d.rd);
+    free(d.yd);
+    free(d.xd);
+    free(d.v);
+    free(d.u);
+    free(d.r);
+    free(d.y);
+    free(d.x);
+    free(d.sd);
+    free(d.st);
+
+    return 0;
+}
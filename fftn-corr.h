@@ -0,0 +1,65 @@
+/* Copyright 2013-2016, Mansour Moufid <mansourmoufid@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Direct correlation of the native kernels.
+ *
+ * This file is included by fftn.c once per instruction set, after
+ * fftn-pass.h, with the same macros defined.
+ *
+ * Output k of the nz outputs is the dot product of the nb reals at
+ * a + k with the nb reals of b, summed in order, so that every output
+ * of every kernel is computed the same way.  The outputs are computed
+ * four lanes at a time, then one lane at a time, and the last lane is
+ * shifted back to end on the last output;  the caller ensures nz >=
+ * FFTN_LANES.
+ */
+
+static FFTN_TARGET void
+FFTN_NAME(fftn_corr)(const FFTN_R *restrict a, const FFTN_R *restrict b,
+    const size_t nb, FFTN_R *restrict z, const size_t nz)
+{
+    FFTN_T s0, s1, s2, s3, w;
+    size_t k, t;
+    for (k = 0; k + 4 * FFTN_LANES <= nz; k += 4 * FFTN_LANES) {
+        s0 = (FFTN_T) {0};
+        s1 = (FFTN_T) {0};
+        s2 = (FFTN_T) {0};
+        s3 = (FFTN_T) {0};
+        for (t = 0; t < nb; t++) {
+            w = (FFTN_T) {0} + b[t];
+            s0 += FFTN_LD(&a[k + t]) * w;
+            s1 += FFTN_LD(&a[k + t + FFTN_LANES]) * w;
+            s2 += FFTN_LD(&a[k + t + 2 * FFTN_LANES]) * w;
+            s3 += FFTN_LD(&a[k + t + 3 * FFTN_LANES]) * w;
+        }
+        FFTN_ST(&z[k], s0);
+        FFTN_ST(&z[k + FFTN_LANES], s1);
+        FFTN_ST(&z[k + 2 * FFTN_LANES], s2);
+        FFTN_ST(&z[k + 3 * FFTN_LANES], s3);
+    }
+    while (k < nz) {
+        if (k + FFTN_LANES > nz) {
+            k = nz - FFTN_LANES;
+        }
+        s0 = (FFTN_T) {0};
+        for (t = 0; t < nb; t++) {
+            s0 += FFTN_LD(&a[k + t]) * ((FFTN_T) {0} + b[t]);
+        }
+        FFTN_ST(&z[k], s0);
+        k += FFTN_LANES;
+    }
+    return;
+}
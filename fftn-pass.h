@@ -0,0 +1,353 @@
+/* Copyright 2013-2016, Mansour Moufid <mansourmoufid@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Passes of the native FFT.
+ *
+ * This file is included by fftn.c once per instruction set, with the
+ * following macros defined:
+ *
+ *   FFTN_R         the real type, float or double
+ *   FFTN_T         the lane type, a vector of FFTN_LANES reals
+ *   FFTN_LANES     the number of reals in a lane
+ *   FFTN_LD(p)     load a lane from the real array at p
+ *   FFTN_ST(p, x)  store the lane x to the real array at p
+ *   FFTN_TARGET    a function attribute, or nothing
+ *   FFTN_NAME(x)   the name x with the instruction set suffix
+ *
+ * A pass of radix p maps the array a, of l1 blocks of p rows of ido
+ * complex points, to the array b, of p blocks of l1 rows of ido points,
+ * by a DFT of length p down the columns followed by a multiplication
+ * by the twiddle factors.  Arrays are stored as separate real and
+ * imaginary parts.
+ *
+ * Each point may itself be a row of nb points of independent
+ * transforms.  If nb is 1 the loop over the ido points of a row is
+ * done FFTN_LANES points at a time, and the caller ensures ido >=
+ * FFTN_LANES;  otherwise the loop over the nb transforms is, the
+ * twiddle factors are broadcast, and the caller ensures nb >=
+ * FFTN_LANES.  The last iteration of a loop is shifted back to end on
+ * the last point, which recomputes a few points rather than needing a
+ * scalar tail.
+ */
+
+#define FFTN_W(p, bcast) ((bcast) ? (FFTN_T) {0} + *(p) : FFTN_LD(p))
+
+#define FFTN_TWIDDLE(yr, yi, wr, wi)                \
+        do {                                        \
+            FFTN_T _tr = (yr) * (wr) - (yi) * (wi); \
+            (yi) = (yr) * (wi) + (yi) * (wr);       \
+            (yr) = _tr;                             \
+        } while (0)
+
+/*
+ * Butterflies
+ *
+ * A butterfly of radix p loads its inputs at a stride of sa reals,
+ * stores its outputs at a stride of sb reals, and loads the twiddle
+ * factor of output q at (q - 1) sw reals from wr and wi.
+ */
+
+#define FFTN_BUTTERFLY(NAME)                                            \
+        static inline FFTN_TARGET void                                  \
+        FFTN_NAME(NAME)(const size_t p,                                 \
+            const FFTN_R *restrict ar, const FFTN_R *restrict ai,       \
+            const size_t sa,                                            \
+            FFTN_R *restrict br, FFTN_R *restrict bi, const size_t sb,  \
+            const FFTN_R *restrict wr, const FFTN_R *restrict wi,       \
+            const size_t sw, const FFTN_R *restrict c, const int bcast)
+
+FFTN_BUTTERFLY(fftn_bf2)
+{
+    FFTN_T x0r, x0i, x1r, x1i, y1r, y1i;
+    (void) p;
+    (void) sw;
+    (void) c;
+    x0r = FFTN_LD(&ar[0]);
+    x0i = FFTN_LD(&ai[0]);
+    x1r = FFTN_LD(&ar[sa]);
+    x1i = FFTN_LD(&ai[sa]);
+    y1r = x0r - x1r;
+    y1i = x0i - x1i;
+    FFTN_TWIDDLE(y1r, y1i, FFTN_W(&wr[0], bcast), FFTN_W(&wi[0], bcast));
+    FFTN_ST(&br[0], x0r + x1r);
+    FFTN_ST(&bi[0], x0i + x1i);
+    FFTN_ST(&br[sb], y1r);
+    FFTN_ST(&bi[sb], y1i);
+    return;
+}
+
+FFTN_BUTTERFLY(fftn_bf3)
+{
+    const FFTN_R s = (FFTN_R) 0.866025403784438646763723170752936183;
+    FFTN_T x0r, x0i, x1r, x1i, x2r, x2i;
+    FFTN_T tr, ti, mr, mi, dr, di, y1r, y1i, y2r, y2i;
+    (void) p;
+    (void) c;
+    x0r = FFTN_LD(&ar[0]);
+    x0i = FFTN_LD(&ai[0]);
+    x1r = FFTN_LD(&ar[sa]);
+    x1i = FFTN_LD(&ai[sa]);
+    x2r = FFTN_LD(&ar[2 * sa]);
+    x2i = FFTN_LD(&ai[2 * sa]);
+    tr = x1r + x2r;
+    ti = x1i + x2i;
+    mr = x0r - (FFTN_R) 0.5 * tr;
+    mi = x0i - (FFTN_R) 0.5 * ti;
+    dr = s * (x1r - x2r);
+    di = s * (x1i - x2i);
+    y1r = mr + di;
+    y1i = mi - dr;
+    y2r = mr - di;
+    y2i = mi + dr;
+    FFTN_TWIDDLE(y1r, y1i, FFTN_W(&wr[0], bcast), FFTN_W(&wi[0], bcast));
+    FFTN_TWIDDLE(y2r, y2i, FFTN_W(&wr[sw], bcast), FFTN_W(&wi[sw], bcast));
+    FFTN_ST(&br[0], x0r + tr);
+    FFTN_ST(&bi[0], x0i + ti);
+    FFTN_ST(&br[sb], y1r);
+    FFTN_ST(&bi[sb], y1i);
+    FFTN_ST(&br[2 * sb], y2r);
+    FFTN_ST(&bi[2 * sb], y2i);
+    return;
+}
+
+FFTN_BUTTERFLY(fftn_bf4)
+{
+    FFTN_T x0r, x0i, x1r, x1i, x2r, x2i, x3r, x3i;
+    FFTN_T t0r, t0i, t1r, t1i, t2r, t2i, t3r, t3i;
+    FFTN_T y1r, y1i, y2r, y2i, y3r, y3i;
+    (void) p;
+    (void) c;
+    x0r = FFTN_LD(&ar[0]);
+    x0i = FFTN_LD(&ai[0]);
+    x1r = FFTN_LD(&ar[sa]);
+    x1i = FFTN_LD(&ai[sa]);
+    x2r = FFTN_LD(&ar[2 * sa]);
+    x2i = FFTN_LD(&ai[2 * sa]);
+    x3r = FFTN_LD(&ar[3 * sa]);
+    x3i = FFTN_LD(&ai[3 * sa]);
+    t0r = x0r + x2r;
+    t0i = x0i + x2i;
+    t1r = x0r - x2r;
+    t1i = x0i - x2i;
+    t2r = x1r + x3r;
+    t2i = x1i + x3i;
+    t3r = x1r - x3r;
+    t3i = x1i - x3i;
+    y1r = t1r + t3i;
+    y1i = t1i - t3r;
+    y2r = t0r - t2r;
+    y2i = t0i - t2i;
+    y3r = t1r - t3i;
+    y3i = t1i + t3r;
+    FFTN_TWIDDLE(y1r, y1i, FFTN_W(&wr[0], bcast), FFTN_W(&wi[0], bcast));
+    FFTN_TWIDDLE(y2r, y2i, FFTN_W(&wr[sw], bcast), FFTN_W(&wi[sw], bcast));
+    FFTN_TWIDDLE(y3r, y3i,
+        FFTN_W(&wr[2 * sw], bcast), FFTN_W(&wi[2 * sw], bcast));
+    FFTN_ST(&br[0], t0r + t2r);
+    FFTN_ST(&bi[0], t0i + t2i);
+    FFTN_ST(&br[sb], y1r);
+    FFTN_ST(&bi[sb], y1i);
+    FFTN_ST(&br[2 * sb], y2r);
+    FFTN_ST(&bi[2 * sb], y2i);
+    FFTN_ST(&br[3 * sb], y3r);
+    FFTN_ST(&bi[3 * sb], y3i);
+    return;
+}
+
+FFTN_BUTTERFLY(fftn_bf5)
+{
+    const FFTN_R c1 = (FFTN_R) 0.309016994374947424102293417182819059;
+    const FFTN_R c2 = (FFTN_R) -0.809016994374947424102293417182819059;
+    const FFTN_R s1 = (FFTN_R) 0.951056516295153572116439333379382143;
+    const FFTN_R s2 = (FFTN_R) 0.587785252292473129168705954639072769;
+    FFTN_T x0r, x0i, x1r, x1i, x2r, x2i, x3r, x3i, x4r, x4i;
+    FFTN_T t1r, t1i, t2r, t2i, t3r, t3i, t4r, t4i;
+    FFTN_T a1r, a1i, a2r, a2i, b1r, b1i, b2r, b2i;
+    FFTN_T y1r, y1i, y2r, y2i, y3r, y3i, y4r, y4i;
+    (void) p;
+    (void) c;
+    x0r = FFTN_LD(&ar[0]);
+    x0i = FFTN_LD(&ai[0]);
+    x1r = FFTN_LD(&ar[sa]);
+    x1i = FFTN_LD(&ai[sa]);
+    x2r = FFTN_LD(&ar[2 * sa]);
+    x2i = FFTN_LD(&ai[2 * sa]);
+    x3r = FFTN_LD(&ar[3 * sa]);
+    x3i = FFTN_LD(&ai[3 * sa]);
+    x4r = FFTN_LD(&ar[4 * sa]);
+    x4i = FFTN_LD(&ai[4 * sa]);
+    t1r = x1r + x4r;
+    t1i = x1i + x4i;
+    t2r = x2r + x3r;
+    t2i = x2i + x3i;
+    t3r = x1r - x4r;
+    t3i = x1i - x4i;
+    t4r = x2r - x3r;
+    t4i = x2i - x3i;
+    a1r = x0r + c1 * t1r + c2 * t2r;
+    a1i = x0i + c1 * t1i + c2 * t2i;
+    a2r = x0r + c2 * t1r + c1 * t2r;
+    a2i = x0i + c2 * t1i + c1 * t2i;
+    b1r = s1 * t3r + s2 * t4r;
+    b1i = s1 * t3i + s2 * t4i;
+    b2r = s2 * t3r - s1 * t4r;
+    b2i = s2 * t3i - s1 * t4i;
+    y1r = a1r + b1i;
+    y1i = a1i - b1r;
+    y4r = a1r - b1i;
+    y4i = a1i + b1r;
+    y2r = a2r + b2i;
+    y2i = a2i - b2r;
+    y3r = a2r - b2i;
+    y3i = a2i + b2r;
+    FFTN_TWIDDLE(y1r, y1i, FFTN_W(&wr[0], bcast), FFTN_W(&wi[0], bcast));
+    FFTN_TWIDDLE(y2r, y2i, FFTN_W(&wr[sw], bcast), FFTN_W(&wi[sw], bcast));
+    FFTN_TWIDDLE(y3r, y3i,
+        FFTN_W(&wr[2 * sw], bcast), FFTN_W(&wi[2 * sw], bcast));
+    FFTN_TWIDDLE(y4r, y4i,
+        FFTN_W(&wr[3 * sw], bcast), FFTN_W(&wi[3 * sw], bcast));
+    FFTN_ST(&br[0], x0r + t1r + t2r);
+    FFTN_ST(&bi[0], x0i + t1i + t2i);
+    FFTN_ST(&br[sb], y1r);
+    FFTN_ST(&bi[sb], y1i);
+    FFTN_ST(&br[2 * sb], y2r);
+    FFTN_ST(&bi[2 * sb], y2i);
+    FFTN_ST(&br[3 * sb], y3r);
+    FFTN_ST(&bi[3 * sb], y3i);
+    FFTN_ST(&br[4 * sb], y4r);
+    FFTN_ST(&bi[4 * sb], y4i);
+    return;
+}
+
+/*
+ * A butterfly of any other radix p computes the DFT of length p
+ * directly, using the p-th roots of unity c, real parts then imaginary
+ * parts.
+ */
+
+FFTN_BUTTERFLY(fftn_bfg)
+{
+    const FFTN_R *restrict cr = &c[0];
+    const FFTN_R *restrict ci = &c[p];
+    FFTN_T xr, xi, yr, yi;
+    size_t q, r, m;
+    for (q = 0; q < p; q++) {
+        yr = FFTN_LD(&ar[0]);
+        yi = FFTN_LD(&ai[0]);
+        m = 0;
+        for (r = 1; r < p; r++) {
+            m += q;
+            if (m >= p) {
+                m -= p;
+            }
+            xr = FFTN_LD(&ar[r * sa]);
+            xi = FFTN_LD(&ai[r * sa]);
+            yr += xr * cr[m] - xi * ci[m];
+            yi += xr * ci[m] + xi * cr[m];
+        }
+        if (q > 0) {
+            FFTN_TWIDDLE(yr, yi,
+                FFTN_W(&wr[(q - 1) * sw], bcast),
+                FFTN_W(&wi[(q - 1) * sw], bcast));
+        }
+        FFTN_ST(&br[q * sb], yr);
+        FFTN_ST(&bi[q * sb], yi);
+    }
+    return;
+}
+
+#undef FFTN_BUTTERFLY
+
+/*
+ * Passes
+ */
+
+#define FFTN_PASS(NAME, BF)                                                 \
+        static FFTN_TARGET void                                             \
+        FFTN_NAME(NAME)(const size_t p, const size_t ido, const size_t l1,  \
+            const size_t nb,                                                \
+            const FFTN_R *restrict ar, const FFTN_R *restrict ai,           \
+            FFTN_R *restrict br, FFTN_R *restrict bi,                       \
+            const FFTN_R *restrict w)                                       \
+        {                                                                   \
+            const FFTN_R *restrict wr = &w[0];                              \
+            const FFTN_R *restrict wi = &w[(p - 1) * ido];                  \
+            const FFTN_R *restrict c = &w[2 * (p - 1) * ido];               \
+            size_t i, j, k, a, b, s;                                        \
+            if (nb == 1) {                                                  \
+                for (k = 0; k < l1; k++) {                                  \
+                    for (j = 0; j < ido; j += FFTN_LANES) {                 \
+                        i = (j + FFTN_LANES > ido) ? ido - FFTN_LANES : j;  \
+                        a = ido * (p * k) + i;                              \
+                        b = ido * k + i;                                    \
+                        FFTN_NAME(BF)(p, &ar[a], &ai[a], ido,               \
+                            &br[b], &bi[b], ido * l1,                       \
+                            &wr[i], &wi[i], ido, c, 0);                     \
+                    }                                                       \
+                }                                                           \
+            } else {                                                        \
+                for (k = 0; k < l1; k++) {                                  \
+                    for (i = 0; i < ido; i++) {                             \
+                        for (j = 0; j < nb; j += FFTN_LANES) {              \
+                            s = (j + FFTN_LANES > nb) ? nb - FFTN_LANES : j;\
+                            a = nb * (ido * (p * k) + i) + s;               \
+                            b = nb * (ido * k + i) + s;                     \
+                            FFTN_NAME(BF)(p, &ar[a], &ai[a], nb * ido,      \
+                                &br[b], &bi[b], nb * ido * l1,              \
+                                &wr[i], &wi[i], ido, c, 1);                 \
+                        }                                                   \
+                    }                                                       \
+                }                                                           \
+            }                                                               \
+            return;                                                         \
+        }
+
+FFTN_PASS(fftn_pass2, fftn_bf2)
+FFTN_PASS(fftn_pass3, fftn_bf3)
+FFTN_PASS(fftn_pass4, fftn_bf4)
+FFTN_PASS(fftn_pass5, fftn_bf5)
+FFTN_PASS(fftn_passg, fftn_bfg)
+
+#undef FFTN_PASS
+
+static FFTN_TARGET void
+FFTN_NAME(fftn_pass)(const size_t p, const size_t ido, const size_t l1,
+    const size_t nb,
+    const FFTN_R *restrict ar, const FFTN_R *restrict ai,
+    FFTN_R *restrict br, FFTN_R *restrict bi,
+    const FFTN_R *restrict w)
+{
+    switch (p) {
+        case 2:
+            FFTN_NAME(fftn_pass2)(2, ido, l1, nb, ar, ai, br, bi, w);
+            break;
+        case 3:
+            FFTN_NAME(fftn_pass3)(3, ido, l1, nb, ar, ai, br, bi, w);
+            break;
+        case 4:
+            FFTN_NAME(fftn_pass4)(4, ido, l1, nb, ar, ai, br, bi, w);
+            break;
+        case 5:
+            FFTN_NAME(fftn_pass5)(5, ido, l1, nb, ar, ai, br, bi, w);
+            break;
+        default:
+            FFTN_NAME(fftn_passg)(p, ido, l1, nb, ar, ai, br, bi, w);
+    }
+    return;
+}
+
+#undef FFTN_W
+#undef FFTN_TWIDDLE
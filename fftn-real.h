@@ -0,0 +1,251 @@
+/* Copyright 2013-2016, Mansour Moufid <mansourmoufid@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Precision-generic parts of the native FFT.
+ *
+ * This file is included by fftn.c once per precision, after the passes
+ * of that precision, with the following macros defined:
+ *
+ *   FFTN_R         the real type, float or double
+ *   FFTN_C         the complex type of FFTN_R
+ *   FFTN_RNAME(x)  the name x with the precision suffix
+ *
+ * The kernels of the precision are those of fftn_isa in the array
+ * FFTN_RNAME(kernels), of type struct FFTN_RNAME(fftn_kernel).
+ */
+
+static void
+FFTN_RNAME(fftn_stages_init)(FFTN_R *restrict w, const size_t m)
+{
+    const double tpi = 6.28318530717958647692528676655900577;
+    size_t factors[FFTN_FACTORS_MAX];
+    size_t i, j, q, nf, p, l1, ido;
+    double a;
+    nf = fftn_factor(m, factors);
+    l1 = 1;
+    for (i = 0; i < nf; i++) {
+        p = factors[i];
+        ido = m / (l1 * p);
+        for (q = 1; q < p; q++) {
+            for (j = 0; j < ido; j++) {
+                a = -tpi * (double) ((j * q) % (ido * p)) / (double) (ido * p);
+                w[(q - 1) * ido + j] = (FFTN_R) cos(a);
+                w[(p - 1) * ido + (q - 1) * ido + j] = (FFTN_R) sin(a);
+            }
+        }
+        if (p > 5) {
+            for (q = 0; q < p; q++) {
+                a = -tpi * (double) q / (double) p;
+                w[2 * (p - 1) * ido + q] = (FFTN_R) cos(a);
+                w[2 * (p - 1) * ido + p + q] = (FFTN_R) sin(a);
+            }
+        }
+        w += fftn_stage_size(p, ido);
+        l1 *= p;
+    }
+    return;
+}
+
+static const struct FFTN_RNAME(fftn_kernel) *
+FFTN_RNAME(fftn_kernel)(const struct fftn_isa *isa, const size_t n)
+{
+    const struct FFTN_RNAME(fftn_kernel) *kernel;
+    kernel = &(isa->FFTN_RNAME(kernels)[0]);
+    while (kernel->lanes > n) {
+        kernel++;
+    }
+    assert(kernel->pass != NULL);
+    return kernel;
+}
+
+/*
+ * The matrix is copied by tiles of FFTN_TILE_ROWS rows of
+ * FFTN_TILE_COLS points, a row at a time.  A tile writes to few enough
+ * lines of the transpose that they stay in cache even when its rows
+ * are a power of two apart and fall in the same sets, as they do for
+ * transforms of a power of two length.
+ */
+static void
+FFTN_RNAME(fftn_transpose)(const size_t rows, const size_t cols,
+    const FFTN_R *restrict ar, const FFTN_R *restrict ai,
+    FFTN_R *restrict br, FFTN_R *restrict bi)
+{
+    size_t i, j, i0, j0, i1, j1;
+    for (i0 = 0; i0 < rows; i0 = i1) {
+        i1 = (rows - i0 < FFTN_TILE_ROWS) ? rows : i0 + FFTN_TILE_ROWS;
+        for (j0 = 0; j0 < cols; j0 = j1) {
+            j1 = (cols - j0 < FFTN_TILE_COLS) ? cols : j0 + FFTN_TILE_COLS;
+            for (i = i0; i < i1; i++) {
+                for (j = j0; j < j1; j++) {
+                    br[j * rows + i] = ar[i * cols + j];
+                    bi[j * rows + i] = ai[i * cols + j];
+                }
+            }
+        }
+    }
+    return;
+}
+
+/*
+ * Transform the nb interleaved sequences of m points (re[0], im[0]),
+ * point j of sequence b at j nb + b, using the arrays (re[1], im[1])
+ * as work space, and return the index of the pair holding the result.
+ *
+ * The passes of a batch run across its sequences.  For a single
+ * sequence, the rows of the first passes are long, and the rows of
+ * the last passes are short;  once the rows are shorter than the
+ * widest kernel, the l1 blocks, which are independent transforms of
+ * length m / l1, are transposed so that the remaining passes run
+ * across the blocks.  The result is then in natural order, with no
+ * transposition back.
+ */
+static size_t
+FFTN_RNAME(fftn_cfft_passes)(const size_t m, const size_t nb,
+    const FFTN_R *restrict w, FFTN_R *re[2], FFTN_R *im[2])
+{
+    const struct fftn_isa *isa;
+    const struct FFTN_RNAME(fftn_kernel) *kernel;
+    size_t factors[FFTN_FACTORS_MAX];
+    size_t i, nf, p, l1, ido, nt, a;
+    assert(nb > 0);
+    isa = fftn_isa();
+    nf = fftn_factor(m, factors);
+    l1 = 1;
+    nt = 1;
+    a = 0;
+    for (i = 0; i < nf; i++) {
+        p = factors[i];
+        ido = m / (l1 * p);
+        if (nb * nt == 1 && ido < isa->FFTN_RNAME(kernels)[0].lanes
+                && l1 > ido) {
+            FFTN_RNAME(fftn_transpose)(l1, m / l1,
+                re[a], im[a], re[1 - a], im[1 - a]);
+            a = 1 - a;
+            nt = l1;
+        }
+        kernel = FFTN_RNAME(fftn_kernel)(isa, (nb * nt == 1) ? ido : nb * nt);
+        (*kernel->pass)(p, ido, l1 / nt, nb * nt,
+            re[a], im[a], re[1 - a], im[1 - a], w);
+        w += fftn_stage_size(p, ido);
+        l1 *= p;
+        a = 1 - a;
+    }
+    return a;
+}
+
+/*
+ * The factors of the split step of the even length n, exp(-2 pi i k /
+ * n) for k < n / 2, real parts then imaginary parts.
+ */
+static void
+FFTN_RNAME(fftn_split_init)(FFTN_R *restrict w, const size_t n)
+{
+    const double tpi = 6.28318530717958647692528676655900577;
+    size_t k, m;
+    double a;
+    assert(n % 2 == 0);
+    m = n / 2;
+    for (k = 0; k < m; k++) {
+        a = -tpi * (double) k / (double) n;
+        w[k] = (FFTN_R) cos(a);
+        w[m + k] = (FFTN_R) sin(a);
+    }
+    return;
+}
+
+/*
+ * Point k of z is at k zs, and coefficient k of y at k ys.
+ */
+static void
+FFTN_RNAME(fftn_split)(const size_t m,
+    const FFTN_R *restrict er, const FFTN_R *restrict ei,
+    const FFTN_R *restrict zr, const FFTN_R *restrict zi, const size_t zs,
+    FFTN_C *restrict y, const size_t ys)
+{
+    FFTN_R ar, ai, br, bi, hr, hi, dr, di;
+    size_t k;
+    y[0].real = zr[0] + zi[0];
+    y[0].imag = (FFTN_R) 0;
+    y[m * ys].real = zr[0] - zi[0];
+    y[m * ys].imag = (FFTN_R) 0;
+    for (k = 1; k < m; k++) {
+        ar = zr[k * zs];
+        ai = zi[k * zs];
+        br = zr[(m - k) * zs];
+        bi = -zi[(m - k) * zs];
+        hr = (FFTN_R) 0.5 * (ar + br);
+        hi = (FFTN_R) 0.5 * (ai + bi);
+        dr = (FFTN_R) 0.5 * (ai - bi);
+        di = (FFTN_R) 0.5 * (br - ar);
+        y[k * ys].real = hr + er[k] * dr - ei[k] * di;
+        y[k * ys].imag = hi + er[k] * di + ei[k] * dr;
+    }
+    return;
+}
+
+static void
+FFTN_RNAME(fftn_unsplit)(const size_t m,
+    const FFTN_R *restrict er, const FFTN_R *restrict ei,
+    const FFTN_C *restrict y, const size_t ys, const FFTN_R scale,
+    FFTN_R *restrict zr, FFTN_R *restrict zi, const size_t zs)
+{
+    FFTN_R ar, ai, br, bi, hr, hi, dr, di, qr, qi;
+    size_t k;
+    for (k = 0; k < m; k++) {
+        ar = y[k * ys].real;
+        ai = y[k * ys].imag;
+        br = y[(m - k) * ys].real;
+        bi = -y[(m - k) * ys].imag;
+        hr = ar + br;
+        hi = ai + bi;
+        dr = ar - br;
+        di = ai - bi;
+        qr = dr * er[k] + di * ei[k];
+        qi = di * er[k] - dr * ei[k];
+        zr[k * zs] = scale * (hr - qi);
+        zi[k * zs] = scale * (hi + qr);
+    }
+    return;
+}
+
+/*
+ * Direct correlation
+ */
+
+size_t
+FFTN_RNAME(fftn_lanes)(void)
+{
+    return fftn_isa()->FFTN_RNAME(kernels)[0].lanes;
+}
+
+/*
+ * Compute the na - nb + 1 outputs z[k] = sum(a[k + t] b[t], t = 0 ...
+ * nb - 1).
+ */
+void
+FFTN_RNAME(fftn_correlate)(const FFTN_R *restrict a, const size_t na,
+    const FFTN_R *restrict b, const size_t nb, FFTN_R *restrict z)
+{
+    size_t nz;
+    assert(a != NULL);
+    assert(b != NULL);
+    assert(z != NULL);
+    assert(nb > 0);
+    assert(na >= nb);
+    nz = na - nb + 1;
+    (*FFTN_RNAME(fftn_kernel)(fftn_isa(), nz)->corr)(a, b, nb, z, nz);
+    return;
+}
@@ -0,0 +1,1332 @@
+/* Copyright 2013-2016, Mansour Moufid <mansourmoufid@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stddef.h>
+
+#include "fftn.h"
+#include "pool.h"
+#include "udsp.h"
+
+/*
+ * Native fast Fourier transform
+ *
+ * A real FFT of even length n is computed as a complex FFT of length
+ * n / 2 of the even and odd samples, followed by a split step;  a real
+ * FFT of odd length n is computed as a complex FFT of length n.  The
+ * complex FFT is a self-sorting mixed-radix (Stockham) algorithm on
+ * arrays of separate real and imaginary parts, with radix 4, 2, 3 and 5
+ * passes and a direct DFT pass for other prime factors.
+ *
+ * The passes are compiled once per instruction set, using the vector
+ * extensions of the compiler, and chosen at run time by CPUID.
+ */
+
+#define FFTN_CAT(a, b) a ## b
+#define FFTN_XCAT(a, b) FFTN_CAT(a, b)
+#define FFTN_NAME(x) FFTN_XCAT(x, FFTN_SUFFIX)
+#define FFTN_RNAME(x) FFTN_XCAT(x, FFTN_RSUFFIX)
+
+typedef void (*fftn_pass_t)(const size_t, const size_t, const size_t,
+    const size_t, const float *restrict, const float *restrict,
+    float *restrict, float *restrict,
+    const float *restrict);
+
+typedef void (*fftn_corr_t)(const float *restrict, const float *restrict,
+    const size_t, float *restrict, const size_t);
+
+typedef void (*fftn_pass_d_t)(const size_t, const size_t, const size_t,
+    const size_t, const double *restrict, const double *restrict,
+    double *restrict, double *restrict,
+    const double *restrict);
+
+typedef void (*fftn_corr_d_t)(const double *restrict, const double *restrict,
+    const size_t, double *restrict, const size_t);
+
+struct fftn_kernel {
+    size_t lanes;
+    fftn_pass_t pass;
+    fftn_corr_t corr;
+};
+
+struct fftn_kernel_d {
+    size_t lanes;
+    fftn_pass_d_t pass;
+    fftn_corr_d_t corr;
+};
+
+struct fftn_isa {
+    const char *name;
+    struct fftn_kernel kernels[4];
+    struct fftn_kernel_d kernels_d[4];
+};
+
+/*
+ * The kernels of single precision, with lanes of 4, 8 and 16 floats,
+ * and of double precision, with lanes of 2, 4 and 8 doubles.
+ */
+
+#define FFTN_R float
+
+#define FFTN_T float
+#define FFTN_LANES 1
+#define FFTN_LD(p) (*(p))
+#define FFTN_ST(p, x) (*(p) = (x))
+#define FFTN_TARGET
+#define FFTN_SUFFIX _scalar
+#include "fftn-pass.h"
+#include "fftn-corr.h"
+#undef FFTN_T
+#undef FFTN_LANES
+#undef FFTN_LD
+#undef FFTN_ST
+#undef FFTN_TARGET
+#undef FFTN_SUFFIX
+
+#if defined(__GNUC__)
+
+#define FFTN_DEFINE_VECTOR(R, T, TU, BYTES)                         \
+        typedef R T __attribute__((vector_size(BYTES)));            \
+        typedef R TU                                                \
+            __attribute__((vector_size(BYTES), aligned(sizeof(R))));
+
+FFTN_DEFINE_VECTOR(float, fftn_v4, fftn_v4u, 16)
+
+#define FFTN_T fftn_v4
+#define FFTN_LANES 4
+#define FFTN_LD(p) (*(const fftn_v4u *) (p))
+#define FFTN_ST(p, x) (*(fftn_v4u *) (p) = (x))
+#define FFTN_TARGET
+#define FFTN_SUFFIX _v4
+#include "fftn-pass.h"
+#include "fftn-corr.h"
+#undef FFTN_T
+#undef FFTN_LANES
+#undef FFTN_LD
+#undef FFTN_ST
+#undef FFTN_TARGET
+#undef FFTN_SUFFIX
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#define FFTN_X86 1
+
+FFTN_DEFINE_VECTOR(float, fftn_v8, fftn_v8u, 32)
+
+#define FFTN_T fftn_v8
+#define FFTN_LANES 8
+#define FFTN_LD(p) (*(const fftn_v8u *) (p))
+#define FFTN_ST(p, x) (*(fftn_v8u *) (p) = (x))
+#define FFTN_TARGET __attribute__((target("avx2")))
+#define FFTN_SUFFIX _avx2
+#include "fftn-pass.h"
+#include "fftn-corr.h"
+#undef FFTN_T
+#undef FFTN_LANES
+#undef FFTN_LD
+#undef FFTN_ST
+#undef FFTN_TARGET
+#undef FFTN_SUFFIX
+
+FFTN_DEFINE_VECTOR(float, fftn_v16, fftn_v16u, 64)
+
+#define FFTN_T fftn_v16
+#define FFTN_LANES 16
+#define FFTN_LD(p) (*(const fftn_v16u *) (p))
+#define FFTN_ST(p, x) (*(fftn_v16u *) (p) = (x))
+#define FFTN_TARGET __attribute__((target("avx512f")))
+#define FFTN_SUFFIX _avx512
+#include "fftn-pass.h"
+#include "fftn-corr.h"
+#undef FFTN_T
+#undef FFTN_LANES
+#undef FFTN_LD
+#undef FFTN_ST
+#undef FFTN_TARGET
+#undef FFTN_SUFFIX
+
+#endif
+
+#endif
+
+#undef FFTN_R
+
+#define FFTN_R double
+
+#define FFTN_T double
+#define FFTN_LANES 1
+#define FFTN_LD(p) (*(p))
+#define FFTN_ST(p, x) (*(p) = (x))
+#define FFTN_TARGET
+#define FFTN_SUFFIX _scalar_d
+#include "fftn-pass.h"
+#include "fftn-corr.h"
+#undef FFTN_T
+#undef FFTN_LANES
+#undef FFTN_LD
+#undef FFTN_ST
+#undef FFTN_TARGET
+#undef FFTN_SUFFIX
+
+#if defined(__GNUC__)
+
+FFTN_DEFINE_VECTOR(double, fftn_v2d, fftn_v2du, 16)
+
+#define FFTN_T fftn_v2d
+#define FFTN_LANES 2
+#define FFTN_LD(p) (*(const fftn_v2du *) (p))
+#define FFTN_ST(p, x) (*(fftn_v2du *) (p) = (x))
+#define FFTN_TARGET
+#define FFTN_SUFFIX _v2d
+#include "fftn-pass.h"
+#include "fftn-corr.h"
+#undef FFTN_T
+#undef FFTN_LANES
+#undef FFTN_LD
+#undef FFTN_ST
+#undef FFTN_TARGET
+#undef FFTN_SUFFIX
+
+#if defined(FFTN_X86)
+
+FFTN_DEFINE_VECTOR(double, fftn_v4d, fftn_v4du, 32)
+
+#define FFTN_T fftn_v4d
+#define FFTN_LANES 4
+#define FFTN_LD(p) (*(const fftn_v4du *) (p))
+#define FFTN_ST(p, x) (*(fftn_v4du *) (p) = (x))
+#define FFTN_TARGET __attribute__((target("avx2")))
+#define FFTN_SUFFIX _avx2_d
+#include "fftn-pass.h"
+#include "fftn-corr.h"
+#undef FFTN_T
+#undef FFTN_LANES
+#undef FFTN_LD
+#undef FFTN_ST
+#undef FFTN_TARGET
+#undef FFTN_SUFFIX
+
+FFTN_DEFINE_VECTOR(double, fftn_v8d, fftn_v8du, 64)
+
+#define FFTN_T fftn_v8d
+#define FFTN_LANES 8
+#define FFTN_LD(p) (*(const fftn_v8du *) (p))
+#define FFTN_ST(p, x) (*(fftn_v8du *) (p) = (x))
+#define FFTN_TARGET __attribute__((target("avx512f")))
+#define FFTN_SUFFIX _avx512_d
+#include "fftn-pass.h"
+#include "fftn-corr.h"
+#undef FFTN_T
+#undef FFTN_LANES
+#undef FFTN_LD
+#undef FFTN_ST
+#undef FFTN_TARGET
+#undef FFTN_SUFFIX
+
+#endif
+
+#undef FFTN_DEFINE_VECTOR
+
+#endif
+
+#undef FFTN_R
+
+/*
+ * Each instruction set lists its kernels from the widest to the
+ * narrowest;  a pass uses the widest kernel not wider than its loop,
+ * and a correlation the widest not wider than its output.
+ */
+
+#if !defined(__GNUC__)
+static const struct fftn_isa fftn_isa_scalar = {
+    "scalar",
+    {
+        {1, &fftn_pass_scalar, &fftn_corr_scalar},
+        {0, NULL, NULL},
+    },
+    {
+        {1, &fftn_pass_scalar_d, &fftn_corr_scalar_d},
+        {0, NULL, NULL},
+    },
+};
+#else
+static const struct fftn_isa fftn_isa_v4 = {
+#if defined(FFTN_X86)
+    "sse2",
+#else
+    "simd",
+#endif
+    {
+        {4, &fftn_pass_v4, &fftn_corr_v4},
+        {1, &fftn_pass_scalar, &fftn_corr_scalar},
+        {0, NULL, NULL},
+    },
+    {
+        {2, &fftn_pass_v2d, &fftn_corr_v2d},
+        {1, &fftn_pass_scalar_d, &fftn_corr_scalar_d},
+        {0, NULL, NULL},
+    },
+};
+#endif
+
+#if defined(FFTN_X86)
+static const struct fftn_isa fftn_isa_avx2 = {
+    "avx2",
+    {
+        {8, &fftn_pass_avx2, &fftn_corr_avx2},
+        {4, &fftn_pass_v4, &fftn_corr_v4},
+        {1, &fftn_pass_scalar, &fftn_corr_scalar},
+        {0, NULL, NULL},
+    },
+    {
+        {4, &fftn_pass_avx2_d, &fftn_corr_avx2_d},
+        {2, &fftn_pass_v2d, &fftn_corr_v2d},
+        {1, &fftn_pass_scalar_d, &fftn_corr_scalar_d},
+        {0, NULL, NULL},
+    },
+};
+
+static const struct fftn_isa fftn_isa_avx512 = {
+    "avx512",
+    {
+        {16, &fftn_pass_avx512, &fftn_corr_avx512},
+        {8, &fftn_pass_avx2, &fftn_corr_avx2},
+        {4, &fftn_pass_v4, &fftn_corr_v4},
+        {1, &fftn_pass_scalar, &fftn_corr_scalar},
+    },
+    {
+        {8, &fftn_pass_avx512_d, &fftn_corr_avx512_d},
+        {4, &fftn_pass_avx2_d, &fftn_corr_avx2_d},
+        {2, &fftn_pass_v2d, &fftn_corr_v2d},
+        {1, &fftn_pass_scalar_d, &fftn_corr_scalar_d},
+    },
+};
+#endif
+
+static const struct fftn_isa *
+fftn_isa_select(void)
+{
+#if defined(FFTN_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return &fftn_isa_avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return &fftn_isa_avx2;
+    }
+#endif
+#if defined(__GNUC__)
+    return &fftn_isa_v4;
+#else
+    return &fftn_isa_scalar;
+#endif
+}
+
+/*
+ * The selection is the same in every thread, so a race to store it
+ * is harmless.
+ */
+static const struct fftn_isa *
+fftn_isa(void)
+{
+#if defined(__GNUC__)
+    static const struct fftn_isa *isa = NULL;
+    const struct fftn_isa *x;
+    x = __atomic_load_n(&isa, __ATOMIC_RELAXED);
+    if (x == NULL) {
+        x = fftn_isa_select();
+        __atomic_store_n(&isa, x, __ATOMIC_RELAXED);
+    }
+    return x;
+#else
+    return fftn_isa_select();
+#endif
+}
+
+const char *
+fftn_isa_name(void)
+{
+    return fftn_isa()->name;
+}
+
+/*
+ * Complex transform
+ */
+
+#define FFTN_FACTORS_MAX 64
+
+/* the tiles of a transposition, in points */
+#define FFTN_TILE_ROWS 64
+#define FFTN_TILE_COLS 8
+
+static size_t
+fftn_factor(size_t m, size_t factors[FFTN_FACTORS_MAX])
+{
+    size_t nf, p;
+    assert(m > 0);
+    nf = 0;
+    while (m % 4 == 0) {
+        factors[nf++] = 4;
+        m /= 4;
+    }
+    if (m % 2 == 0) {
+        factors[nf++] = 2;
+        m /= 2;
+    }
+    for (p = 3; m > 1; p += 2) {
+        if (p * p > m) {
+            p = m;
+        }
+        while (m % p == 0) {
+            factors[nf++] = p;
+            m /= p;
+        }
+    }
+    assert(nf <= FFTN_FACTORS_MAX);
+    return nf;
+}
+
+static inline size_t
+fftn_stage_size(const size_t p, const size_t ido)
+{
+    return 2 * (p - 1) * ido + ((p > 5) ? 2 * p : 0);
+}
+
+static size_t
+fftn_stages_size(const size_t m)
+{
+    size_t factors[FFTN_FACTORS_MAX];
+    size_t i, nf, l1, size;
+    nf = fftn_factor(m, factors);
+    size = 0;
+    l1 = 1;
+    for (i = 0; i < nf; i++) {
+        size += fftn_stage_size(factors[i], m / (l1 * factors[i]));
+        l1 *= factors[i];
+    }
+    return size;
+}
+
+/*
+ * The complex passes and the real split of each precision.
+ */
+
+#define FFTN_R float
+#define FFTN_C udsp_complex_t
+#define FFTN_RSUFFIX
+#include "fftn-real.h"
+#undef FFTN_R
+#undef FFTN_C
+#undef FFTN_RSUFFIX
+
+#define FFTN_R double
+#define FFTN_C udsp_complex_d_t
+#define FFTN_RSUFFIX _d
+#include "fftn-real.h"
+#undef FFTN_R
+#undef FFTN_C
+#undef FFTN_RSUFFIX
+
+/*
+ * Large transforms
+ *
+ * A transform of length m = n1 n2 too large for the cache is computed
+ * by the four-step algorithm.  Seen as n1 rows of n2 points, the input
+ * is transformed down its n2 columns, multiplied by the twiddle
+ * factors W^(k1 j2) of length m, and transformed along its n1 rows;
+ * point k2 of row k1 is then point k1 + n1 k2 of the result.
+ *
+ * The columns are transformed FFTN_LARGE_CHUNK at a time, gathered
+ * into scratch space as a batch, and written back in place.  The rows
+ * are likewise, but scattered to the other pair of arrays in the
+ * order of the result, which transposes the matrix by blocks.  The
+ * chunks are independent, and may be computed by the threads of a
+ * pool, each with its own scratch space.
+ *
+ * The twiddle factor of row k and column c0 + c of a chunk is the
+ * product of W^(k c0) and W^(k c), from a table of n1 rows of
+ * FFTN_LARGE_CHUNK entries.  The first factor is itself the product
+ * of W^(a n2) and W^b, for k c0 = a n2 + b mod m, from tables of n1
+ * and n2 entries.
+ */
+
+#define FFTN_LARGE_POINTS (1 << 16)
+#define FFTN_LARGE_CHUNK 16
+
+struct fftn_large {
+    size_t n1, n2;
+    const float *w1, *w2;
+    const float *hr, *hi, *lr, *li, *cr, *ci;
+    float *xr, *xi, *yr, *yi;
+    float *scratch;
+    size_t scratch_size;
+};
+
+/*
+ * Return n1, the largest factor of m at most the square root of m, or
+ * 0 if m is too small for the four-step algorithm or has no such
+ * factor of at least FFTN_LARGE_CHUNK.
+ */
+static size_t
+fftn_large_split(const size_t m)
+{
+    size_t n1;
+    if (m < FFTN_LARGE_POINTS) {
+        return 0;
+    }
+    n1 = (size_t) sqrt((double) m);
+    while (n1 * n1 > m) {
+        n1--;
+    }
+    for (; n1 >= FFTN_LARGE_CHUNK; n1--) {
+        if (m % n1 == 0) {
+            return n1;
+        }
+    }
+    return 0;
+}
+
+static size_t
+fftn_large_scratch(const size_t m)
+{
+    size_t n1, n2;
+    n1 = fftn_large_split(m);
+    if (n1 == 0) {
+        return 0;
+    }
+    n2 = m / n1;
+    return 4 * FFTN_LARGE_CHUNK * n2;
+}
+
+static size_t
+fftn_cfft_size(const size_t m)
+{
+    size_t n1, n2;
+    n1 = fftn_large_split(m);
+    if (n1 == 0) {
+        return fftn_stages_size(m);
+    }
+    n2 = m / n1;
+    return fftn_stages_size(n1) + fftn_stages_size(n2) + 2 * (n1 + n2)
+        + 2 * n1 * FFTN_LARGE_CHUNK;
+}
+
+static void
+fftn_cfft_init(float *restrict w, const size_t m)
+{
+    const double tpi = 6.28318530717958647692528676655900577;
+    size_t k, c, n1, n2;
+    double a;
+    n1 = fftn_large_split(m);
+    if (n1 == 0) {
+        fftn_stages_init(w, m);
+        return;
+    }
+    n2 = m / n1;
+    fftn_stages_init(w, n1);
+    w += fftn_stages_size(n1);
+    fftn_stages_init(w, n2);
+    w += fftn_stages_size(n2);
+    for (k = 0; k < n1; k++) {
+        a = -tpi * (double) k / (double) n1;
+        w[k] = (float) cos(a);
+        w[n1 + k] = (float) sin(a);
+    }
+    w += 2 * n1;
+    for (k = 0; k < n2; k++) {
+        a = -tpi * (double) k / (double) m;
+        w[k] = (float) cos(a);
+        w[n2 + k] = (float) sin(a);
+    }
+    w += 2 * n2;
+    for (k = 0; k < n1; k++) {
+        for (c = 0; c < FFTN_LARGE_CHUNK; c++) {
+            a = -tpi * (double) (k * c) / (double) m;
+            w[k * FFTN_LARGE_CHUNK + c] = (float) cos(a);
+            w[(n1 + k) * FFTN_LARGE_CHUNK + c] = (float) sin(a);
+        }
+    }
+    return;
+}
+
+static void
+fftn_large_columns(void *arg, const size_t i, const size_t worker)
+{
+    const struct fftn_large *t = arg;
+    const float *restrict tr, *restrict ti, *restrict sr, *restrict si;
+    float *restrict dr, *restrict di;
+    float *re[2], *im[2];
+    float *s;
+    size_t a, b, c, c0, nc, j, k, r;
+    float br, bi, xr, xi, wr, wi;
+    c0 = i * FFTN_LARGE_CHUNK;
+    nc = t->n2 - c0;
+    nc = (nc < FFTN_LARGE_CHUNK) ? nc : FFTN_LARGE_CHUNK;
+    s = &(t->scratch[worker * t->scratch_size]);
+    re[0] = &s[0];
+    im[0] = &s[t->n1 * nc];
+    re[1] = &s[2 * t->n1 * nc];
+    im[1] = &s[3 * t->n1 * nc];
+    for (j = 0; j < t->n1; j++) {
+        for (c = 0; c < nc; c++) {
+            re[0][j * nc + c] = t->xr[j * t->n2 + c0 + c];
+            im[0][j * nc + c] = t->xi[j * t->n2 + c0 + c];
+        }
+    }
+    r = fftn_cfft_passes(t->n1, nc, t->w1, re, im);
+    /* the exponent k c0 mod m, as a n2 + b */
+    a = 0;
+    b = 0;
+    for (k = 0; k < t->n1; k++) {
+        br = t->hr[a] * t->lr[b] - t->hi[a] * t->li[b];
+        bi = t->hr[a] * t->li[b] + t->hi[a] * t->lr[b];
+        tr = &(t->cr[k * FFTN_LARGE_CHUNK]);
+        ti = &(t->ci[k * FFTN_LARGE_CHUNK]);
+        sr = &re[r][k * nc];
+        si = &im[r][k * nc];
+        dr = &(t->xr[k * t->n2 + c0]);
+        di = &(t->xi[k * t->n2 + c0]);
+        for (c = 0; c < nc; c++) {
+            wr = br * tr[c] - bi * ti[c];
+            wi = br * ti[c] + bi * tr[c];
+            xr = sr[c];
+            xi = si[c];
+            dr[c] = xr * wr - xi * wi;
+            di[c] = xr * wi + xi * wr;
+        }
+        b += c0;
+        if (b >= t->n2) {
+            b -= t->n2;
+            a++;
+        }
+        if (a >= t->n1) {
+            a -= t->n1;
+        }
+    }
+    return;
+}
+
+static void
+fftn_large_rows(void *arg, const size_t i, const size_t worker)
+{
+    const struct fftn_large *t = arg;
+    float *re[2], *im[2];
+    float *s;
+    size_t q, q0, nq, j, r;
+    q0 = i * FFTN_LARGE_CHUNK;
+    nq = t->n1 - q0;
+    nq = (nq < FFTN_LARGE_CHUNK) ? nq : FFTN_LARGE_CHUNK;
+    s = &(t->scratch[worker * t->scratch_size]);
+    re[0] = &s[0];
+    im[0] = &s[t->n2 * nq];
+    re[1] = &s[2 * t->n2 * nq];
+    im[1] = &s[3 * t->n2 * nq];
+    for (q = 0; q < nq; q++) {
+        for (j = 0; j < t->n2; j++) {
+            re[0][j * nq + q] = t->xr[(q0 + q) * t->n2 + j];
+            im[0][j * nq + q] = t->xi[(q0 + q) * t->n2 + j];
+        }
+    }
+    r = fftn_cfft_passes(t->n2, nq, t->w2, re, im);
+    for (j = 0; j < t->n2; j++) {
+        for (q = 0; q < nq; q++) {
+            t->yr[j * t->n1 + q0 + q] = re[r][j * nq + q];
+            t->yi[j * t->n1 + q0 + q] = im[r][j * nq + q];
+        }
+    }
+    return;
+}
+
+static void
+fftn_large_run(udsp_pool_t *pool, pool_fn_t fn, struct fftn_large *t,
+    const size_t count)
+{
+    size_t i;
+    if (pool != NULL) {
+        pool_run(pool, fn, t, count);
+        return;
+    }
+    for (i = 0; i < count; i++) {
+        (*fn)(t, i, 0);
+    }
+    return;
+}
+
+static size_t
+fftn_large(const size_t m, const size_t n1, const float *restrict w,
+    float *re[2], float *im[2], float *scratch, udsp_pool_t *pool)
+{
+    struct fftn_large t;
+    t.n1 = n1;
+    t.n2 = m / n1;
+    t.w1 = w;
+    t.w2 = &(t.w1[fftn_stages_size(t.n1)]);
+    t.hr = &(t.w2[fftn_stages_size(t.n2)]);
+    t.hi = &(t.hr[t.n1]);
+    t.lr = &(t.hi[t.n1]);
+    t.li = &(t.lr[t.n2]);
+    t.cr = &(t.li[t.n2]);
+    t.ci = &(t.cr[t.n1 * FFTN_LARGE_CHUNK]);
+    t.xr = re[0];
+    t.xi = im[0];
+    t.yr = re[1];
+    t.yi = im[1];
+    t.scratch = scratch;
+    t.scratch_size = fftn_large_scratch(m);
+    fftn_large_run(pool, &fftn_large_columns, &t,
+        (t.n2 + FFTN_LARGE_CHUNK - 1) / FFTN_LARGE_CHUNK);
+    fftn_large_run(pool, &fftn_large_rows, &t,
+        (t.n1 + FFTN_LARGE_CHUNK - 1) / FFTN_LARGE_CHUNK);
+    return 1;
+}
+
+/*
+ * Transform as fftn_cfft_passes, by the four-step algorithm if m is
+ * large enough, in which case scratch must hold fftn_large_scratch(m)
+ * floats for each thread of the pool, or for one thread if pool is
+ * NULL.
+ */
+static size_t
+fftn_cfft(const size_t m, const size_t nb, const float *restrict w,
+    float *re[2], float *im[2], float *scratch, udsp_pool_t *pool)
+{
+    size_t n1;
+    n1 = (nb == 1) ? fftn_large_split(m) : 0;
+    if (n1 > 0) {
+        assert(scratch != NULL);
+        return fftn_large(m, n1, w, re, im, scratch, pool);
+    }
+    return fftn_cfft_passes(m, nb, w, re, im);
+}
+
+/*
+ * Real transform
+ */
+
+static inline size_t
+fftn_length(const size_t n)
+{
+    return (n % 2 == 0) ? n / 2 : n;
+}
+
+/*
+ * The complex transform of an even length uses four arrays of m
+ * points in the work space, array k at FFTN_ARRAY(m, k), each
+ * FFTN_STAGGER reals past the last, so that the same point of each
+ * array does not fall in the same cache sets when m is a power of
+ * two.  An odd length uses three arrays of n points, one of them the
+ * output.
+ */
+
+#define FFTN_STAGGER 16
+#define FFTN_ARRAY(m, k) ((k) * ((m) + FFTN_STAGGER))
+
+static inline size_t
+fftn_arrays_size(const size_t n)
+{
+    return (n % 2 == 0) ? FFTN_ARRAY(n / 2, 4) : 3 * n;
+}
+
+size_t
+fftn_weights_size(const size_t n)
+{
+    size_t m;
+    assert(n > 0);
+    m = fftn_length(n);
+    return fftn_cfft_size(m) + ((n % 2 == 0) ? 2 * m : 0);
+}
+
+void
+fftn_init(float *restrict w, const size_t n)
+{
+    size_t m;
+    assert(w != NULL);
+    assert(n > 0);
+    m = fftn_length(n);
+    fftn_cfft_init(w, m);
+    if (n % 2 == 0) {
+        fftn_split_init(&w[fftn_cfft_size(m)], n);
+    }
+    return;
+}
+
+size_t
+fftn_work_size(const size_t n)
+{
+    assert(n > 0);
+    return fftn_arrays_size(n) + fftn_large_scratch(fftn_length(n));
+}
+
+/*
+ * The scratch space of a large transform for each thread of a pool,
+ * in floats, or 0 if the transform of length n is not large.
+ */
+size_t
+fftn_large_size(const size_t n)
+{
+    assert(n > 0);
+    return fftn_large_scratch(fftn_length(n));
+}
+
+/*
+ * Compute the first n / 2 + 1 coefficients of the FFT of the n samples
+ * x into y.  The array work must hold fftn_work_size(n) floats.  The
+ * arrays x and y may be the same;  for odd n, y is also used as work
+ * space.
+ */
+void
+fftn_forward(const size_t n, const float *restrict w,
+    const float *x, udsp_complex_t *y,
+    float *restrict work)
+{
+    assert(n > 0);
+    fftn_forward_pool(n, w, x, y, work, NULL, &work[fftn_arrays_size(n)]);
+    return;
+}
+
+/*
+ * As fftn_forward, computing a large transform on the threads of pool
+ * with the scratch space of fftn_large_size(n) floats per thread;  the
+ * array work need not hold that of fftn_forward.
+ */
+void
+fftn_forward_pool(const size_t n, const float *restrict w,
+    const float *x, udsp_complex_t *y,
+    float *restrict work, udsp_pool_t *pool, float *restrict scratch)
+{
+    float *re[2], *im[2];
+    float *yf;
+    size_t k, m, r;
+    assert(n > 0);
+    assert(w != NULL);
+    assert(x != NULL);
+    assert(y != NULL);
+    assert(work != NULL);
+    m = fftn_length(n);
+    if (n % 2 == 0) {
+        re[0] = &work[FFTN_ARRAY(m, 0)];
+        im[0] = &work[FFTN_ARRAY(m, 1)];
+        re[1] = &work[FFTN_ARRAY(m, 2)];
+        im[1] = &work[FFTN_ARRAY(m, 3)];
+        for (k = 0; k < m; k++) {
+            re[0][k] = x[2 * k];
+            im[0][k] = x[2 * k + 1];
+        }
+        r = fftn_cfft(m, 1, w, re, im, scratch, pool);
+        fftn_split(m, &w[fftn_cfft_size(m)], &w[fftn_cfft_size(m) + m],
+            re[r], im[r], 1, y, 1);
+    } else {
+        yf = (float *) &y[0];
+        re[0] = &work[0];
+        im[0] = &work[n];
+        re[1] = yf;
+        im[1] = &work[2 * n];
+        for (k = 0; k < n; k++) {
+            re[0][k] = x[k];
+            im[0][k] = 0.f;
+        }
+        r = fftn_cfft(m, 1, w, re, im, scratch, pool);
+        /* descending, so that the real parts in y are read first */
+        for (k = n / 2 + 1; k-- > 0;) {
+            y[k].imag = im[r][k];
+            y[k].real = re[r][k];
+        }
+    }
+    return;
+}
+
+/*
+ * Compute the n samples of the inverse FFT, divided by n, of the
+ * n / 2 + 1 coefficients y into x.  The array work must hold
+ * fftn_work_size(n) floats.  The arrays y and x may be the same;  for
+ * odd n, x is also used as work space.
+ *
+ * The inverse transform is the forward transform with the real and
+ * imaginary parts exchanged on input and output.
+ */
+void
+fftn_backward(const size_t n, const float *restrict w,
+    const udsp_complex_t *y, float *x,
+    float *restrict work)
+{
+    assert(n > 0);
+    fftn_backward_pool(n, w, y, x, work, NULL, &work[fftn_arrays_size(n)]);
+    return;
+}
+
+void
+fftn_backward_pool(const size_t n, const float *restrict w,
+    const udsp_complex_t *y, float *x,
+    float *restrict work, udsp_pool_t *pool, float *restrict scratch)
+{
+    float *re[2], *im[2];
+    size_t k, m, r;
+    float scale;
+    assert(n > 0);
+    assert(w != NULL);
+    assert(y != NULL);
+    assert(x != NULL);
+    assert(work != NULL);
+    m = fftn_length(n);
+    scale = 1.f / (float) n;
+    if (n % 2 == 0) {
+        re[0] = &work[FFTN_ARRAY(m, 0)];
+        im[0] = &work[FFTN_ARRAY(m, 1)];
+        re[1] = &work[FFTN_ARRAY(m, 2)];
+        im[1] = &work[FFTN_ARRAY(m, 3)];
+        fftn_unsplit(m, &w[fftn_cfft_size(m)], &w[fftn_cfft_size(m) + m],
+            y, 1, scale, im[0], re[0], 1);
+        r = fftn_cfft(m, 1, w, re, im, scratch, pool);
+        for (k = 0; k < m; k++) {
+            x[2 * k] = im[r][k];
+            x[2 * k + 1] = re[r][k];
+        }
+    } else {
+        re[0] = &work[0];
+        im[0] = &work[n];
+        re[1] = &work[2 * n];
+        im[1] = x;
+        re[0][0] = scale * y[0].imag;
+        im[0][0] = scale * y[0].real;
+        for (k = 1; k <= n / 2; k++) {
+            re[0][k] = scale * y[k].imag;
+            im[0][k] = scale * y[k].real;
+            re[0][n - k] = -scale * y[k].imag;
+            im[0][n - k] = scale * y[k].real;
+        }
+        r = fftn_cfft(m, 1, w, re, im, scratch, pool);
+        if (im[r] != x) {
+            for (k = 0; k < n; k++) {
+                x[k] = im[r][k];
+            }
+        }
+    }
+    return;
+}
+
+/*
+ * Batches
+ *
+ * The transforms of a batch are interleaved in the work space, so that
+ * every pass runs across them.  Sample k of transform b of x is at
+ * b xd + k xs, and coefficient k of transform b of y at b yd + k ys.
+ *
+ * A wide batch is computed in chunks of about FFTN_BATCH_POINTS
+ * points, which keeps the interleaved work space in cache.  A batch
+ * narrower than the widest kernel, or of transforms too long for a
+ * chunk of that width, is computed one transform at a time;  the
+ * passes of a long transform run along its rows anyway.
+ */
+
+#define FFTN_BATCH_POINTS 16384
+
+static size_t
+fftn_batch_chunk(const size_t n, const size_t nb)
+{
+    size_t lanes, c;
+    lanes = fftn_isa()->kernels[0].lanes;
+    c = FFTN_BATCH_POINTS / n;
+    if (nb < lanes || c < lanes) {
+        return 1;
+    }
+    return (c < nb) ? c : nb;
+}
+
+size_t
+fftn_batch_work_size(const size_t n, const size_t nb)
+{
+    assert(n > 0);
+    assert(nb > 0);
+    return ((n % 2 == 0) ? 2 * n : 4 * n) * nb
+        + fftn_large_scratch(fftn_length(n));
+}
+
+static void
+fftn_forward_chunk(const size_t n, const size_t nb, const float *restrict w,
+    const float *restrict x, const size_t xs, const size_t xd,
+    udsp_complex_t *restrict y, const size_t ys, const size_t yd,
+    float *restrict work)
+{
+    float *re[2], *im[2];
+    size_t b, k, m, r;
+    assert(n > 0);
+    assert(nb > 0);
+    assert(w != NULL);
+    assert(x != NULL);
+    assert(y != NULL);
+    assert(work != NULL);
+    m = fftn_length(n);
+    re[0] = &work[0];
+    im[0] = &work[m * nb];
+    re[1] = &work[2 * m * nb];
+    im[1] = &work[3 * m * nb];
+    if (n % 2 == 0) {
+        for (b = 0; b < nb; b++) {
+            for (k = 0; k < m; k++) {
+                re[0][k * nb + b] = x[b * xd + (2 * k) * xs];
+                im[0][k * nb + b] = x[b * xd + (2 * k + 1) * xs];
+            }
+        }
+        r = fftn_cfft(m, nb, w, re, im, &work[4 * m * nb], NULL);
+        for (b = 0; b < nb; b++) {
+            fftn_split(m,
+                &w[fftn_cfft_size(m)], &w[fftn_cfft_size(m) + m],
+                &re[r][b], &im[r][b], nb, &y[b * yd], ys);
+        }
+    } else {
+        for (b = 0; b < nb; b++) {
+            for (k = 0; k < n; k++) {
+                re[0][k * nb + b] = x[b * xd + k * xs];
+                im[0][k * nb + b] = 0.f;
+            }
+        }
+        r = fftn_cfft(m, nb, w, re, im, &work[4 * m * nb], NULL);
+        for (b = 0; b < nb; b++) {
+            for (k = 0; k <= n / 2; k++) {
+                y[b * yd + k * ys].real = re[r][k * nb + b];
+                y[b * yd + k * ys].imag = im[r][k * nb + b];
+            }
+        }
+    }
+    return;
+}
+
+static void
+fftn_backward_chunk(const size_t n, const size_t nb, const float *restrict w,
+    const udsp_complex_t *restrict y, const size_t ys, const size_t yd,
+    float *restrict x, const size_t xs, const size_t xd,
+    float *restrict work)
+{
+    float *re[2], *im[2];
+    size_t b, k, m, r;
+    float scale;
+    assert(n > 0);
+    assert(nb > 0);
+    assert(w != NULL);
+    assert(y != NULL);
+    assert(x != NULL);
+    assert(work != NULL);
+    m = fftn_length(n);
+    scale = 1.f / (float) n;
+    re[0] = &work[0];
+    im[0] = &work[m * nb];
+    re[1] = &work[2 * m * nb];
+    im[1] = &work[3 * m * nb];
+    if (n % 2 == 0) {
+        for (b = 0; b < nb; b++) {
+            fftn_unsplit(m,
+                &w[fftn_cfft_size(m)], &w[fftn_cfft_size(m) + m],
+                &y[b * yd], ys, scale, &im[0][b], &re[0][b], nb);
+        }
+        r = fftn_cfft(m, nb, w, re, im, &work[4 * m * nb], NULL);
+        for (b = 0; b < nb; b++) {
+            for (k = 0; k < m; k++) {
+                x[b * xd + (2 * k) * xs] = im[r][k * nb + b];
+                x[b * xd + (2 * k + 1) * xs] = re[r][k * nb + b];
+            }
+        }
+    } else {
+        for (b = 0; b < nb; b++) {
+            re[0][b] = scale * y[b * yd].imag;
+            im[0][b] = scale * y[b * yd].real;
+            for (k = 1; k <= n / 2; k++) {
+                re[0][k * nb + b] = scale * y[b * yd + k * ys].imag;
+                im[0][k * nb + b] = scale * y[b * yd + k * ys].real;
+                re[0][(n - k) * nb + b] = -scale * y[b * yd + k * ys].imag;
+                im[0][(n - k) * nb + b] = scale * y[b * yd + k * ys].real;
+            }
+        }
+        r = fftn_cfft(m, nb, w, re, im, &work[4 * m * nb], NULL);
+        for (b = 0; b < nb; b++) {
+            for (k = 0; k < n; k++) {
+                x[b * xd + k * xs] = im[r][k * nb + b];
+            }
+        }
+    }
+    return;
+}
+
+void
+fftn_forward_batch(const size_t n, const size_t nb, const float *restrict w,
+    const float *restrict x, const size_t xs, const size_t xd,
+    udsp_complex_t *restrict y, const size_t ys, const size_t yd,
+    float *restrict work)
+{
+    size_t b, c, chunk;
+    assert(n > 0);
+    assert(nb > 0);
+    chunk = fftn_batch_chunk(n, nb);
+    for (b = 0; b < nb; b += c) {
+        c = (chunk < nb - b) ? chunk : nb - b;
+        fftn_forward_chunk(n, c, w, &x[b * xd], xs, xd,
+            &y[b * yd], ys, yd, work);
+    }
+    return;
+}
+
+void
+fftn_backward_batch(const size_t n, const size_t nb, const float *restrict w,
+    const udsp_complex_t *restrict y, const size_t ys, const size_t yd,
+    float *restrict x, const size_t xs, const size_t xd,
+    float *restrict work)
+{
+    size_t b, c, chunk;
+    assert(n > 0);
+    assert(nb > 0);
+    chunk = fftn_batch_chunk(n, nb);
+    for (b = 0; b < nb; b += c) {
+        c = (chunk < nb - b) ? chunk : nb - b;
+        fftn_backward_chunk(n, c, w, &y[b * yd], ys, yd,
+            &x[b * xd], xs, xd, work);
+    }
+    return;
+}
+
+/*
+ * Complex transform
+ *
+ * The complex transform of length n is the complex FFT of the real
+ * transform, on the points of x deinterleaved into the work space.
+ */
+
+size_t
+fftn_complex_weights_size(const size_t n)
+{
+    assert(n > 0);
+    return fftn_cfft_size(n);
+}
+
+void
+fftn_complex_init(float *restrict w, const size_t n)
+{
+    assert(w != NULL);
+    assert(n > 0);
+    fftn_cfft_init(w, n);
+    return;
+}
+
+size_t
+fftn_complex_work_size(const size_t n)
+{
+    assert(n > 0);
+    return 4 * n + fftn_large_scratch(n);
+}
+
+/*
+ * Compute the FFT of the n points x into y.  The array work must hold
+ * fftn_complex_work_size(n) floats.  The arrays x and y may be the
+ * same.
+ */
+void
+fftn_complex_forward(const size_t n, const float *restrict w,
+    const udsp_complex_t *x, udsp_complex_t *y, float *restrict work)
+{
+    float *re[2], *im[2];
+    size_t k, r;
+    assert(n > 0);
+    assert(w != NULL);
+    assert(x != NULL);
+    assert(y != NULL);
+    assert(work != NULL);
+    re[0] = &work[0];
+    im[0] = &work[n];
+    re[1] = &work[2 * n];
+    im[1] = &work[3 * n];
+    for (k = 0; k < n; k++) {
+        re[0][k] = x[k].real;
+        im[0][k] = x[k].imag;
+    }
+    r = fftn_cfft(n, 1, w, re, im, &work[4 * n], NULL);
+    for (k = 0; k < n; k++) {
+        y[k].real = re[r][k];
+        y[k].imag = im[r][k];
+    }
+    return;
+}
+
+/*
+ * Compute the inverse FFT, divided by n, of the n points y into x, as
+ * the forward transform with the real and imaginary parts exchanged.
+ */
+void
+fftn_complex_backward(const size_t n, const float *restrict w,
+    const udsp_complex_t *y, udsp_complex_t *x, float *restrict work)
+{
+    float *re[2], *im[2];
+    size_t k, r;
+    float scale;
+    assert(n > 0);
+    assert(w != NULL);
+    assert(y != NULL);
+    assert(x != NULL);
+    assert(work != NULL);
+    scale = 1.f / (float) n;
+    re[0] = &work[0];
+    im[0] = &work[n];
+    re[1] = &work[2 * n];
+    im[1] = &work[3 * n];
+    for (k = 0; k < n; k++) {
+        re[0][k] = scale * y[k].imag;
+        im[0][k] = scale * y[k].real;
+    }
+    r = fftn_cfft(n, 1, w, re, im, &work[4 * n], NULL);
+    for (k = 0; k < n; k++) {
+        x[k].real = im[r][k];
+        x[k].imag = re[r][k];
+    }
+    return;
+}
+
+/*
+ * Double precision
+ *
+ * A real transform in double precision is computed as in single
+ * precision, by the double kernels.  Its lengths are those of a state,
+ * so the complex transform is always computed by the passes alone.
+ */
+
+size_t
+fftn_weights_size_d(const size_t n)
+{
+    size_t m;
+    assert(n > 0);
+    m = fftn_length(n);
+    return fftn_stages_size(m) + ((n % 2 == 0) ? 2 * m : 0);
+}
+
+void
+fftn_init_d(double *restrict w, const size_t n)
+{
+    size_t m;
+    assert(w != NULL);
+    assert(n > 0);
+    m = fftn_length(n);
+    fftn_stages_init_d(w, m);
+    if (n % 2 == 0) {
+        fftn_split_init_d(&w[fftn_stages_size(m)], n);
+    }
+    return;
+}
+
+size_t
+fftn_work_size_d(const size_t n)
+{
+    assert(n > 0);
+    return fftn_arrays_size(n);
+}
+
+/*
+ * As fftn_forward, in double precision;  the array work must hold
+ * fftn_work_size_d(n) doubles.
+ */
+void
+fftn_forward_d(const size_t n, const double *restrict w,
+    const double *x, udsp_complex_d_t *y,
+    double *restrict work)
+{
+    double *re[2], *im[2];
+    double *yd;
+    size_t k, m, r;
+    assert(n > 0);
+    assert(w != NULL);
+    assert(x != NULL);
+    assert(y != NULL);
+    assert(work != NULL);
+    m = fftn_length(n);
+    if (n % 2 == 0) {
+        re[0] = &work[FFTN_ARRAY(m, 0)];
+        im[0] = &work[FFTN_ARRAY(m, 1)];
+        re[1] = &work[FFTN_ARRAY(m, 2)];
+        im[1] = &work[FFTN_ARRAY(m, 3)];
+        for (k = 0; k < m; k++) {
+            re[0][k] = x[2 * k];
+            im[0][k] = x[2 * k + 1];
+        }
+        r = fftn_cfft_passes_d(m, 1, w, re, im);
+        fftn_split_d(m, &w[fftn_stages_size(m)],
+            &w[fftn_stages_size(m) + m], re[r], im[r], 1, y, 1);
+    } else {
+        yd = (double *) &y[0];
+        re[0] = &work[0];
+        im[0] = &work[n];
+        re[1] = yd;
+        im[1] = &work[2 * n];
+        for (k = 0; k < n; k++) {
+            re[0][k] = x[k];
+            im[0][k] = 0.;
+        }
+        r = fftn_cfft_passes_d(m, 1, w, re, im);
+        /* descending, so that the real parts in y are read first */
+        for (k = n / 2 + 1; k-- > 0;) {
+            y[k].imag = im[r][k];
+            y[k].real = re[r][k];
+        }
+    }
+    return;
+}
+
+/*
+ * As fftn_backward, in double precision.
+ */
+void
+fftn_backward_d(const size_t n, const double *restrict w,
+    const udsp_complex_d_t *y, double *x,
+    double *restrict work)
+{
+    double *re[2], *im[2];
+    size_t k, m, r;
+    double scale;
+    assert(n > 0);
+    assert(w != NULL);
+    assert(y != NULL);
+    assert(x != NULL);
+    assert(work != NULL);
+    m = fftn_length(n);
+    scale = 1. / (double) n;
+    if (n % 2 == 0) {
+        re[0] = &work[FFTN_ARRAY(m, 0)];
+        im[0] = &work[FFTN_ARRAY(m, 1)];
+        re[1] = &work[FFTN_ARRAY(m, 2)];
+        im[1] = &work[FFTN_ARRAY(m, 3)];
+        fftn_unsplit_d(m, &w[fftn_stages_size(m)],
+            &w[fftn_stages_size(m) + m], y, 1, scale, im[0], re[0], 1);
+        r = fftn_cfft_passes_d(m, 1, w, re, im);
+        for (k = 0; k < m; k++) {
+            x[2 * k] = im[r][k];
+            x[2 * k + 1] = re[r][k];
+        }
+    } else {
+        re[0] = &work[0];
+        im[0] = &work[n];
+        re[1] = &work[2 * n];
+        im[1] = x;
+        re[0][0] = scale * y[0].imag;
+        im[0][0] = scale * y[0].real;
+        for (k = 1; k <= n / 2; k++) {
+            re[0][k] = scale * y[k].imag;
+            im[0][k] = scale * y[k].real;
+            re[0][n - k] = -scale * y[k].imag;
+            im[0][n - k] = scale * y[k].real;
+        }
+        r = fftn_cfft_passes_d(m, 1, w, re, im);
+        if (im[r] != x) {
+            for (k = 0; k < n; k++) {
+                x[k] = im[r][k];
+            }
+        }
+    }
+    return;
+}
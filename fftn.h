@@ -0,0 +1,69 @@
+/* Copyright 2013-2016, Mansour Moufid <mansourmoufid@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#if !defined(FFTN_H)
+#define FFTN_H
+
+#include <stddef.h>
+
+#include "pool.h"
+#include "udsp.h"
+
+size_t fftn_weights_size(const size_t);
+void fftn_init(float *restrict, const size_t);
+size_t fftn_work_size(const size_t);
+void fftn_forward(const size_t, const float *restrict,
+    const float *, udsp_complex_t *, float *restrict);
+void fftn_backward(const size_t, const float *restrict,
+    const udsp_complex_t *, float *, float *restrict);
+size_t fftn_large_size(const size_t);
+void fftn_forward_pool(const size_t, const float *restrict,
+    const float *, udsp_complex_t *, float *restrict,
+    udsp_pool_t *, float *restrict);
+void fftn_backward_pool(const size_t, const float *restrict,
+    const udsp_complex_t *, float *, float *restrict,
+    udsp_pool_t *, float *restrict);
+size_t fftn_batch_work_size(const size_t, const size_t);
+void fftn_forward_batch(const size_t, const size_t, const float *restrict,
+    const float *restrict, const size_t, const size_t,
+    udsp_complex_t *restrict, const size_t, const size_t,
+    float *restrict);
+void fftn_backward_batch(const size_t, const size_t, const float *restrict,
+    const udsp_complex_t *restrict, const size_t, const size_t,
+    float *restrict, const size_t, const size_t,
+    float *restrict);
+size_t fftn_complex_weights_size(const size_t);
+void fftn_complex_init(float *restrict, const size_t);
+size_t fftn_complex_work_size(const size_t);
+void fftn_complex_forward(const size_t, const float *restrict,
+    const udsp_complex_t *, udsp_complex_t *, float *restrict);
+void fftn_complex_backward(const size_t, const float *restrict,
+    const udsp_complex_t *, udsp_complex_t *, float *restrict);
+const char *fftn_isa_name(void);
+size_t fftn_lanes(void);
+void fftn_correlate(const float *restrict, const size_t,
+    const float *restrict, const size_t, float *restrict);
+size_t fftn_weights_size_d(const size_t);
+void fftn_init_d(double *restrict, const size_t);
+size_t fftn_work_size_d(const size_t);
+void fftn_forward_d(const size_t, const double *restrict,
+    const double *, udsp_complex_d_t *, double *restrict);
+void fftn_backward_d(const size_t, const double *restrict,
+    const udsp_complex_d_t *, double *, double *restrict);
+size_t fftn_lanes_d(void);
+void fftn_correlate_d(const double *restrict, const size_t,
+    const double *restrict, const size_t, double *restrict);
+
+#endif
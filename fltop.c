@@ -270,3 +270,22 @@ flt_l2norm(const float *restrict x, const size_t n)
     norm = sqrtf(sum);
     return norm;
 }
+
+/*
+ * Return the largest magnitude in x, or NaN or infinity if x has a NaN
+ * or an infinity.  The magnitudes are compared as integers, which
+ * orders them as floats, so the loop has no branches and vectorizes;
+ * it is meant to scan a buffer once before a loop of plain arithmetic.
+ */
+float
+flt_absmax(const float *restrict x, const size_t n)
+{
+    uint32_t m, a;
+    size_t i;
+    m = 0;
+    for (i = 0; i < n; i++) {
+        a = ftoi(x[i]) & SIGNF;
+        m = (a > m) ? a : m;
+    }
+    return itof(m);
+}
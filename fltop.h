@@ -42,5 +42,6 @@ float flt_mul(const float, const float);
 float flt_div(const float, const float);
 float flt_sum(const float *restrict, const size_t);
 float flt_l2norm(const float *restrict x, const size_t n);
+float flt_absmax(const float *restrict, const size_t);
 
 #endif
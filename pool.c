@@ -0,0 +1,283 @@
+/* Copyright 2013-2016, Mansour Moufid <mansourmoufid@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "pool.h"
+#include "udsp.h"
+
+/*
+ * Thread pool
+ *
+ * A pool of t threads is the calling thread, worker 0, and t - 1
+ * threads that sleep between jobs.  A job is a function applied to
+ * the items 0 to count - 1;  each worker takes the next item from a
+ * shared counter until there are none left, so a worker that finishes
+ * early takes over the items of the others.  With GNU atomics, the
+ * lock is only taken to start and to finish a job, never per item.
+ *
+ * Each worker owns scratch slots, pointers to memory allocated with
+ * malloc or posix_memalign, which only it touches while running a job
+ * and which are freed with the pool.  The pool also has a buffer
+ * shared by the workers of a job, which divide it between them.
+ */
+
+struct pool_worker {
+    struct udsp_pool *pool;
+    size_t index;
+    pthread_t thread;
+    void *scratch[POOL_SCRATCH_SLOTS];
+};
+
+struct udsp_pool {
+    size_t threads;
+    struct pool_worker *workers;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned long generation;
+    int quit;
+    size_t active;
+    pool_fn_t fn;
+    void *arg;
+    size_t count;
+    size_t next;
+    float *buffer;
+    size_t buffer_size;
+};
+
+/*
+ * Take the next item of the job.  Without GNU atomics, the counter is
+ * under the lock.
+ */
+static inline size_t
+pool_next(struct udsp_pool *pool)
+{
+    size_t i;
+#if defined(__GNUC__)
+    i = __atomic_fetch_add(&(pool->next), 1, __ATOMIC_RELAXED);
+#else
+    (void) pthread_mutex_lock(&(pool->lock));
+    i = pool->next++;
+    (void) pthread_mutex_unlock(&(pool->lock));
+#endif
+    return i;
+}
+
+static void
+pool_work(struct udsp_pool *pool, const size_t worker)
+{
+    size_t i;
+    for (;;) {
+        i = pool_next(pool);
+        if (i >= pool->count) {
+            break;
+        }
+        (*pool->fn)(pool->arg, i, worker);
+    }
+    return;
+}
+
+static void *
+pool_main(void *arg)
+{
+    struct pool_worker *self = arg;
+    struct udsp_pool *pool = self->pool;
+    unsigned long seen = 0;
+    for (;;) {
+        (void) pthread_mutex_lock(&(pool->lock));
+        while (pool->generation == seen && !pool->quit) {
+            (void) pthread_cond_wait(&(pool->start), &(pool->lock));
+        }
+        if (pool->quit) {
+            (void) pthread_mutex_unlock(&(pool->lock));
+            break;
+        }
+        seen = pool->generation;
+        (void) pthread_mutex_unlock(&(pool->lock));
+        pool_work(pool, self->index);
+        (void) pthread_mutex_lock(&(pool->lock));
+        if (--(pool->active) == 0) {
+            (void) pthread_cond_signal(&(pool->done));
+        }
+        (void) pthread_mutex_unlock(&(pool->lock));
+    }
+    return NULL;
+}
+
+static void
+pool_stop(struct udsp_pool *pool, const size_t started)
+{
+    size_t i;
+    (void) pthread_mutex_lock(&(pool->lock));
+    pool->quit = 1;
+    (void) pthread_cond_broadcast(&(pool->start));
+    (void) pthread_mutex_unlock(&(pool->lock));
+    for (i = 1; i < started; i++) {
+        (void) pthread_join(pool->workers[i].thread, NULL);
+    }
+    return;
+}
+
+static void
+pool_free(struct udsp_pool *pool)
+{
+    size_t i, j;
+    for (i = 0; i < pool->threads; i++) {
+        for (j = 0; j < POOL_SCRATCH_SLOTS; j++) {
+            free(pool->workers[i].scratch[j]);
+        }
+    }
+    (void) pthread_cond_destroy(&(pool->done));
+    (void) pthread_cond_destroy(&(pool->start));
+    (void) pthread_mutex_destroy(&(pool->lock));
+    free(pool->buffer);
+    free(pool->workers);
+    free(pool);
+    return;
+}
+
+udsp_pool_t *
+udsp_pool_create(const size_t threads)
+{
+    struct udsp_pool *pool;
+    size_t i, j;
+    assert(threads > 0);
+    pool = malloc(sizeof(struct udsp_pool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->workers = malloc(threads * sizeof(struct pool_worker));
+    if (pool->workers == NULL) {
+        free(pool);
+        return NULL;
+    }
+    pool->threads = threads;
+    pool->generation = 0;
+    pool->quit = 0;
+    pool->active = 0;
+    pool->fn = NULL;
+    pool->arg = NULL;
+    pool->count = 0;
+    pool->next = 0;
+    pool->buffer = NULL;
+    pool->buffer_size = 0;
+    (void) pthread_mutex_init(&(pool->lock), NULL);
+    (void) pthread_cond_init(&(pool->start), NULL);
+    (void) pthread_cond_init(&(pool->done), NULL);
+    for (i = 0; i < threads; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        for (j = 0; j < POOL_SCRATCH_SLOTS; j++) {
+            pool->workers[i].scratch[j] = NULL;
+        }
+    }
+    for (i = 1; i < threads; i++) {
+        if (pthread_create(&(pool->workers[i].thread), NULL,
+                &pool_main, &(pool->workers[i])) != 0) {
+            pool_stop(pool, i);
+            pool_free(pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+void
+udsp_pool_destroy(udsp_pool_t *pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+    pool_stop(pool, pool->threads);
+    pool_free(pool);
+    return;
+}
+
+size_t
+udsp_pool_threads(const udsp_pool_t *pool)
+{
+    assert(pool != NULL);
+    return pool->threads;
+}
+
+/*
+ * Apply fn to the items 0 to count - 1, and return when all are done.
+ * A pool runs one job at a time.
+ */
+void
+pool_run(udsp_pool_t *pool, pool_fn_t fn, void *arg, const size_t count)
+{
+    size_t i;
+    assert(pool != NULL);
+    assert(fn != NULL);
+    if (pool->threads == 1 || count < 2) {
+        for (i = 0; i < count; i++) {
+            (*fn)(arg, i, 0);
+        }
+        return;
+    }
+    (void) pthread_mutex_lock(&(pool->lock));
+    pool->fn = fn;
+    pool->arg = arg;
+    pool->count = count;
+    pool->next = 0;
+    pool->active = pool->threads - 1;
+    pool->generation++;
+    (void) pthread_cond_broadcast(&(pool->start));
+    (void) pthread_mutex_unlock(&(pool->lock));
+    pool_work(pool, 0);
+    (void) pthread_mutex_lock(&(pool->lock));
+    while (pool->active > 0) {
+        (void) pthread_cond_wait(&(pool->done), &(pool->lock));
+    }
+    (void) pthread_mutex_unlock(&(pool->lock));
+    return;
+}
+
+/*
+ * Return scratch slot s of worker w, to be used only by that worker.
+ */
+void **
+pool_scratch(udsp_pool_t *pool, const size_t w, const size_t s)
+{
+    assert(pool != NULL);
+    assert(w < pool->threads);
+    assert(s < POOL_SCRATCH_SLOTS);
+    return &(pool->workers[w].scratch[s]);
+}
+
+/*
+ * Return the pool's buffer, grown to at least size floats, or NULL if
+ * it could not be.  It must only be called between jobs.
+ */
+float *
+pool_buffer(udsp_pool_t *pool, const size_t size)
+{
+    float *buffer;
+    assert(pool != NULL);
+    if (pool->buffer_size < size) {
+        buffer = realloc(pool->buffer, size * sizeof(float));
+        if (buffer == NULL) {
+            return NULL;
+        }
+        pool->buffer = buffer;
+        pool->buffer_size = size;
+    }
+    return pool->buffer;
+}
@@ -345,28 +345,1345 @@ test_fft_shift(void)
     return;
 }
 
+static void
+test_fft_cache(void)
+{
+    udsp_state_t *st = NULL;
+    size_t i, n;
+
+    st = calloc(2, sizeof(udsp_state_t));
+    if (st == NULL) {
+        exit(1);
+    }
+
+    for (i = 0; i < N_FFT_TEST_CASES; i++) {
+        n = i + 1;
+
+        fill_junk(st, 2 * sizeof(udsp_state_t));
+        udsp_fft_init(&st[0], UDSP_FFT_FFTPACK, n);
+        udsp_fft_init(&st[1], UDSP_FFT_FFTPACK, n + 1);
+        assert(st[0].fft_state.weights != st[1].fft_state.weights);
+        udsp_fft_init(&st[1], UDSP_FFT_FFTPACK, n);
+        assert(st[0].fft_state.weights == st[1].fft_state.weights);
+    }
+
+    free(st);
+    st = NULL;
+
+    return;
+}
+
+static void
+test_plan(void)
+{
+    udsp_plan_t *plan = NULL;
+    size_t i, j, n;
+    udsp_complex_t *fft_test = NULL;
+
+    for (i = 0; i < N_FFT_TEST_CASES; i++) {
+        fft_test = fft_test_cases[i];
+        n = i + 1;
+
+        assert(udsp_plan_size(UDSP_FFT_FFTPACK, n) < sizeof(udsp_state_t));
+        plan = udsp_plan_create(UDSP_FFT_FFTPACK, n);
+        if (plan == NULL) {
+            exit(1);
+        }
+        assert(udsp_plan_length(plan) == n);
+
+        udsp_plan_fft(plan, test_input, n, fft_output);
+        for (j = 0; j < n; j++) {
+            assert(COMPLEX_EQUALS(fft_output[j], fft_test[j]));
+        }
+
+        udsp_plan_ifft(plan, fft_output, n, test_input);
+        for (j = 0; j < n; j++) {
+            assert(flt_eq(test_input[j], (float) (j + 1)));
+        }
+
+        udsp_plan_destroy(plan);
+        plan = NULL;
+    }
+
+    return;
+}
+
+static void
+test_rfft(void)
+{
+    udsp_state_t *st = NULL;
+    udsp_plan_t *plan = NULL;
+    size_t i, j, n;
+    udsp_complex_t *fft_test = NULL;
+
+    st = malloc(sizeof(udsp_state_t));
+    if (st == NULL) {
+        exit(1);
+    }
+
+    for (i = 0; i < N_FFT_TEST_CASES; i++) {
+        fft_test = fft_test_cases[i];
+        n = i + 1;
+
+        fill_junk(st, sizeof(udsp_state_t));
+        udsp_fft_init(st, UDSP_FFT_FFTPACK, n);
+        udsp_rfft(st, test_input, n, fft_output);
+        for (j = 0; j < n / 2 + 1; j++) {
+            assert(COMPLEX_EQUALS(fft_output[j], fft_test[j]));
+        }
+
+        udsp_irfft(st, fft_output, n / 2 + 1, test_input);
+        for (j = 0; j < n; j++) {
+            assert(flt_eq(test_input[j], (float) (j + 1)));
+        }
+
+        plan = udsp_plan_create(UDSP_FFT_NATIVE, n);
+        if (plan == NULL) {
+            exit(1);
+        }
+        udsp_plan_rfft(plan, test_input, n, fft_output);
+        for (j = 0; j < n / 2 + 1; j++) {
+            assert(COMPLEX_EQUALS(fft_output[j], fft_test[j]));
+        }
+
+        udsp_plan_irfft(plan, fft_output, n / 2 + 1, test_input);
+        for (j = 0; j < n; j++) {
+            assert(flt_eq(test_input[j], (float) (j + 1)));
+        }
+        udsp_plan_destroy(plan);
+        plan = NULL;
+    }
+
+    free(st);
+    st = NULL;
+
+    return;
+}
+
+static void
+test_fft_native(void)
+{
+    const size_t sizes[] = {5, 16, 60, 97, 128, 1000, 4096};
+    udsp_state_t *st = NULL;
+    udsp_plan_t *plan[2] = {NULL, NULL};
+    size_t i, j, n;
+    udsp_complex_t *fft_test = NULL;
+    float *x = NULL, *y = NULL;
+    udsp_complex_t *X = NULL, *Y = NULL;
+
+    st = malloc(sizeof(udsp_state_t));
+    if (st == NULL) {
+        exit(1);
+    }
+
+    for (i = 0; i < N_FFT_TEST_CASES; i++) {
+        fft_test = fft_test_cases[i];
+        n = i + 1;
+
+        fill_junk(st, sizeof(udsp_state_t));
+        udsp_fft_init(st, UDSP_FFT_NATIVE, n);
+        udsp_fft(st, test_input, n, fft_output);
+        for (j = 0; j < n; j++) {
+            assert(COMPLEX_EQUALS(fft_output[j], fft_test[j]));
+        }
+
+        udsp_ifft(st, fft_output, n, test_input);
+        for (j = 0; j < n; j++) {
+            assert(flt_eq(test_input[j], (float) (j + 1)));
+        }
+    }
+
+    free(st);
+    st = NULL;
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        n = sizes[i];
+
+        x = malloc(n * sizeof(float));
+        y = malloc(n * sizeof(float));
+        X = malloc(n * sizeof(udsp_complex_t));
+        Y = malloc(n * sizeof(udsp_complex_t));
+        plan[0] = udsp_plan_create(UDSP_FFT_FFTPACK, n);
+        plan[1] = udsp_plan_create(UDSP_FFT_NATIVE, n);
+        if (x == NULL || y == NULL || X == NULL || Y == NULL
+                || plan[0] == NULL || plan[1] == NULL) {
+            exit(1);
+        }
+
+        for (j = 0; j < n; j++) {
+            x[j] = (float) ((j * 7919) % 101) / 101.f - 0.5f;
+        }
+        udsp_plan_fft(plan[0], x, n, X);
+        udsp_plan_fft(plan[1], x, n, Y);
+        assert(rel_err((float *) Y, (float *) X, 2 * n) < 1e-4f);
+
+        udsp_plan_fft(plan[1], x, n, Y);
+        udsp_plan_ifft(plan[1], Y, n, y);
+        assert(rel_err(y, x, n) < 1e-5f);
+
+        udsp_plan_destroy(plan[0]);
+        udsp_plan_destroy(plan[1]);
+        plan[0] = plan[1] = NULL;
+        free(x);
+        free(y);
+        free(X);
+        free(Y);
+    }
+
+    return;
+}
+
+static void
+test_plan_execute(void)
+{
+    const int methods[] = {UDSP_FFT_FFTPACK, UDSP_FFT_NATIVE};
+    const size_t sizes[] = {1, 2, 3, 4, 97, 1000};
+    udsp_plan_t *plan = NULL;
+    size_t i, j, k, n;
+    float *x = NULL, *buf = NULL;
+    udsp_complex_t *X = NULL, *Y = NULL;
+
+    for (i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+        for (j = 0; j < sizeof(sizes) / sizeof(sizes[0]); j++) {
+            n = sizes[j];
+
+            x = malloc(n * sizeof(float));
+            buf = malloc(2 * (n / 2 + 1) * sizeof(float));
+            X = malloc((n / 2 + 1) * sizeof(udsp_complex_t));
+            Y = malloc((n / 2 + 1) * sizeof(udsp_complex_t));
+            plan = udsp_plan_create(methods[i], n);
+            if (x == NULL || buf == NULL || X == NULL || Y == NULL
+                    || plan == NULL) {
+                exit(1);
+            }
+
+            for (k = 0; k < n; k++) {
+                x[k] = (float) ((k * 7919) % 101) / 101.f - 0.5f;
+                buf[k] = x[k];
+            }
+            udsp_plan_rfft(plan, x, n, X);
+
+            udsp_plan_execute_r2c(plan, x, Y);
+            for (k = 0; k < n / 2 + 1; k++) {
+                assert(COMPLEX_EQUALS(X[k], Y[k]));
+            }
+
+            udsp_plan_execute_r2c(plan, buf, (udsp_complex_t *) buf);
+            for (k = 0; k < n / 2 + 1; k++) {
+                assert(COMPLEX_EQUALS(X[k], ((udsp_complex_t *) buf)[k]));
+            }
+
+            udsp_plan_execute_c2r(plan, (udsp_complex_t *) buf, buf);
+            assert(rel_err(buf, x, n) < 1e-4f);
+
+            udsp_plan_execute_c2r(plan, Y, buf);
+            assert(rel_err(buf, x, n) < 1e-4f);
+
+            udsp_plan_destroy(plan);
+            plan = NULL;
+            free(x);
+            free(buf);
+            free(X);
+            free(Y);
+        }
+    }
+
+    return;
+}
+
+static void
+test_plan_batch(void)
+{
+    const int methods[] = {UDSP_FFT_FFTPACK, UDSP_FFT_NATIVE};
+    const size_t sizes[] = {1, 4, 12, 15, 97, 1000};
+    const size_t howmany = 37;
+    udsp_plan_t *plan = NULL, *single = NULL;
+    size_t i, j, k, b, n, h;
+    float *x = NULL, *y = NULL, *z = NULL;
+    udsp_complex_t *X = NULL, *Y = NULL, *Z = NULL;
+
+    for (i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+        for (j = 0; j < sizeof(sizes) / sizeof(sizes[0]); j++) {
+            n = sizes[j];
+            h = n / 2 + 1;
+
+            x = malloc(howmany * n * sizeof(float));
+            y = malloc(howmany * n * sizeof(float));
+            z = malloc(howmany * n * sizeof(float));
+            X = malloc(howmany * h * sizeof(udsp_complex_t));
+            Y = malloc(howmany * h * sizeof(udsp_complex_t));
+            Z = malloc(howmany * h * sizeof(udsp_complex_t));
+            plan = udsp_plan_create_batch(methods[i], n, 32);
+            single = udsp_plan_create(methods[i], n);
+            if (x == NULL || y == NULL || z == NULL
+                    || X == NULL || Y == NULL || Z == NULL
+                    || plan == NULL || single == NULL) {
+                exit(1);
+            }
+
+            for (k = 0; k < howmany * n; k++) {
+                x[k] = (float) ((k * 7919) % 101) / 101.f - 0.5f;
+            }
+            for (b = 0; b < howmany; b++) {
+                udsp_plan_execute_r2c(single, &x[b * n], &X[b * h]);
+            }
+
+            /* contiguous transforms */
+            udsp_plan_execute_r2c_batch(plan, howmany, x, 1, n, Y, 1, h);
+            for (k = 0; k < howmany * h; k++) {
+                Z[k] = Y[k];
+            }
+            assert(rel_err((float *) Z, (float *) X, 2 * howmany * h)
+                < 1e-5f);
+            udsp_plan_execute_c2r_batch(plan, howmany, Y, 1, h, y, 1, n);
+            assert(rel_err(y, x, howmany * n) < 1e-4f);
+
+            /* interleaved transforms */
+            for (b = 0; b < howmany; b++) {
+                for (k = 0; k < n; k++) {
+                    z[k * howmany + b] = x[b * n + k];
+                }
+            }
+            udsp_plan_execute_r2c_batch(plan, howmany,
+                z, howmany, 1, Y, howmany, 1);
+            for (b = 0; b < howmany; b++) {
+                for (k = 0; k < h; k++) {
+                    Z[b * h + k] = Y[k * howmany + b];
+                }
+            }
+            assert(rel_err((float *) Z, (float *) X, 2 * howmany * h)
+                < 1e-5f);
+            udsp_plan_execute_c2r_batch(plan, howmany,
+                Y, howmany, 1, y, howmany, 1);
+            assert(rel_err(y, z, howmany * n) < 1e-4f);
+
+            udsp_plan_destroy(plan);
+            udsp_plan_destroy(single);
+            plan = NULL;
+            single = NULL;
+            free(x);
+            free(y);
+            free(z);
+            free(X);
+            free(Y);
+            free(Z);
+        }
+    }
+
+    return;
+}
+
+static void
+test_pool(void)
+{
+    const size_t threads[] = {1, 4};
+    const size_t howmany = 37, n = 100, h = 51, m = 300, k = 17;
+    udsp_state_t *st = NULL;
+    udsp_pool_t *pool = NULL;
+    udsp_plan_t *plan = NULL;
+    size_t i, j, b;
+    float *x = NULL, *y = NULL, *z = NULL, *r = NULL;
+    udsp_complex_t *X = NULL, *Y = NULL;
+
+    st = malloc(2 * sizeof(udsp_state_t));
+    x = malloc(howmany * m * sizeof(float));
+    y = malloc(howmany * m * sizeof(float));
+    z = malloc(howmany * (m + k - 1) * sizeof(float));
+    r = malloc(howmany * (m + k - 1) * sizeof(float));
+    X = malloc(howmany * h * sizeof(udsp_complex_t));
+    Y = malloc(howmany * h * sizeof(udsp_complex_t));
+    plan = udsp_plan_create_batch(UDSP_FFT_NATIVE, n, 16);
+    if (st == NULL || x == NULL || y == NULL || z == NULL || r == NULL
+            || X == NULL || Y == NULL || plan == NULL) {
+        exit(1);
+    }
+    for (i = 0; i < howmany * m; i++) {
+        x[i] = (float) ((i * 7919) % 101) / 101.f - 0.5f;
+        y[i] = (float) ((i * 104729) % 37) / 37.f - 0.5f;
+    }
+
+    for (i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+        pool = udsp_pool_create(threads[i]);
+        if (pool == NULL) {
+            exit(1);
+        }
+        assert(udsp_pool_threads(pool) == threads[i]);
+
+        udsp_plan_execute_r2c_batch(plan, howmany, x, 1, n, X, 1, h);
+        udsp_pool_execute_r2c_batch(pool, plan, howmany, x, 1, n, Y, 1, h);
+        assert(rel_err((float *) Y, (float *) X, 2 * howmany * h) < 1e-5f);
+        udsp_pool_execute_r2c_batch(pool, plan, howmany, x, 1, n, Y, 1, h);
+        udsp_pool_execute_c2r_batch(pool, plan, howmany, Y, 1, h, z, 1, n);
+        assert(rel_err(z, x, howmany * n) < 1e-4f);
+
+        /* the same kernel for every signal */
+        for (j = 0; j < 2; j++) {
+            if (j == 0) {
+                udsp_pool_conv(pool, howmany, x, m, m, y, k, 0,
+                    r, m + k - 1);
+            } else {
+                udsp_pool_xcor(pool, howmany, x, m, m, y, k, 0,
+                    r, m + k - 1);
+            }
+            for (b = 0; b < howmany; b++) {
+                if (j == 0) {
+                    udsp_conv(st, &x[b * m], m, y, k,
+                        &z[b * (m + k - 1)]);
+                } else {
+                    udsp_xcor(st, &x[b * m], m, y, k,
+                        &z[b * (m + k - 1)]);
+                }
+            }
+            assert(rel_err(r, z, howmany * (m + k - 1)) < 1e-6f);
+        }
+
+        /* a kernel per signal */
+        udsp_pool_xcov(pool, howmany, x, m, m, y, k, k, r, m + k - 1);
+        for (b = 0; b < howmany; b++) {
+            udsp_xcov(st, &x[b * m], m, &y[b * k], k, &z[b * (m + k - 1)]);
+        }
+        assert(rel_err(r, z, howmany * (m + k - 1)) < 1e-6f);
+
+        udsp_pool_destroy(pool);
+        pool = NULL;
+    }
+
+    udsp_plan_destroy(plan);
+    free(st);
+    free(x);
+    free(y);
+    free(z);
+    free(r);
+    free(X);
+    free(Y);
+
+    return;
+}
+
+static void
+test_fft_large(void)
+{
+    const size_t sizes[] = {150000, 135135};
+    udsp_plan_t *ref = NULL, *plan = NULL;
+    udsp_pool_t *pool = NULL;
+    size_t i, k, n, h;
+    float *x = NULL, *y = NULL;
+    udsp_complex_t *X = NULL, *Y = NULL, *Z = NULL;
+
+    pool = udsp_pool_create(3);
+    if (pool == NULL) {
+        exit(1);
+    }
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        n = sizes[i];
+        h = n / 2 + 1;
+
+        x = malloc(n * sizeof(float));
+        y = malloc(n * sizeof(float));
+        X = malloc(h * sizeof(udsp_complex_t));
+        Y = malloc(h * sizeof(udsp_complex_t));
+        Z = malloc(h * sizeof(udsp_complex_t));
+        ref = udsp_plan_create(UDSP_FFT_FFTPACK, n);
+        plan = udsp_plan_create(UDSP_FFT_NATIVE, n);
+        if (x == NULL || y == NULL || X == NULL || Y == NULL || Z == NULL
+                || ref == NULL || plan == NULL) {
+            exit(1);
+        }
+
+        for (k = 0; k < n; k++) {
+            x[k] = (float) ((k * 7919) % 101) / 101.f - 0.5f;
+        }
+        udsp_plan_execute_r2c(ref, x, X);
+
+        udsp_plan_execute_r2c(plan, x, Y);
+        udsp_pool_execute_r2c(pool, plan, x, Z);
+        for (k = 0; k < h; k++) {
+            assert(COMPLEX_EQUALS(Y[k], Z[k]));
+        }
+        assert(rel_err((float *) Y, (float *) X, 2 * h) < 1e-5f);
+
+        udsp_pool_execute_c2r(pool, plan, Z, y);
+        assert(rel_err(y, x, n) < 1e-5f);
+        udsp_plan_execute_c2r(plan, Z, y);
+        assert(rel_err(y, x, n) < 1e-5f);
+
+        udsp_plan_destroy(ref);
+        udsp_plan_destroy(plan);
+        free(x);
+        free(y);
+        free(X);
+        free(Y);
+        free(Z);
+    }
+
+    udsp_pool_destroy(pool);
+
+    return;
+}
+
+/*
+ * The transforms of fixed-point signals are those of the same signals
+ * converted to floats, and the inverse rounds back to the samples.
+ */
+static void
+test_fixed(void)
+{
+    const int methods[] = {UDSP_FFT_FFTPACK, UDSP_FFT_NATIVE};
+    const size_t sizes[] = {1, 2, 5, 16, 97, 1000};
+    const float scale = 1.f / 32768.f;
+    udsp_state_t *st = NULL;
+    int16_t *s16 = NULL, *out16 = NULL;
+    int32_t *s32 = NULL;
+    float *x = NULL;
+    udsp_complex_t *X = NULL, *Y = NULL;
+    size_t i, j, k, l, n;
+    int e;
+
+    st = malloc(sizeof(udsp_state_t));
+    s16 = malloc(2000 * sizeof(int16_t));
+    out16 = malloc(2000 * sizeof(int16_t));
+    s32 = malloc(2000 * sizeof(int32_t));
+    x = malloc(2000 * sizeof(float));
+    X = malloc(2000 * sizeof(udsp_complex_t));
+    Y = malloc(2000 * sizeof(udsp_complex_t));
+    if (st == NULL || s16 == NULL || out16 == NULL || s32 == NULL
+            || x == NULL || X == NULL || Y == NULL) {
+        exit(1);
+    }
+
+    for (i = 0; i < 2000; i++) {
+        s16[i] = (int16_t) ((int) ((i * 7919) % 65536) - 32768);
+        s32[i] = (int32_t) ((i * 104729) % 16777216) - 8388608;
+    }
+    s16[0] = INT16_MIN;
+    s16[1] = INT16_MAX;
+
+    for (i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+        for (j = 0; j < sizeof(sizes) / sizeof(sizes[0]); j++) {
+            n = sizes[j];
+            fill_junk(st, sizeof(udsp_state_t));
+            udsp_fft_init(st, methods[i], n);
+
+            /* zero-padded, exact and truncated */
+            for (l = n / 2 + 1; l <= 2 * n; l += n / 2 + 1) {
+                for (k = 0; k < l; k++) {
+                    x[k] = scale * (float) s16[k];
+                }
+                udsp_fft(st, x, l, X);
+                udsp_fft_s16(st, s16, l, scale, Y);
+                for (k = 0; k < n; k++) {
+                    assert(X[k].real == Y[k].real);
+                    assert(X[k].imag == Y[k].imag);
+                }
+                udsp_rfft_s16(st, s16, l, scale, NULL);
+                udsp_rfft_s16(st, s16, l, scale, Y);
+                for (k = 0; k < n / 2 + 1; k++) {
+                    assert(X[k].real == Y[k].real);
+                    assert(X[k].imag == Y[k].imag);
+                }
+
+                for (k = 0; k < l; k++) {
+                    x[k] = (float) s32[k];
+                }
+                udsp_fft(st, x, l, X);
+                udsp_fft_s32(st, s32, l, 1.f, Y);
+                for (k = 0; k < n; k++) {
+                    assert(X[k].real == Y[k].real);
+                    assert(X[k].imag == Y[k].imag);
+                }
+                udsp_rfft_s32(st, s32, l, 1.f, Y);
+                for (k = 0; k < n / 2 + 1; k++) {
+                    assert(X[k].real == Y[k].real);
+                    assert(X[k].imag == Y[k].imag);
+                }
+            }
+
+            /* the error of the transforms is a few units at most */
+            udsp_fft_s16(st, s16, n, scale, X);
+            udsp_ifft_s16(st, X, n, scale, out16);
+            for (k = 0; k < n; k++) {
+                assert(abs((int) out16[k] - (int) s16[k]) <= 4);
+            }
+
+            /* twice the samples saturate */
+            udsp_ifft_s16(st, X, n, scale / 2.f, out16);
+            for (k = 0; k < n; k++) {
+                e = 2 * (int) s16[k];
+                e = (e > INT16_MAX) ? INT16_MAX
+                    : ((e < INT16_MIN) ? INT16_MIN : e);
+                assert(abs((int) out16[k] - e) <= 8);
+            }
+        }
+    }
+
+    free(st);
+    free(s16);
+    free(out16);
+    free(s32);
+    free(x);
+    free(X);
+    free(Y);
+
+    return;
+}
+
+static void
+test_cfft(void)
+{
+    const int methods[] = {UDSP_FFT_FFTPACK, UDSP_FFT_NATIVE};
+    const size_t sizes[] = {1, 2, 3, 4, 5, 12, 97, 128, 1000};
+    const double tpi = 6.28318530717958647692528676655900577;
+    udsp_state_t *st = NULL;
+    udsp_plan_t *plan = NULL;
+    size_t i, j, k, l, n;
+    double a, re, im;
+    udsp_complex_t *x = NULL, *X = NULL, *Y = NULL, *Z = NULL;
+
+    st = malloc(sizeof(udsp_state_t));
+    if (st == NULL) {
+        exit(1);
+    }
+
+    for (i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+        for (j = 0; j < sizeof(sizes) / sizeof(sizes[0]); j++) {
+            n = sizes[j];
+
+            x = malloc(n * sizeof(udsp_complex_t));
+            X = malloc(n * sizeof(udsp_complex_t));
+            Y = malloc(n * sizeof(udsp_complex_t));
+            Z = malloc(n * sizeof(udsp_complex_t));
+            plan = udsp_plan_create_complex(methods[i], n);
+            if (x == NULL || X == NULL || Y == NULL || Z == NULL
+                    || plan == NULL) {
+                exit(1);
+            }
+
+            /* the last point is zero, to test padding */
+            for (k = 0; k < n; k++) {
+                x[k].real = (float) ((k * 7919) % 101) / 101.f - 0.5f;
+                x[k].imag = (float) ((k * 104729) % 37) / 37.f - 0.5f;
+            }
+            x[n - 1].real = 0.f;
+            x[n - 1].imag = 0.f;
+            for (k = 0; k < n; k++) {
+                re = 0.;
+                im = 0.;
+                for (l = 0; l < n; l++) {
+                    a = -tpi * (double) ((k * l) % n) / (double) n;
+                    re += x[l].real * cos(a) - x[l].imag * sin(a);
+                    im += x[l].real * sin(a) + x[l].imag * cos(a);
+                }
+                X[k].real = (float) re;
+                X[k].imag = (float) im;
+            }
+
+            udsp_plan_cfft(plan, x, n, Y);
+            udsp_plan_cfft(plan, x, (n > 1) ? n - 1 : n, Z);
+            for (k = 0; k < n; k++) {
+                assert(COMPLEX_EQUALS(Y[k], Z[k]));
+            }
+            if (n > 1) {
+                assert(rel_err((float *) Z, (float *) X, 2 * n) < 1e-5f);
+            }
+
+            udsp_plan_icfft(plan, Y, n, Z);
+            assert(rel_err((float *) Z, (float *) x, 2 * n) < 1e-5f);
+
+            if (n < udsp_fft_max_size()) {
+                fill_junk(st, sizeof(udsp_state_t));
+                udsp_fft_init(st, methods[i], n);
+                udsp_cfft(st, x, n, Z);
+                for (k = 0; k < n; k++) {
+                    assert(COMPLEX_EQUALS(Y[k], Z[k]));
+                }
+                udsp_icfft(st, Y, n, Z);
+                assert(rel_err((float *) Z, (float *) x, 2 * n) < 1e-5f);
+            }
+
+            udsp_plan_destroy(plan);
+            plan = NULL;
+            free(x);
+            free(X);
+            free(Y);
+            free(Z);
+        }
+    }
+
+    free(st);
+
+    return;
+}
+
+/*
+ * Coefficient k of the cosine or sine transform of the given type of
+ * the n samples of x, as defined by FFTW.
+ */
+static double
+trig_coef(const int sine, const int type, const float *x, const size_t n,
+    const size_t k)
+{
+    const double pi = 3.14159265358979323846264338327950288;
+    const double sign = (k % 2 == 0) ? 1. : -1.;
+    double a, y;
+    size_t j;
+    y = 0.;
+    for (j = 0; j < n; j++) {
+        switch (type) {
+            case 1:
+                a = sine ? (double) ((j + 1) * (k + 1)) / (double) (n + 1)
+                    : (double) (j * k) / (double) (n - 1);
+                break;
+            case 2:
+                a = (j + 0.5) * (double) (sine ? k + 1 : k) / (double) n;
+                break;
+            case 3:
+                a = (double) (sine ? j + 1 : j) * (k + 0.5) / (double) n;
+                break;
+            default:
+                a = (j + 0.5) * (k + 0.5) / (double) n;
+        }
+        y += 2. * x[j] * (sine ? sin(pi * a) : cos(pi * a));
+    }
+    if (type == 1 && !sine) {
+        y -= x[0] + sign * x[n - 1];
+    } else if (type == 3) {
+        y -= sine ? sign * x[n - 1] : x[0];
+    }
+    return y;
+}
+
+static void
+test_dct(void)
+{
+    const int methods[] = {UDSP_FFT_FFTPACK, UDSP_FFT_NATIVE};
+    const size_t sizes[] = {1, 2, 3, 4, 5, 8, 15, 16, 17, 30, 97, 128, 1000};
+    udsp_state_t *st = NULL;
+    size_t i, j, k, n;
+    int sine, type;
+    float *x = NULL, *X = NULL, *Y = NULL, *Z = NULL;
+
+    st = malloc(sizeof(udsp_state_t));
+    if (st == NULL) {
+        exit(1);
+    }
+
+    for (i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+        for (j = 0; j < sizeof(sizes) / sizeof(sizes[0]); j++) {
+            n = sizes[j];
+
+            x = malloc(n * sizeof(float));
+            X = malloc(n * sizeof(float));
+            Y = malloc(n * sizeof(float));
+            Z = malloc(n * sizeof(float));
+            if (x == NULL || X == NULL || Y == NULL || Z == NULL) {
+                exit(1);
+            }
+
+            /* the last sample is zero, to test padding */
+            for (k = 0; k < n; k++) {
+                x[k] = (float) ((k * 7919) % 101) / 101.f - 0.5f;
+            }
+            x[n - 1] = 0.f;
+
+            fill_junk(st, sizeof(udsp_state_t));
+            udsp_fft_init(st, methods[i], n);
+            for (sine = 0; sine <= 1; sine++) {
+                for (type = 1; type <= 4; type++) {
+                    if (type == 1 && !sine && n < 2) {
+                        continue;
+                    }
+                    for (k = 0; k < n; k++) {
+                        X[k] = (float) trig_coef(sine, type, x, n, k);
+                    }
+                    if (sine) {
+                        udsp_dst(st, type, x, n, Y);
+                        udsp_dst(st, type, x, (n > 1) ? n - 1 : n, Z);
+                    } else {
+                        udsp_dct(st, type, x, n, Y);
+                        udsp_dct(st, type, x, (n > 1) ? n - 1 : n, Z);
+                    }
+                    for (k = 0; k < n; k++) {
+                        assert(flt_eq(Y[k], Z[k]));
+                    }
+                    if (n > 1) {
+                        assert(rel_err(Y, X, n) < 1e-4f);
+                    }
+                }
+            }
+
+            free(x);
+            free(X);
+            free(Y);
+            free(Z);
+        }
+    }
+
+    free(st);
+
+    return;
+}
+
+static int
+is_fast_size(size_t n)
+{
+    while (n % 2 == 0) {
+        n /= 2;
+    }
+    while (n % 3 == 0) {
+        n /= 3;
+    }
+    while (n % 5 == 0) {
+        n /= 5;
+    }
+    return (n == 1);
+}
+
+static void
+test_fft_fast_size(void)
+{
+    udsp_state_t *st = NULL;
+    float x[1000], y[1002], z[2001];
+    double sum;
+    size_t i, j, n;
+    float err;
+
+    assert(udsp_fft_fast_size(1) == 1);
+    assert(udsp_fft_fast_size(7) == 8);
+    assert(udsp_fft_fast_size(97) == 100);
+    assert(udsp_fft_fast_size(1000) == 1000);
+    assert(udsp_fft_fast_size(2001) == 2025);
+    for (n = 1; n < 5000; n++) {
+        i = udsp_fft_fast_size(n);
+        assert(i >= n);
+        assert(is_fast_size(i));
+        for (j = n; j < i; j++) {
+            assert(!is_fast_size(j));
+        }
+    }
+
+    st = calloc(2, sizeof(udsp_state_t));
+    if (st == NULL) {
+        exit(1);
+    }
+    for (i = 0; i < 1000; i++) {
+        x[i] = (float) ((i * 7919) % 101) / 101.f - 0.5f;
+    }
+    for (i = 0; i < 1002; i++) {
+        y[i] = (float) ((i * 104729) % 103) / 103.f - 0.5f;
+    }
+    udsp_conv(st, x, 1000, y, 1002, z);
+    for (i = 0; i < 2001; i++) {
+        sum = 0.;
+        for (j = 0; j < 1000; j++) {
+            if (i >= j && i - j < 1002) {
+                sum += (double) x[j] * (double) y[i - j];
+            }
+        }
+        z[i] -= (float) sum;
+    }
+    err = flt_l2norm(z, 2001);
+    assert(err < 1e-3f);
+    free(st);
+    st = NULL;
+
+    return;
+}
+
 static void
 test_conv(void)
 {
     udsp_state_t *st = NULL;
-    size_t i, m, n;
-    float *conv_test = NULL;
+    size_t i, m, n;
+    float *conv_test = NULL;
+    float err;
+
+    st = calloc(2, sizeof(udsp_state_t));
+    if (st == NULL) {
+        exit(1);
+    }
+
+    for (i = 0; i < N_CONV_TEST_CASES; i++) {
+        conv_test = conv_test_cases[i];
+        m = TEST_INPUT_LENGTH;
+        n = i + 1;
+
+        fill_junk(st, 2 * sizeof(udsp_state_t));
+        udsp_conv(st, test_input, m, test_input, n, conv_output);
+
+        err = rel_err(conv_output, conv_test, m + n - 1);
+        assert(err < REL_ERR_MAX);
+    }
+
+    free(st);
+    st = NULL;
+
+    return;
+}
+
+static void
+test_xcov(void)
+{
+    udsp_state_t *st = NULL;
+    size_t i, m, n;
+    float *xcov_test = NULL;
+    float err;
+
+    st = calloc(2, sizeof(udsp_state_t));
+    if (st == NULL) {
+        exit(1);
+    }
+
+    for (i = 0; i < N_XCOV_TEST_CASES; i++) {
+        xcov_test = xcov_test_cases[i];
+        m = TEST_INPUT_LENGTH;
+        n = i + 1;
+
+        fill_junk(st, 2 * sizeof(udsp_state_t));
+        udsp_xcov(st, test_input, m, test_input, n, xcov_output);
+
+        err = rel_err(xcov_output, xcov_test, m + n - 1);
+        assert(err < REL_ERR_MAX);
+    }
+
+    free(st);
+    st = NULL;
+
+    return;
+}
+
+static void
+test_xcor(void)
+{
+    udsp_state_t *st = NULL;
+    size_t i, m, n;
+    float *xcor_test = NULL;
+    float err;
+
+    st = calloc(2, sizeof(udsp_state_t));
+    if (st == NULL) {
+        exit(1);
+    }
+
+    for (i = 0; i < N_XCOR_TEST_CASES; i++) {
+        xcor_test = xcor_test_cases[i];
+        m = TEST_INPUT_LENGTH;
+        n = i + 1;
+
+        fill_junk(st, 2 * sizeof(udsp_state_t));
+        udsp_xcor(st, test_input, m, test_input, n, xcor_output);
+
+        err = rel_err(xcor_output, xcor_test, m + n - 1);
+        assert(err < REL_ERR_MAX);
+    }
+
+    free(st);
+    st = NULL;
+
+    return;
+}
+
+/*
+ * Convolve, in double precision, x with y, reversed for the covariance
+ * and correlation, and with their means removed for the correlation.
+ */
+static void
+conv_ref(const int kind, const float *x, const size_t m,
+    const float *y, const size_t n, float *result)
+{
+    double a, b, mx, my, sum;
+    size_t i, j, k;
+    mx = 0.;
+    my = 0.;
+    if (kind == 2) {
+        for (i = 0; i < m; i++) {
+            mx += x[i];
+        }
+        for (j = 0; j < n; j++) {
+            my += y[j];
+        }
+        mx /= (double) m;
+        my /= (double) n;
+    }
+    for (k = 0; k < m + n - 1; k++) {
+        sum = 0.;
+        for (i = 0; i < m; i++) {
+            if (k < i || k - i >= n) {
+                continue;
+            }
+            j = (kind == 0) ? k - i : n - 1 - (k - i);
+            a = (double) x[i] - mx;
+            b = (double) y[j] - my;
+            sum += a * b;
+        }
+        if (kind != 0) {
+            sum /= (double) ((m > n) ? m : n);
+        }
+        result[k] = (float) sum;
+    }
+    return;
+}
+
+static void
+test_conv_direct(void)
+{
+    const size_t sizes[][2] = {
+        {1, 1}, {2, 1}, {1, 5}, {37, 3}, {3, 37}, {1000, 16},
+        {64, 1000}, {999, 777}, {5000, 4000},
+    };
+    udsp_state_t *st = NULL;
+    float *x = NULL, *y = NULL, *output = NULL, *expected = NULL;
+    size_t i, k, m, n;
+    float err;
+
+    st = calloc(2, sizeof(udsp_state_t));
+    x = malloc(5000 * sizeof(float));
+    y = malloc(5000 * sizeof(float));
+    output = malloc(10000 * sizeof(float));
+    expected = malloc(10000 * sizeof(float));
+    if (st == NULL || x == NULL || y == NULL
+            || output == NULL || expected == NULL) {
+        exit(1);
+    }
+
+    for (i = 0; i < 5000; i++) {
+        x[i] = (float) ((i * 7919) % 101) / 101.f;
+        y[i] = (float) ((i * 104729) % 61) / 61.f - 0.25f;
+    }
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        m = sizes[i][0];
+        n = sizes[i][1];
+        for (k = 0; k < 3; k++) {
+            fill_junk(st, 2 * sizeof(udsp_state_t));
+            if (k == 0) {
+                udsp_conv(st, x, m, y, n, output);
+            } else if (k == 1) {
+                udsp_xcov(st, x, m, y, n, output);
+            } else {
+                udsp_xcor(st, x, m, y, n, output);
+            }
+            conv_ref((int) k, x, m, y, n, expected);
+            if (flt_l2norm(expected, m + n - 1) == 0.f) {
+                assert(flt_l2norm(output, m + n - 1) < 1e-6f);
+                continue;
+            }
+            err = rel_err(output, expected, m + n - 1);
+            assert(err < 1e-4f);
+        }
+    }
+
+    free(st);
+    free(x);
+    free(y);
+    free(output);
+    free(expected);
+
+    return;
+}
+
+static void
+test_xcor_lags(void)
+{
+    const size_t sizes[][3] = {
+        {1, 1, 0}, {1, 1, 3}, {37, 3, 5}, {3, 37, 50}, {999, 777, 3},
+        {5000, 4000, 200}, {4000, 5000, 20}, {5000, 4000, 6000},
+        {20000, 20000, 2000},
+    };
+    udsp_state_t *st = NULL;
+    float *x = NULL, *y = NULL, *output = NULL, *expected = NULL;
+    double mx, my, sum;
+    size_t i, j, k, t, m, n, lags;
+    float err;
+
+    st = calloc(2, sizeof(udsp_state_t));
+    x = malloc(20000 * sizeof(float));
+    y = malloc(20000 * sizeof(float));
+    output = malloc(12001 * sizeof(float));
+    expected = malloc(12001 * sizeof(float));
+    if (st == NULL || x == NULL || y == NULL || output == NULL
+            || expected == NULL) {
+        exit(1);
+    }
+
+    for (i = 0; i < 20000; i++) {
+        x[i] = (float) ((i * 7919) % 101) / 101.f;
+        y[i] = (float) ((i * 104729) % 61) / 61.f - 0.25f;
+    }
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        m = sizes[i][0];
+        n = sizes[i][1];
+        lags = sizes[i][2];
+        for (k = 0; k < 2; k++) {
+            mx = 0.;
+            my = 0.;
+            if (k == 1) {
+                for (t = 0; t < m; t++) {
+                    mx += x[t];
+                }
+                for (t = 0; t < n; t++) {
+                    my += y[t];
+                }
+                mx /= (double) m;
+                my /= (double) n;
+            }
+            /* the lag j - lags is the sum of x[t + j - lags] y[t] */
+            for (j = 0; j < 2 * lags + 1; j++) {
+                sum = 0.;
+                for (t = 0; t < n; t++) {
+                    if (t + j < lags || t + j - lags >= m) {
+                        continue;
+                    }
+                    sum += ((double) x[t + j - lags] - mx)
+                        * ((double) y[t] - my);
+                }
+                expected[j] = (float) (sum / (double) ((m > n) ? m : n));
+            }
+            fill_junk(st, 2 * sizeof(udsp_state_t));
+            if (k == 0) {
+                udsp_xcov_lags(st, x, m, y, n, lags, output);
+            } else {
+                udsp_xcor_lags(st, x, m, y, n, lags, output);
+            }
+            if (flt_l2norm(expected, 2 * lags + 1) == 0.f) {
+                assert(flt_l2norm(output, 2 * lags + 1) < 1e-6f);
+                continue;
+            }
+            err = rel_err(output, expected, 2 * lags + 1);
+            assert(err < 1e-4f);
+        }
+    }
+
+    free(x);
+    free(y);
+    free(output);
+    free(expected);
+
+    /*
+     * Too long for the full convolution to fit in a state, and too many
+     * lags for blocks:  safe signals, and signals whose products could
+     * overflow.  Every 97th lag is checked.
+     */
+    x = malloc(65000 * sizeof(float));
+    y = malloc(40000 * sizeof(float));
+    output = malloc(60001 * sizeof(float));
+    expected = malloc(2 * 620 * sizeof(float));
+    if (x == NULL || y == NULL || output == NULL || expected == NULL) {
+        exit(1);
+    }
+    for (i = 0; i < 65000; i++) {
+        x[i] = (float) ((i * 7919) % 101) / 101.f;
+    }
+    for (i = 0; i < 40000; i++) {
+        y[i] = (float) ((i * 104729) % 61) / 61.f - 0.25f;
+    }
+    for (i = 0; i < 2; i++) {
+        m = (i == 0) ? 40000 : 65000;
+        n = (i == 0) ? 40000 : 1000;
+        lags = (i == 0) ? 30000 : 20000;
+        if (i == 1) {
+            x[500] = 1e36f;
+        }
+        fill_junk(st, 2 * sizeof(udsp_state_t));
+        udsp_xcov_lags(st, x, m, y, n, lags, output);
+        for (j = 0, k = 0; j < 2 * lags + 1; j += 97, k++) {
+            sum = 0.;
+            for (t = 0; t < n; t++) {
+                if (t + j < lags || t + j - lags >= m) {
+                    continue;
+                }
+                sum += (double) x[t + j - lags] * (double) y[t];
+            }
+            expected[k] = (float) (sum / (double) ((m > n) ? m : n));
+            expected[620 + k] = output[j];
+        }
+        err = rel_err(&expected[620], expected, k);
+        assert(err < 1e-4f);
+    }
+
+    free(st);
+    free(x);
+    free(y);
+    free(output);
+    free(expected);
+
+    return;
+}
+
+static void
+test_xcor_matrix(void)
+{
+    const size_t lengths[] = {1, 37, 300};
+    const int methods[] = {UDSP_FFT_FFTPACK, UDSP_FFT_NATIVE};
+    const size_t channels = 5;
+    udsp_state_t *st = NULL;
+    udsp_pool_t *pool = NULL;
+    udsp_xcor_matrix_t *xm = NULL;
+    float *x = NULL, *result = NULL, *pooled = NULL, *expected = NULL;
+    size_t a, b, c, i, j, k, n, rd;
+    int upper;
     float err;
 
+    rd = 2 * 300;
+    st = calloc(2, sizeof(udsp_state_t));
+    x = malloc(channels * 300 * sizeof(float));
+    result = malloc(channels * channels * rd * sizeof(float));
+    pooled = malloc(channels * channels * rd * sizeof(float));
+    expected = malloc(rd * sizeof(float));
+    pool = udsp_pool_create(3);
+    if (st == NULL || x == NULL || result == NULL || pooled == NULL
+            || expected == NULL || pool == NULL) {
+        exit(1);
+    }
+
+    for (c = 0; c < channels * 300; c++) {
+        x[c] = (float) ((c * 7919) % 101) / 101.f - 0.25f;
+    }
+
+    for (a = 0; a < sizeof(methods) / sizeof(methods[0]); a++) {
+        for (b = 0; b < sizeof(lengths) / sizeof(lengths[0]); b++) {
+            n = lengths[b];
+            xm = udsp_xcor_matrix_create(methods[a], channels, n);
+            if (xm == NULL) {
+                exit(1);
+            }
+            for (upper = 0; upper < 2; upper++) {
+                udsp_xcor_matrix(xm, x, 300, upper, result, rd);
+                udsp_pool_xcor_matrix(pool, xm, x, 300, upper, pooled, rd);
+                k = 0;
+                for (i = 0; i < channels; i++) {
+                    for (j = upper ? i : 0; j < channels; j++) {
+                        for (c = 0; c < 2 * n - 1; c++) {
+                            assert(flt_eq(result[k * rd + c],
+                                pooled[k * rd + c]));
+                        }
+                        fill_junk(st, 2 * sizeof(udsp_state_t));
+                        udsp_xcor(st, &x[i * 300], n, &x[j * 300], n,
+                            expected);
+                        if (flt_l2norm(expected, 2 * n - 1) < 1e-6f) {
+                            assert(flt_l2norm(&result[k * rd], 2 * n - 1)
+                                < 1e-5f);
+                        } else {
+                            err = rel_err(&result[k * rd], expected,
+                                2 * n - 1);
+                            assert(err < 1e-4f);
+                        }
+                        k++;
+                    }
+                }
+                assert(k == udsp_xcor_matrix_pairs(xm, upper));
+            }
+            udsp_xcor_matrix_destroy(xm);
+            xm = NULL;
+        }
+    }
+
+    udsp_pool_destroy(pool);
+    free(st);
+    free(x);
+    free(result);
+    free(pooled);
+    free(expected);
+
+    return;
+}
+
+static void
+test_nxcor(void)
+{
+    const size_t sizes[][2] = {{1, 1}, {5, 5}, {1000, 16}, {4000, 1500}};
+    udsp_state_t *st = NULL;
+    float *x = NULL, *y = NULL, *output = NULL;
+    double a, b, mx, my, sxy, sxx, syy;
+    size_t i, j, k, m, n, p;
+
     st = calloc(2, sizeof(udsp_state_t));
+    x = malloc(4000 * sizeof(float));
+    y = malloc(4000 * sizeof(float));
+    output = malloc(4000 * sizeof(float));
+    if (st == NULL || x == NULL || y == NULL || output == NULL) {
+        exit(1);
+    }
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        m = sizes[i][0];
+        n = sizes[i][1];
+        p = (m - n) / 3;
+        for (j = 0; j < m; j++) {
+            x[j] = (float) ((j * 7919) % 101) / 101.f - 0.5f;
+        }
+        for (j = 0; j < n; j++) {
+            y[j] = (float) ((j * 104729) % 61) / 61.f;
+            x[p + j] = 2.f * y[j] + 3.f;
+        }
+        /* a constant window */
+        for (j = p + n; j < m && j < p + 2 * n; j++) {
+            x[j] = 1.f;
+        }
+
+        fill_junk(st, 2 * sizeof(udsp_state_t));
+        udsp_nxcor(st, x, m, y, n, output);
+
+        for (k = 0; k < m - n + 1; k++) {
+            mx = 0.;
+            my = 0.;
+            for (j = 0; j < n; j++) {
+                mx += x[k + j];
+                my += y[j];
+            }
+            mx /= (double) n;
+            my /= (double) n;
+            sxy = 0.;
+            sxx = 0.;
+            syy = 0.;
+            for (j = 0; j < n; j++) {
+                a = (double) x[k + j] - mx;
+                b = (double) y[j] - my;
+                sxy += a * b;
+                sxx += a * a;
+                syy += b * b;
+            }
+            if (sxx < 1e-9 || syy < 1e-9) {
+                assert(flt_eq(output[k], 0.f));
+                continue;
+            }
+            assert(fabs(output[k] - sxy / sqrt(sxx * syy)) < 1e-3);
+        }
+        if (n > 1) {
+            assert(fabsf(output[p] - 1.f) < 1e-4f);
+        }
+    }
+
+    free(st);
+    free(x);
+    free(y);
+    free(output);
+
+    return;
+}
+
+static void
+test_pow(void)
+{
+    udsp_state_t *st = NULL;
+    size_t i, n;
+    float *pow_test = NULL;
+    float err;
+
+    st = malloc(sizeof(udsp_state_t));
     if (st == NULL) {
         exit(1);
     }
 
-    for (i = 0; i < N_CONV_TEST_CASES; i++) {
-        conv_test = conv_test_cases[i];
-        m = TEST_INPUT_LENGTH;
+    for (i = 0; i < N_POW_TEST_CASES; i++) {
+        pow_test = pow_test_cases[i];
         n = i + 1;
 
-        fill_junk(st, 2 * sizeof(udsp_state_t));
-        udsp_conv(st, test_input, m, test_input, n, conv_output);
+        fill_junk(st, sizeof(udsp_state_t));
+        udsp_pow(st, test_input, n, pow_output);
 
-        err = rel_err(conv_output, conv_test, m + n - 1);
+        err = rel_err(pow_output, pow_test, n);
         assert(err < REL_ERR_MAX);
     }
 
@@ -376,12 +1693,532 @@ test_conv(void)
     return;
 }
 
+static double
+rel_err_d(const double *x, const double *y, const size_t n)
+{
+    double d, e, f;
+    size_t i;
+    e = 0.;
+    f = 0.;
+    for (i = 0; i < n; i++) {
+        d = x[i] - y[i];
+        e += d * d;
+        f += y[i] * y[i];
+    }
+    return (f > 0.) ? sqrt(e / f) : sqrt(e);
+}
+
+static void
+conv_ref_d(const int kind, const double *x, const size_t m,
+    const double *y, const size_t n, double *result)
+{
+    double mx, my, sum;
+    size_t i, j, k;
+    mx = 0.;
+    my = 0.;
+    if (kind == 2) {
+        for (i = 0; i < m; i++) {
+            mx += x[i];
+        }
+        for (j = 0; j < n; j++) {
+            my += y[j];
+        }
+        mx /= (double) m;
+        my /= (double) n;
+    }
+    for (k = 0; k < m + n - 1; k++) {
+        sum = 0.;
+        for (i = 0; i < m; i++) {
+            if (k < i || k - i >= n) {
+                continue;
+            }
+            j = (kind == 0) ? k - i : n - 1 - (k - i);
+            sum += (x[i] - mx) * (y[j] - my);
+        }
+        if (kind != 0) {
+            sum /= (double) ((m > n) ? m : n);
+        }
+        result[k] = sum;
+    }
+    return;
+}
+
+/*
+ * The double variants, on 24-bit samples, agree with references in
+ * double precision to far better than the single precision functions
+ * could.
+ */
 static void
-test_xcov(void)
+test_double(void)
+{
+    const double tpi = 6.28318530717958647692528676655900577;
+    const size_t fft_sizes[] = {1, 2, 3, 5, 16, 60, 97, 128, 1000, 4096};
+    const size_t conv_sizes[][2] = {
+        {1, 1}, {37, 3}, {3, 37}, {1000, 16}, {999, 777}, {5000, 4000},
+    };
+    udsp_state_d_t *st = NULL;
+    double *x = NULL, *y = NULL, *output = NULL, *expected = NULL;
+    double *c = NULL, *s = NULL;
+    udsp_complex_d_t *X = NULL;
+    size_t i, j, k, m, n;
+
+    st = calloc(2, sizeof(udsp_state_d_t));
+    x = malloc(5000 * sizeof(double));
+    y = malloc(5000 * sizeof(double));
+    output = malloc(10000 * sizeof(double));
+    expected = malloc(10000 * sizeof(double));
+    c = malloc(4096 * sizeof(double));
+    s = malloc(4096 * sizeof(double));
+    X = malloc(4096 * sizeof(udsp_complex_d_t));
+    if (st == NULL || x == NULL || y == NULL || output == NULL
+            || expected == NULL || c == NULL || s == NULL || X == NULL) {
+        exit(1);
+    }
+
+    for (i = 0; i < 5000; i++) {
+        x[i] = (double) ((i * 7919 + 13) % 16777213) - 8388608.;
+        y[i] = (double) ((i * 104729 + 7) % 16777199) - 8388608.;
+    }
+
+    for (i = 0; i < sizeof(fft_sizes) / sizeof(fft_sizes[0]); i++) {
+        n = fft_sizes[i];
+        for (k = 0; k < n; k++) {
+            c[k] = cos(-tpi * (double) k / (double) n);
+            s[k] = sin(-tpi * (double) k / (double) n);
+        }
+        fill_junk(st, sizeof(udsp_state_d_t));
+        udsp_fft_init_d(st, UDSP_FFT_NATIVE, n);
+        udsp_fft_d(st, x, n, X);
+        for (k = 0; k < n; k++) {
+            expected[2 * k] = 0.;
+            expected[2 * k + 1] = 0.;
+            for (j = 0; j < n; j++) {
+                expected[2 * k] += x[j] * c[(j * k) % n];
+                expected[2 * k + 1] += x[j] * s[(j * k) % n];
+            }
+        }
+        assert(rel_err_d((const double *) X, expected, 2 * n) < 1e-13);
+        udsp_ifft_d(st, X, n, output);
+        assert(rel_err_d(output, x, n) < 1e-13);
+    }
+
+    for (i = 0; i < sizeof(conv_sizes) / sizeof(conv_sizes[0]); i++) {
+        m = conv_sizes[i][0];
+        n = conv_sizes[i][1];
+        for (k = 0; k < 3; k++) {
+            fill_junk(st, 2 * sizeof(udsp_state_d_t));
+            if (k == 0) {
+                udsp_conv_d(st, x, m, y, n, output);
+            } else if (k == 1) {
+                udsp_xcov_d(st, x, m, y, n, output);
+            } else {
+                udsp_xcor_d(st, x, m, y, n, output);
+            }
+            conv_ref_d((int) k, x, m, y, n, expected);
+            assert(rel_err_d(output, expected, m + n - 1) < 1e-12);
+        }
+    }
+
+    for (i = 0; i < N_POW_TEST_CASES; i++) {
+        n = i + 1;
+        for (j = 0; j < n; j++) {
+            x[j] = (double) test_input[j];
+        }
+        fill_junk(st, sizeof(udsp_state_d_t));
+        udsp_pow_d(st, x, n, output);
+        for (j = 0; j < n; j++) {
+            expected[j] = (double) pow_test_cases[i][j];
+        }
+        assert(rel_err_d(output, expected, n) < 1e-7);
+    }
+
+    free(st);
+    free(x);
+    free(y);
+    free(output);
+    free(expected);
+    free(c);
+    free(s);
+    free(X);
+
+    return;
+}
+
+static void
+test_stft(void)
+{
+    const int methods[] = {UDSP_FFT_FFTPACK, UDSP_FFT_NATIVE};
+    const int outputs[] = {
+        UDSP_STFT_COMPLEX, UDSP_STFT_MAGNITUDE, UDSP_STFT_POWER
+    };
+    const size_t chunks[] = {1, 7, 100, 3, 250, 64, 16};
+    const struct {
+        size_t l, hop;
+        int window;
+    } cases[] = {
+        {64, 16, UDSP_WINDOW_HANN},
+        {45, 45, UDSP_WINDOW_RECT},
+        {50, 20, UDSP_WINDOW_HAMMING},
+        {32, 50, UDSP_WINDOW_BLACKMAN},
+    };
+    const size_t n = 1000;
+    udsp_stft_t *stft = NULL, *istft = NULL;
+    udsp_plan_t *plan = NULL;
+    size_t b, c, f, i, j, k, l, h, hop, m, count, frames;
+    float *x = NULL, *w = NULL, *y = NULL, *P = NULL;
+    udsp_complex_t *X = NULL, *Y = NULL;
+    double a;
+
+    x = malloc(n * sizeof(float));
+    w = malloc(n * sizeof(float));
+    y = malloc(n * sizeof(float));
+    P = malloc(4 * n * sizeof(float));
+    X = malloc(4 * n * sizeof(udsp_complex_t));
+    Y = malloc(n * sizeof(udsp_complex_t));
+    if (x == NULL || w == NULL || y == NULL || P == NULL
+            || X == NULL || Y == NULL) {
+        exit(1);
+    }
+    for (i = 0; i < n; i++) {
+        x[i] = (float) ((i * 7919) % 101) / 101.f - 0.5f;
+    }
+
+    for (c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        l = cases[c].l;
+        h = l / 2 + 1;
+        hop = cases[c].hop;
+        frames = (n - l) / hop + 1;
+        for (j = 0; j < l; j++) {
+            a = 6.28318530717958647692528676655900577
+                * (double) j / (double) l;
+            switch (cases[c].window) {
+                case UDSP_WINDOW_HANN:
+                    w[j] = (float) (0.5 - 0.5 * cos(a));
+                    break;
+                case UDSP_WINDOW_HAMMING:
+                    w[j] = (float) (0.54 - 0.46 * cos(a));
+                    break;
+                case UDSP_WINDOW_BLACKMAN:
+                    w[j] = (float) (0.42 - 0.5 * cos(a) + 0.08 * cos(2. * a));
+                    break;
+                default:
+                    w[j] = 1.f;
+            }
+        }
+        for (i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+            plan = udsp_plan_create(methods[i], l);
+            stft = udsp_stft_create(methods[i], l, hop, cases[c].window);
+            if (plan == NULL || stft == NULL) {
+                exit(1);
+            }
+
+            for (j = 0; j < sizeof(outputs) / sizeof(outputs[0]); j++) {
+                udsp_stft_reset(stft);
+                count = 0;
+                for (k = 0, m = 0; m < n; k++, m += b) {
+                    b = chunks[k % 7];
+                    b = (b < n - m) ? b : n - m;
+                    f = udsp_stft_frames(stft, b);
+                    assert(udsp_stft_process(stft, &x[m], b, outputs[j],
+                        (outputs[j] == UDSP_STFT_COMPLEX)
+                            ? (void *) &X[count * h]
+                            : (void *) &P[count * h]) == f);
+                    count += f;
+                }
+                assert(count == frames);
+                for (f = 0; f < frames; f++) {
+                    for (k = 0; k < l; k++) {
+                        y[k] = x[f * hop + k] * w[k];
+                    }
+                    udsp_plan_rfft(plan, y, l, Y);
+                    for (k = 0; k < h; k++) {
+                        if (outputs[j] == UDSP_STFT_COMPLEX) {
+                            assert(COMPLEX_EQUALS(X[f * h + k], Y[k]));
+                            continue;
+                        }
+                        a = (double) Y[k].real * Y[k].real
+                            + (double) Y[k].imag * Y[k].imag;
+                        if (outputs[j] == UDSP_STFT_MAGNITUDE) {
+                            a = sqrt(a);
+                        }
+                        assert(fabs(P[f * h + k] - a) <= 1e-5 * (1. + a));
+                    }
+                }
+            }
+
+            if (hop <= l) {
+                istft = udsp_istft_create(methods[i], l, hop,
+                    cases[c].window);
+                if (istft == NULL) {
+                    exit(1);
+                }
+                udsp_istft_process(istft, X, 1, y);
+                udsp_istft_process(istft, &X[h], frames - 1, &y[hop]);
+                /* the first l - hop samples lack overlapping frames */
+                assert(rel_err(&y[l - hop], &x[l - hop],
+                    frames * hop - (l - hop)) < 1e-5f);
+                udsp_stft_destroy(istft);
+                istft = NULL;
+            }
+
+            udsp_plan_destroy(plan);
+            udsp_stft_destroy(stft);
+        }
+    }
+
+    /* the squares of the Hann window do not overlap at hop l */
+    assert(udsp_istft_create(UDSP_FFT_NATIVE, 64, 64,
+        UDSP_WINDOW_HANN) == NULL);
+
+    free(x);
+    free(w);
+    free(y);
+    free(P);
+    free(X);
+    free(Y);
+
+    return;
+}
+
+/*
+ * The DFT of the n samples x at the frequency k, in units of the
+ * n-point DFT.
+ */
+static udsp_complex_t
+dft_coef(const float *x, const size_t n, const double k)
+{
+    const double tpi = 6.28318530717958647692528676655900577;
+    udsp_complex_t y;
+    double a, re, im;
+    size_t j;
+    re = 0.;
+    im = 0.;
+    for (j = 0; j < n; j++) {
+        a = -tpi * k * (double) j / (double) n;
+        re += x[j] * cos(a);
+        im += x[j] * sin(a);
+    }
+    y.real = (float) re;
+    y.imag = (float) im;
+    return y;
+}
+
+static void
+test_goertzel(void)
+{
+    const float bins[] = {
+        0.f, 1.f, 7.5f, 60.f, 249.5f, 250.f, 333.f, 499.f, 3.25f, 17.f,
+        100.f, 101.f, 102.f, 103.f, 104.f, 105.f, 106.f, 107.f, 0.5f,
+    };
+    const size_t sdft_bins[] = {0, 1, 5, 32, 63};
+    const size_t n = 500, count = sizeof(bins) / sizeof(bins[0]);
+    const size_t l = 64, m = 1000, nb = 5;
+    udsp_sdft_t *sd = NULL;
+    size_t i, j, k;
+    float *x = NULL, *y = NULL;
+    udsp_complex_t *X = NULL, *Y = NULL;
+
+    x = malloc(m * sizeof(float));
+    y = malloc(l * sizeof(float));
+    X = malloc(m * nb * sizeof(udsp_complex_t));
+    Y = malloc(count * sizeof(udsp_complex_t));
+    sd = udsp_sdft_create(l, sdft_bins, nb);
+    if (x == NULL || y == NULL || X == NULL || Y == NULL || sd == NULL) {
+        exit(1);
+    }
+    for (i = 0; i < m; i++) {
+        x[i] = (float) ((i * 7919) % 101) / 101.f - 0.5f;
+    }
+
+    udsp_goertzel(x, n, bins, count, Y);
+    for (k = 0; k < count; k++) {
+        X[k] = dft_coef(x, n, bins[k]);
+        assert(fabsf(X[k].real - Y[k].real) < 1e-3f);
+        assert(fabsf(X[k].imag - Y[k].imag) < 1e-3f);
+    }
+
+    /* the tracker holds the DFT of the last l samples, zeros before */
+    udsp_sdft_process(sd, x, 100, X);
+    udsp_sdft_process(sd, &x[100], 1, &X[100 * nb]);
+    udsp_sdft_process(sd, &x[101], m - 101, &X[101 * nb]);
+    for (i = 0; i < m; i += 37) {
+        for (j = 0; j < l; j++) {
+            y[j] = (i + j + 1 < l) ? 0.f : x[i + j + 1 - l];
+        }
+        for (k = 0; k < nb; k++) {
+            Y[0] = dft_coef(y, l, (double) sdft_bins[k]);
+            assert(fabsf(X[i * nb + k].real - Y[0].real) < 1e-4f);
+            assert(fabsf(X[i * nb + k].imag - Y[0].imag) < 1e-4f);
+        }
+    }
+    udsp_sdft_get(sd, Y);
+    for (k = 0; k < nb; k++) {
+        assert(COMPLEX_EQUALS(Y[k], X[(m - 1) * nb + k]));
+    }
+    udsp_sdft_reset(sd);
+    udsp_sdft_process(sd, x, 1, Y);
+    assert(flt_eq(Y[0].real, x[0]));
+
+    udsp_sdft_destroy(sd);
+    free(x);
+    free(y);
+    free(X);
+    free(Y);
+
+    return;
+}
+
+/*
+ * The Welch estimate of x, computed directly:  the mean of the power of
+ * the DFTs of the windowed segments, scaled and folded.
+ */
+static void
+welch_ref(const float *x, const size_t n, const size_t l,
+    const size_t overlap, const float *w, const int sides,
+    const int scaling, double *result)
+{
+    const double tpi = 6.28318530717958647692528676655900577;
+    size_t i, j, k, count;
+    double a, re, im, norm;
+    count = (n > l) ? (n - l) / (l - overlap) + 1 : 1;
+    norm = 0.;
+    for (j = 0; j < l; j++) {
+        norm += (scaling == UDSP_WELCH_DENSITY) ? w[j] * w[j] : w[j];
+    }
+    if (scaling == UDSP_WELCH_SPECTRUM) {
+        norm *= norm;
+    }
+    for (k = 0; k < l; k++) {
+        result[k] = 0.;
+        for (i = 0; i < count; i++) {
+            re = 0.;
+            im = 0.;
+            for (j = 0; j < l && i * (l - overlap) + j < n; j++) {
+                a = -tpi * (double) ((j * k) % l) / (double) l;
+                re += x[i * (l - overlap) + j] * w[j] * cos(a);
+                im += x[i * (l - overlap) + j] * w[j] * sin(a);
+            }
+            result[k] += re * re + im * im;
+        }
+        result[k] /= norm * (double) count;
+    }
+    if (sides == UDSP_WELCH_ONESIDED) {
+        for (k = 1; k < (l + 1) / 2; k++) {
+            result[k] *= 2.;
+        }
+    }
+    return;
+}
+
+static void
+test_welch(void)
+{
+    const struct {
+        size_t n, l, overlap;
+        int window, sides, scaling;
+    } cases[] = {
+        {1000, 64, 32, UDSP_WINDOW_HANN,
+            UDSP_WELCH_ONESIDED, UDSP_WELCH_DENSITY},
+        {1000, 63, 10, UDSP_WINDOW_HAMMING,
+            UDSP_WELCH_TWOSIDED, UDSP_WELCH_SPECTRUM},
+        {777, 100, 0, UDSP_WINDOW_RECT,
+            UDSP_WELCH_ONESIDED, UDSP_WELCH_SPECTRUM},
+        {50, 81, 40, UDSP_WINDOW_BLACKMAN,
+            UDSP_WELCH_ONESIDED, UDSP_WELCH_DENSITY},
+        {20000, 256, 128, UDSP_WINDOW_HANN,
+            UDSP_WELCH_TWOSIDED, UDSP_WELCH_DENSITY},
+    };
+    const int methods[] = {UDSP_FFT_FFTPACK, UDSP_FFT_NATIVE};
+    udsp_welch_t *welch = NULL;
+    udsp_pool_t *pool = NULL;
+    size_t i, j, k, l, m;
+    float *x = NULL, *w = NULL, *X = NULL, *Y = NULL, *Z = NULL;
+    double *ref = NULL;
+    double a;
+
+    x = malloc(20000 * sizeof(float));
+    w = malloc(256 * sizeof(float));
+    X = malloc(256 * sizeof(float));
+    Y = malloc(256 * sizeof(float));
+    Z = malloc(256 * sizeof(float));
+    ref = malloc(256 * sizeof(double));
+    pool = udsp_pool_create(3);
+    if (x == NULL || w == NULL || X == NULL || Y == NULL || Z == NULL
+            || ref == NULL || pool == NULL) {
+        exit(1);
+    }
+    for (i = 0; i < 20000; i++) {
+        x[i] = (float) ((i * 7919) % 101) / 101.f - 0.5f;
+    }
+
+    for (i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+        for (j = 0; j < sizeof(cases) / sizeof(cases[0]); j++) {
+            l = cases[j].l;
+            welch = udsp_welch_create(methods[i], l, cases[j].overlap,
+                cases[j].window, cases[j].sides, cases[j].scaling);
+            if (welch == NULL) {
+                exit(1);
+            }
+            m = udsp_welch_length(welch);
+            assert(m == ((cases[j].sides == UDSP_WELCH_ONESIDED)
+                ? l / 2 + 1 : l));
+
+            for (k = 0; k < l; k++) {
+                a = 6.28318530717958647692528676655900577
+                    * (double) k / (double) l;
+                switch (cases[j].window) {
+                    case UDSP_WINDOW_HANN:
+                        w[k] = (float) (0.5 - 0.5 * cos(a));
+                        break;
+                    case UDSP_WINDOW_HAMMING:
+                        w[k] = (float) (0.54 - 0.46 * cos(a));
+                        break;
+                    case UDSP_WINDOW_BLACKMAN:
+                        w[k] = (float) (0.42 - 0.5 * cos(a)
+                            + 0.08 * cos(2. * a));
+                        break;
+                    default:
+                        w[k] = 1.f;
+                }
+            }
+            welch_ref(x, cases[j].n, l, cases[j].overlap, w,
+                cases[j].sides, cases[j].scaling, ref);
+            for (k = 0; k < m; k++) {
+                X[k] = (float) ref[k];
+            }
+
+            udsp_welch(welch, x, cases[j].n, Y);
+            udsp_pool_welch(pool, welch, x, cases[j].n, Z);
+            for (k = 0; k < m; k++) {
+                assert(flt_eq(Y[k], Z[k]));
+            }
+            assert(rel_err(Y, X, m) < 1e-5f);
+
+            udsp_welch_destroy(welch);
+            welch = NULL;
+        }
+    }
+
+    udsp_pool_destroy(pool);
+    free(x);
+    free(w);
+    free(X);
+    free(Y);
+    free(Z);
+    free(ref);
+
+    return;
+}
+
+static void
+test_convolver(void)
 {
+    const size_t blocks[] = {0, 1, 5, 11, 16};
+    const size_t chunks[] = {1, 3, 7, 50};
     udsp_state_t *st = NULL;
-    size_t i, m, n;
-    float *xcov_test = NULL;
+    udsp_convolver_t *cv = NULL;
+    float x[200], h[7], expected[206], output[200];
+    size_t i, j, k, d, m, n;
     float err;
 
     st = calloc(2, sizeof(udsp_state_t));
@@ -389,16 +2226,38 @@ test_xcov(void)
         exit(1);
     }
 
-    for (i = 0; i < N_XCOV_TEST_CASES; i++) {
-        xcov_test = xcov_test_cases[i];
-        m = TEST_INPUT_LENGTH;
-        n = i + 1;
+    m = sizeof(x) / sizeof(x[0]);
+    n = sizeof(h) / sizeof(h[0]);
+    for (i = 0; i < m; i++) {
+        x[i] = (float) ((i * 7919) % 101) / 101.f - 0.5f;
+    }
+    for (i = 0; i < n; i++) {
+        h[i] = test_input[i];
+    }
+    udsp_conv(st, x, m, h, n, expected);
 
-        fill_junk(st, 2 * sizeof(udsp_state_t));
-        udsp_xcov(st, test_input, m, test_input, n, xcov_output);
+    for (i = 0; i < sizeof(blocks) / sizeof(blocks[0]); i++) {
+        cv = udsp_convolver_create(UDSP_FFT_NATIVE, h, n, blocks[i]);
+        if (cv == NULL) {
+            exit(1);
+        }
+        d = udsp_convolver_latency(cv);
+        assert(blocks[i] == 0 || d == blocks[i]);
+        assert(d < m);
+
+        for (j = 0; j < m; j += k) {
+            k = chunks[j % (sizeof(chunks) / sizeof(chunks[0]))];
+            k = (k < m - j) ? k : m - j;
+            udsp_convolver_process(cv, &x[j], k, &output[j]);
+        }
+        for (j = 0; j < d; j++) {
+            assert(flt_eq(output[j], 0.f));
+        }
+        err = rel_err(&output[d], expected, m - d);
+        assert(err < 1e-4f);
 
-        err = rel_err(xcov_output, xcov_test, m + n - 1);
-        assert(err < REL_ERR_MAX);
+        udsp_convolver_destroy(cv);
+        cv = NULL;
     }
 
     free(st);
@@ -408,30 +2267,126 @@ test_xcov(void)
 }
 
 static void
-test_xcor(void)
+test_convolver_partitioned(void)
+{
+    const size_t blocks[] = {32, 100, 256};
+    const int methods[] = {UDSP_FFT_FFTPACK, UDSP_FFT_NATIVE};
+    udsp_state_t *st = NULL;
+    udsp_convolver_t *cv = NULL;
+    float *x = NULL, *h = NULL, *expected = NULL, *output = NULL;
+    size_t i, j, k, a, d, m, n;
+    float err;
+
+    m = 6000;
+    n = 3001;
+    st = calloc(2, sizeof(udsp_state_t));
+    x = malloc(m * sizeof(float));
+    h = malloc(n * sizeof(float));
+    expected = malloc((m + n - 1) * sizeof(float));
+    output = malloc(m * sizeof(float));
+    if (st == NULL || x == NULL || h == NULL || expected == NULL
+            || output == NULL) {
+        exit(1);
+    }
+
+    for (i = 0; i < m; i++) {
+        x[i] = (float) ((i * 7919) % 101) / 101.f - 0.5f;
+    }
+    /* a decaying tail, as of a reverberation */
+    for (i = 0; i < n; i++) {
+        h[i] = (float) ((i * 104729) % 61) / 61.f - 0.5f;
+        h[i] *= expf(-(float) i / 1000.f);
+    }
+    udsp_conv(st, x, m, h, n, expected);
+
+    for (a = 0; a < sizeof(methods) / sizeof(methods[0]); a++) {
+        for (i = 0; i < sizeof(blocks) / sizeof(blocks[0]); i++) {
+            cv = udsp_convolver_create(methods[a], h, n, blocks[i]);
+            if (cv == NULL) {
+                exit(1);
+            }
+            d = udsp_convolver_latency(cv);
+            assert(d == blocks[i]);
+
+            for (j = 0; j < m; j += k) {
+                k = (j * 31) % 97 + 1;
+                k = (k < m - j) ? k : m - j;
+                udsp_convolver_process(cv, &x[j], k, &output[j]);
+            }
+            for (j = 0; j < d; j++) {
+                assert(flt_eq(output[j], 0.f));
+            }
+            err = rel_err(&output[d], expected, m - d);
+            assert(err < 1e-4f);
+
+            udsp_convolver_destroy(cv);
+            cv = NULL;
+        }
+    }
+
+    free(st);
+    free(x);
+    free(h);
+    free(expected);
+    free(output);
+
+    return;
+}
+
+static void
+test_arith(void)
 {
     udsp_state_t *st = NULL;
     size_t i, m, n;
-    float *xcor_test = NULL;
     float err;
+    float x[TEST_INPUT_LENGTH], y[TEST_INPUT_LENGTH];
 
     st = calloc(2, sizeof(udsp_state_t));
     if (st == NULL) {
         exit(1);
     }
 
-    for (i = 0; i < N_XCOR_TEST_CASES; i++) {
-        xcor_test = xcor_test_cases[i];
+    for (i = 0; i < N_CONV_TEST_CASES; i++) {
         m = TEST_INPUT_LENGTH;
         n = i + 1;
 
         fill_junk(st, 2 * sizeof(udsp_state_t));
+        udsp_set_arith(&st[0], UDSP_ARITH_FAST);
+        udsp_conv(st, test_input, m, test_input, n, conv_output);
+        err = rel_err(conv_output, conv_test_cases[i], m + n - 1);
+        assert(err < REL_ERR_MAX);
+
+        udsp_set_arith(&st[0], UDSP_ARITH_FAST);
+        udsp_xcov(st, test_input, m, test_input, n, xcov_output);
+        err = rel_err(xcov_output, xcov_test_cases[i], m + n - 1);
+        assert(err < REL_ERR_MAX);
+
+        udsp_set_arith(&st[0], UDSP_ARITH_FAST);
         udsp_xcor(st, test_input, m, test_input, n, xcor_output);
+        err = rel_err(xcor_output, xcor_test_cases[i], m + n - 1);
+        assert(err < REL_ERR_MAX);
 
-        err = rel_err(xcor_output, xcor_test, m + n - 1);
+        udsp_set_arith(&st[0], UDSP_ARITH_FAST);
+        udsp_pow(&st[0], test_input, n, pow_output);
+        err = rel_err(pow_output, pow_test_cases[i], n);
         assert(err < REL_ERR_MAX);
     }
 
+    /* a NaN in the input falls back to the saturating loops */
+    for (i = 0; i < TEST_INPUT_LENGTH; i++) {
+        x[i] = test_input[i];
+    }
+    x[3] = NAN;
+    n = TEST_INPUT_LENGTH;
+    udsp_set_arith(&st[0], UDSP_ARITH_SATURATE);
+    udsp_pow(&st[0], x, n, y);
+    udsp_set_arith(&st[0], UDSP_ARITH_FAST);
+    udsp_pow(&st[0], x, n, pow_output);
+    for (i = 0; i < n; i++) {
+        assert(flt_isreal(pow_output[i]));
+        assert(flt_eq(pow_output[i], y[i]));
+    }
+
     free(st);
     st = NULL;
 
@@ -439,29 +2394,67 @@ test_xcor(void)
 }
 
 static void
-test_pow(void)
+test_profile(void)
 {
     udsp_state_t *st = NULL;
-    size_t i, n;
-    float *pow_test = NULL;
-    float err;
+    udsp_profile_t p, q;
+    static float x[1000], output[2000];
+    size_t i, m, n, bytes;
 
-    st = malloc(sizeof(udsp_state_t));
+    st = calloc(2, sizeof(udsp_state_t));
     if (st == NULL) {
         exit(1);
     }
+    for (i = 0; i < 1000; i++) {
+        x[i] = test_input[i % TEST_INPUT_LENGTH];
+    }
 
-    for (i = 0; i < N_POW_TEST_CASES; i++) {
-        pow_test = pow_test_cases[i];
-        n = i + 1;
-
-        fill_junk(st, sizeof(udsp_state_t));
-        udsp_pow(st, test_input, n, pow_output);
-
-        err = rel_err(pow_output, pow_test, n);
-        assert(err < REL_ERR_MAX);
+    fill_junk(st, 2 * sizeof(udsp_state_t));
+    udsp_profile_reset(&st[0]);
+    udsp_profile_reset(&st[1]);
+    udsp_profile_reset(NULL);
+
+    /* once by FFTs and once directly */
+    m = 1000;
+    n = 1000;
+    udsp_conv(st, x, m, x, n, output);
+    bytes = (m + (m + n - 1)) * sizeof(float);
+    n = 2;
+    udsp_conv(st, x, m, x, n, output);
+    bytes += ((m + n) + (m + n - 1)) * sizeof(float);
+
+    if (udsp_profile_get(&st[0], &p) == 0) {
+        assert(udsp_profile_get(NULL, &q) == 0);
+        for (i = 0; i < UDSP_PROFILE_STAGES; i++) {
+            assert(p.ns[i] == 0 && p.calls[i] == 0);
+        }
+        assert(p.convs == 0 && p.bytes_copied == 0);
+        assert(p.twiddle_hits == 0 && p.twiddle_misses == 0);
+        free(st);
+        return;
     }
 
+    assert(p.convs == 2);
+    assert(p.calls[UDSP_PROFILE_PRE_FFT] == 2);
+    assert(p.calls[UDSP_PROFILE_FFT] == 1);
+    assert(p.calls[UDSP_PROFILE_MUL] == 1);
+    assert(p.calls[UDSP_PROFILE_IFFT] == 1);
+    assert(p.calls[UDSP_PROFILE_DIRECT] == 1);
+    assert(p.calls[UDSP_PROFILE_POST_IFFT] == 2);
+    assert(p.ns[UDSP_PROFILE_FFT] > 0);
+    assert(p.twiddle_hits + p.twiddle_misses == 1);
+    assert(p.bytes_copied == bytes);
+
+    /* the totals include the second state */
+    assert(udsp_profile_get(NULL, &q) == 1);
+    assert(q.convs == 2);
+    assert(q.twiddle_hits + q.twiddle_misses == 2);
+    assert(q.bytes_copied == bytes + 1000 * sizeof(float));
+
+    udsp_profile_reset(&st[0]);
+    assert(udsp_profile_get(&st[0], &p) == 1);
+    assert(p.convs == 0 && p.calls[UDSP_PROFILE_FFT] == 0);
+
     free(st);
     st = NULL;
 
@@ -473,10 +2466,34 @@ typedef void (*test_fn_t)(void);
 static test_fn_t test_fns[] = {
     test_fft,
     test_fft_shift,
+    test_fft_cache,
+    test_plan,
+    test_fft_native,
+    test_rfft,
+    test_fixed,
+    test_plan_execute,
+    test_plan_batch,
+    test_cfft,
+    test_dct,
+    test_fft_fast_size,
     test_conv,
     test_xcov,
     test_xcor,
+    test_conv_direct,
+    test_xcor_lags,
+    test_xcor_matrix,
+    test_nxcor,
     test_pow,
+    test_double,
+    test_welch,
+    test_convolver,
+    test_convolver_partitioned,
+    test_stft,
+    test_goertzel,
+    test_arith,
+    test_profile,
+    test_pool,
+    test_fft_large,
 };
 
 static size_t n_test_fns = sizeof(test_fns) / sizeof(test_fn_t);
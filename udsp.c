@@ -13,10 +13,25 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#if !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <assert.h>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
 
+#include "fftn.h"
 #include "fltop.h"
+#if defined(UDSP_PROFILE)
+#include "nclock.h"
+#endif
+#include "pool.h"
 #include "udsp.h"
 
 /*
@@ -38,17 +53,21 @@ swap_complex(udsp_complex_t *restrict x, udsp_complex_t *restrict y)
     return;
 }
 
-static inline void
-swap_real(float *restrict x, float *restrict y)
-{
-    float tmp;
-    assert(x != NULL);
-    assert(y != NULL);
-    tmp = *x;
-    *x = *y;
-    *y = tmp;
-    return;
-}
+#define DEFINE_SWAP_FN(NAME, TYPE)                              \
+        static inline void                                      \
+        NAME(TYPE *restrict x, TYPE *restrict y)                \
+        {                                                       \
+            TYPE tmp;                                           \
+            assert(x != NULL);                                  \
+            assert(y != NULL);                                  \
+            tmp = *x;                                           \
+            *x = *y;                                            \
+            *y = tmp;                                           \
+            return;                                             \
+        }
+
+DEFINE_SWAP_FN(swap_real, float)
+DEFINE_SWAP_FN(swap_real_d, double)
 
 #define DEFINE_REVERSE_FN(NAME, TYPE, SWAP)     \
         static inline void                      \
@@ -72,6 +91,7 @@ swap_real(float *restrict x, float *restrict y)
 
 DEFINE_REVERSE_FN(reverse_complex, udsp_complex_t, swap_complex)
 DEFINE_REVERSE_FN(reverse_real, float, swap_real)
+DEFINE_REVERSE_FN(reverse_real_d, double, swap_real_d)
 
 static void
 circ_shift_complex(udsp_complex_t *restrict x, const size_t n,
@@ -103,48 +123,71 @@ max(const size_t x, const size_t y)
     return (x > y) ? x : y;
 }
 
-static inline void
-copy_real(float *restrict dst, const float *restrict src, const size_t n)
+static inline size_t
+half_size(const size_t n)
 {
-    size_t i;
-    for (i = 0; i < n; i++) {
-        dst[i] = src[i];
-    }
-    return;
+    return n / 2 + 1;
 }
 
-static inline void
-copy_complex(udsp_complex_t *restrict dst,
-    const udsp_complex_t *restrict src, const size_t n)
-{
-    size_t i;
-    for (i = 0; i < n; i++) {
-        dst[i].real = src[i].real;
-        dst[i].imag = src[i].imag;
-    }
-    return;
-}
+#define DEFINE_COPY_FN(NAME, TYPE)                              \
+        static inline void                                      \
+        NAME(TYPE *restrict dst, const TYPE *restrict src,      \
+            const size_t n)                                     \
+        {                                                       \
+            size_t i;                                           \
+            for (i = 0; i < n; i++) {                           \
+                dst[i] = src[i];                                \
+            }                                                   \
+            return;                                             \
+        }
 
-static inline void
-zero_real(float *restrict x, const size_t n)
-{
-    size_t i;
-    for (i = 0; i < n; i++) {
-        x[i] = 0.f;
-    }
-    return;
-}
+DEFINE_COPY_FN(copy_real, float)
+DEFINE_COPY_FN(copy_real_d, double)
 
-static inline void
-zero_complex(udsp_complex_t *restrict x, const size_t n)
-{
-    size_t i;
-    for (i = 0; i < n; i++) {
-        x[i].real = 0.f;
-        x[i].imag = 0.f;
-    }
-    return;
-}
+#define DEFINE_COPY_COMPLEX_FN(NAME, TYPE)                      \
+        static inline void                                      \
+        NAME(TYPE *restrict dst, const TYPE *restrict src,      \
+            const size_t n)                                     \
+        {                                                       \
+            size_t i;                                           \
+            for (i = 0; i < n; i++) {                           \
+                dst[i].real = src[i].real;                      \
+                dst[i].imag = src[i].imag;                      \
+            }                                                   \
+            return;                                             \
+        }
+
+DEFINE_COPY_COMPLEX_FN(copy_complex, udsp_complex_t)
+DEFINE_COPY_COMPLEX_FN(copy_complex_d, udsp_complex_d_t)
+
+#define DEFINE_ZERO_FN(NAME, TYPE)                              \
+        static inline void                                      \
+        NAME(TYPE *restrict x, const size_t n)                  \
+        {                                                       \
+            size_t i;                                           \
+            for (i = 0; i < n; i++) {                           \
+                x[i] = 0;                                       \
+            }                                                   \
+            return;                                             \
+        }
+
+DEFINE_ZERO_FN(zero_real, float)
+DEFINE_ZERO_FN(zero_real_d, double)
+
+#define DEFINE_ZERO_COMPLEX_FN(NAME, TYPE)                      \
+        static inline void                                      \
+        NAME(TYPE *restrict x, const size_t n)                  \
+        {                                                       \
+            size_t i;                                           \
+            for (i = 0; i < n; i++) {                           \
+                x[i].real = 0;                                  \
+                x[i].imag = 0;                                  \
+            }                                                   \
+            return;                                             \
+        }
+
+DEFINE_ZERO_COMPLEX_FN(zero_complex, udsp_complex_t)
+DEFINE_ZERO_COMPLEX_FN(zero_complex_d, udsp_complex_d_t)
 
 static inline void
 normalize_real(float *restrict x, const size_t n, const float denom)
@@ -173,6 +216,83 @@ mul_complex(udsp_complex_t *result, const udsp_complex_t *x,
     return;
 }
 
+/*
+ * Arithmetic policy
+ *
+ * The saturating operations of fltop check every operand for NaN,
+ * zero and overflow, which keeps the loops below from vectorizing.
+ * With the fast policy, the operands of a loop are scanned once, and
+ * if none of them could give a NaN or an overflow the loop is done
+ * with plain arithmetic;  otherwise it falls back to the saturating
+ * loop.  The results of the two differ only in the last places, and
+ * in that the saturating operations flush tiny factors to zero.
+ *
+ * A state uses the policy set by udsp_set_arith, or the default.
+ */
+
+#if !defined(UDSP_ARITH_DEFAULT)
+#define UDSP_ARITH_DEFAULT UDSP_ARITH_SATURATE
+#endif
+
+/* below the square root of FLT_MAX / 2:  a * b + c * d cannot overflow */
+#define ARITH_MUL_MAX 1.0e19f
+
+static inline int
+arith_fast(const struct _udsp_fft_state *st)
+{
+    assert(st != NULL);
+    switch (st->arith) {
+        case UDSP_ARITH_FAST:
+            return 1;
+        case UDSP_ARITH_SATURATE:
+            return 0;
+        default:
+            ;
+    }
+    return (UDSP_ARITH_DEFAULT == UDSP_ARITH_FAST);
+}
+
+static inline int
+arith_mul_safe(const float *restrict x, const size_t n)
+{
+    return (flt_absmax(x, n) <= ARITH_MUL_MAX);
+}
+
+static void
+arith_normalize_real(const int fast, float *restrict x, const size_t n,
+    const float denom)
+{
+    float a;
+    size_t i;
+    a = flt_absmax(&denom, 1);
+    if (fast && a > 0.f && a <= FLT_MAX
+            && flt_absmax(x, n) < ((a < 1.f) ? FLT_MAX * a : FLT_MAX)) {
+        for (i = 0; i < n; i++) {
+            x[i] /= denom;
+        }
+        return;
+    }
+    normalize_real(x, n, denom);
+    return;
+}
+
+static void
+add_real(const int fast, float *restrict y, const float *restrict x,
+    const size_t n)
+{
+    size_t i;
+    if (fast) {
+        for (i = 0; i < n; i++) {
+            y[i] += x[i];
+        }
+        return;
+    }
+    for (i = 0; i < n; i++) {
+        y[i] = flt_add(y[i], x[i]);
+    }
+    return;
+}
+
 #if 0
 static void
 dump_real(float *x, size_t n)
@@ -196,548 +316,4751 @@ dump_complex(udsp_complex_t *x, size_t n)
 #endif
 
 /*
- * Fast Fourier transform initialization
+ * Profiling
+ *
+ * With UDSP_PROFILE defined, the convolutions time their stages with
+ * nclock and count their calls and the bytes they copy, and fft_init
+ * counts the twiddle factors it reuses and computes.  Each count is
+ * added to the state it concerns, the first of the two of a
+ * convolution for its stages, and to process-wide totals, which are
+ * shared by every thread and so added atomically.  Without
+ * UDSP_PROFILE these functions are empty and the counters of the
+ * state, which it always has so that its layout does not depend on
+ * the macro, are left alone.
  */
 
-#if !defined(RFFTI)
-#define RFFTI rffti_
+static const struct udsp_profile profile_zero;
+
+#if defined(UDSP_PROFILE)
+
+static struct udsp_profile profile_total;
+
+#define PROFILE_FIELDS (sizeof(struct udsp_profile) / sizeof(uint64_t))
+
+#if !defined(__GNUC__)
+static pthread_mutex_t profile_lock = PTHREAD_MUTEX_INITIALIZER;
 #endif
-extern void RFFTI(const size_t *, float *restrict);
 
-static void
-fftpack_fft_init(struct _udsp_fft_state *restrict st)
+static inline void
+profile_add(udsp_state_t *restrict st, const size_t field,
+    const uint64_t x)
 {
-    assert(st != NULL);
-    assert(st->size > 0);
-    assert(st->size < UDSP_FFT_SIZE_MAX);
-    RFFTI(&(st->size), st->weights);
+    uint64_t *total;
+    assert(field < PROFILE_FIELDS);
+    ((uint64_t *) &st->fft_state.profile)[field] += x;
+    total = &((uint64_t *) &profile_total)[field];
+#if defined(__GNUC__)
+    (void) __atomic_fetch_add(total, x, __ATOMIC_RELAXED);
+#else
+    (void) pthread_mutex_lock(&profile_lock);
+    *total += x;
+    (void) pthread_mutex_unlock(&profile_lock);
+#endif
     return;
 }
 
-static void
-fft_init(udsp_state_t *restrict st, const int fft_method, const size_t l,
-    const float *restrict x, const size_t n)
+#define PROFILE_FIELD(name) \
+        (offsetof(struct udsp_profile, name) / sizeof(uint64_t))
+
+static inline void
+profile_start(uint64_t *t)
 {
-    struct _udsp_fft_state *fft_st;
-    assert(st != NULL);
-    assert(fft_method == UDSP_FFT_FFTPACK);
-    assert(l > 0);
-    assert(l < UDSP_FFT_SIZE_MAX);
-    fft_st = &(st->fft_state);
-    zero_real(fft_st->rbuf, l);
-    zero_complex(fft_st->cbuf, l);
-    if (x != NULL) {
-        assert(n > 0);
-        assert(n < UDSP_FFT_SIZE_MAX);
-        copy_real(fft_st->rbuf, x, min(l, n));
-    }
-    if (fft_st->size == l && fft_st->method == fft_method) {
-        return;
-    }
-    fft_st->size = l;
-    fft_st->method = fft_method;
-    switch (fft_st->method) {
-        case UDSP_FFT_FFTPACK:
-            fftpack_fft_init(fft_st);
-            break;
-        default:
-            ;
-    }
+    (void) nclock_init(t);
     return;
 }
 
-void
-udsp_fft_init(udsp_state_t *restrict st, const int fft_method,
-    const size_t n)
+/* Add the time since t to a stage, and start timing the next */
+static inline void
+profile_stage(udsp_state_t *restrict st, const int stage, uint64_t *t)
 {
-    assert(st != NULL);
-    assert(fft_method == UDSP_FFT_FFTPACK);
-    assert(n > 0);
-    assert(n < UDSP_FFT_SIZE_MAX);
-    fft_init(st, fft_method, n, NULL, 0);
+    assert(stage >= 0 && stage < UDSP_PROFILE_STAGES);
+    (void) nclock_elapsed(t);
+    profile_add(st, PROFILE_FIELD(ns) + (size_t) stage, *t);
+    profile_add(st, PROFILE_FIELD(calls) + (size_t) stage, 1);
+    (void) nclock_init(t);
     return;
 }
 
-/*
- * Fast Fourier transform
- */
-
-#if !defined(UDSP_FFT_DEFAULT)
-#define UDSP_FFT_DEFAULT UDSP_FFT_FFTPACK
-#endif
-
-size_t
-udsp_fft_max_size(void)
+static inline void
+profile_conv(udsp_state_t *restrict st)
 {
-    return UDSP_FFT_SIZE_MAX;
+    profile_add(st, PROFILE_FIELD(convs), 1);
+    return;
 }
 
-#if !defined(RFFTF)
-#define RFFTF rfftf_
-#endif
-extern void RFFTF(const size_t *, float *restrict, float *restrict);
-
-static void
-fftpack_unpack(const float *restrict in, udsp_complex_t *restrict out,
-    const size_t n)
+static inline void
+profile_twiddles(udsp_state_t *restrict st, const int miss)
 {
-    size_t i, j, l;
-    assert(in != NULL);
-    assert(out != NULL);
-    assert(n > 0);
-    if (n % 2 == 0) {
-        l = n / 2;
+    if (miss) {
+        profile_add(st, PROFILE_FIELD(twiddle_misses), 1);
     } else {
-        l = (n + 1) / 2;
-    }
-    out[0].real = in[0];
-    out[0].imag = 0.f;
-    j = 1;
-    for (i = 1; i < l; i++) {
-        assert(j + 1 < n);
-        out[    i].real = in[j];
-        out[    i].imag = in[j + 1];
-        out[n - i].real = in[j];
-        out[n - i].imag = in[j + 1] * -1.f;
-        j += 2;
-    }
-    if (n % 2 == 0) {
-        assert(j < n);
-        out[l].real = in[j];
-        out[l].imag = 0.f;
+        profile_add(st, PROFILE_FIELD(twiddle_hits), 1);
     }
     return;
 }
 
-static void
-fftpack_fft(struct _udsp_fft_state *restrict st)
+static inline void
+profile_copy(udsp_state_t *restrict st, const size_t bytes)
 {
-    assert(st != NULL);
-    assert(st->size > 0);
-    assert(st->size < UDSP_FFT_SIZE_MAX);
-    RFFTF(&(st->size), st->rbuf, st->weights);
-    fftpack_unpack(st->rbuf, st->cbuf, st->size);
+    profile_add(st, PROFILE_FIELD(bytes_copied), (uint64_t) bytes);
     return;
 }
 
-void
-udsp_fft(udsp_state_t *restrict st,
-    const float *restrict x, const size_t n,
-    udsp_complex_t *restrict result)
+#else
+
+static inline void
+profile_start(uint64_t *t)
 {
-    struct _udsp_fft_state *fft_st;
-    assert(st != NULL);
-    fft_st = &(st->fft_state);
-    assert(fft_st->method == UDSP_FFT_FFTPACK);
-    if (x != NULL) {
-        assert(n > 0);
-        assert(n < UDSP_FFT_SIZE_MAX);
-        zero_real(fft_st->rbuf, fft_st->size);
-        copy_real(fft_st->rbuf, x, min(n, fft_st->size));
-    }
-    switch (fft_st->method) {
-        case UDSP_FFT_FFTPACK:
-            fftpack_fft(fft_st);
-            break;
-        default:
-            ;
-    }
-    if (result != NULL) {
-        copy_complex(result, fft_st->cbuf, fft_st->size);
-    }
+    (void) t;
     return;
 }
 
-/*
- * Inverse fast Fourier transform
- */
-
-#if !defined(RFFTB)
-#define RFFTB rfftb_
-#endif
-extern void RFFTB(const size_t *, float *restrict, float *restrict);
+static inline void
+profile_stage(udsp_state_t *restrict st, const int stage, uint64_t *t)
+{
+    (void) st;
+    (void) stage;
+    (void) t;
+    return;
+}
 
-static void
-fftpack_pack(const udsp_complex_t *restrict in, float *restrict out,
-    const size_t n)
+static inline void
+profile_conv(udsp_state_t *restrict st)
 {
-    size_t i, j, l;
-    assert(in != NULL);
-    assert(out != NULL);
-    assert(n > 0);
-    if (n % 2 == 0) {
-        l = n / 2;
-    } else {
-        l = (n + 1) / 2;
-    }
-    out[0] = in[0].real;
-    j = 1;
-    for (i = 1; i < l; i++) {
-        assert(j + 1 < n);
-        out[j    ] = in[i].real;
-        out[j + 1] = in[i].imag;
-        j += 2;
-    }
-    if (n % 2 == 0) {
-        out[j] = in[l].real;
-    }
+    (void) st;
     return;
 }
 
-static void
-fftpack_ifft(struct _udsp_fft_state *restrict st)
+static inline void
+profile_twiddles(udsp_state_t *restrict st, const int miss)
 {
-    assert(st != NULL);
-    assert(st->size > 0);
-    assert(st->size < UDSP_FFT_SIZE_MAX);
-    fftpack_pack(st->cbuf, st->rbuf, st->size);
-    RFFTB(&(st->size), st->rbuf, st->weights);
-    normalize_real(st->rbuf, st->size, (float) st->size);
+    (void) st;
+    (void) miss;
     return;
 }
 
-void
-udsp_ifft(udsp_state_t *restrict st,
-    const udsp_complex_t *restrict x, const size_t n,
-    float *restrict result)
+static inline void
+profile_copy(udsp_state_t *restrict st, const size_t bytes)
 {
-    struct _udsp_fft_state *fft_st;
-    assert(st != NULL);
-    fft_st = &(st->fft_state);
-    assert(fft_st->method == UDSP_FFT_FFTPACK);
-    if (x != NULL) {
-        assert(n > 0);
-        assert(n < UDSP_FFT_SIZE_MAX);
-        zero_complex(fft_st->cbuf, fft_st->size);
-        copy_complex(fft_st->cbuf, x, min(n, fft_st->size));
-    }
-    switch (fft_st->method) {
-        case UDSP_FFT_FFTPACK:
-            fftpack_ifft(fft_st);
-            break;
-        default:
-            ;
-    }
-    if (result != NULL) {
-        copy_real(result, fft_st->rbuf, fft_st->size);
-    }
+    (void) st;
+    (void) bytes;
     return;
 }
 
+#endif
+
 /*
- * Circular shift
+ * Store the counts of the state st, or the process-wide totals if st
+ * is NULL, in p, and return 1;  without UDSP_PROFILE, store zeros and
+ * return 0.
  */
-
-void
-udsp_fft_shift(udsp_complex_t *restrict x, const size_t n)
+int
+udsp_profile_get(const udsp_state_t *st, udsp_profile_t *p)
 {
-    assert(x != NULL);
-    assert(n > 0);
-    if (n % 2 == 0) {
-        circ_shift_complex(x, n, n / 2);
+    assert(p != NULL);
+#if defined(UDSP_PROFILE)
+    if (st != NULL) {
+        *p = st->fft_state.profile;
     } else {
-        circ_shift_complex(x, n, (n + 1) / 2);
+        size_t i;
+        for (i = 0; i < PROFILE_FIELDS; i++) {
+#if defined(__GNUC__)
+            ((uint64_t *) p)[i] = __atomic_load_n(
+                &((uint64_t *) &profile_total)[i], __ATOMIC_RELAXED);
+#else
+            (void) pthread_mutex_lock(&profile_lock);
+            ((uint64_t *) p)[i] = ((uint64_t *) &profile_total)[i];
+            (void) pthread_mutex_unlock(&profile_lock);
+#endif
+        }
     }
-    return;
+    return 1;
+#else
+    (void) st;
+    *p = profile_zero;
+    return 0;
+#endif
 }
 
 void
-udsp_ifft_shift(udsp_complex_t *restrict x, const size_t n)
+udsp_profile_reset(udsp_state_t *st)
 {
-    assert(x != NULL);
-    assert(n > 0);
-    if (n % 2 == 0) {
-        circ_shift_complex(x, n, n / 2);
+#if defined(UDSP_PROFILE)
+    if (st != NULL) {
+        st->fft_state.profile = profile_zero;
     } else {
-        circ_shift_complex(x, n, (n - 1) / 2);
+        size_t i;
+        for (i = 0; i < PROFILE_FIELDS; i++) {
+#if defined(__GNUC__)
+            __atomic_store_n(&((uint64_t *) &profile_total)[i], 0,
+                __ATOMIC_RELAXED);
+#else
+            (void) pthread_mutex_lock(&profile_lock);
+            ((uint64_t *) &profile_total)[i] = 0;
+            (void) pthread_mutex_unlock(&profile_lock);
+#endif
+        }
     }
+#else
+    (void) st;
+#endif
     return;
 }
 
 /*
- * Convolution
+ * Fast Fourier transform plans
  */
 
-typedef void (*conv_step_t)(udsp_state_t *restrict,
-            const float *restrict, const size_t,
-            const float *restrict, const size_t,
-            float *restrict);
+struct udsp_plan {
+    size_t size;
+    size_t batch;
+    int method;
+    int kind;
+    const float *weights;
+    float *rbuf;
+    udsp_complex_t *cbuf;
+    float *work;
+};
 
-#define CONV_FAMILY_PROTO(NAME)                         \
-        void                                            \
-        NAME(udsp_state_t st[2],                        \
-            const float *restrict x, const size_t m,    \
+#define PLAN_ALIGN 64
+
+/* A plan transforms real or complex data */
+#define PLAN_REAL 0
+#define PLAN_COMPLEX 1
+
+/* FFTPACK takes the transform length as a Fortran INTEGER */
+#define PLAN_SIZE_MAX ((size_t) (INT_MAX / 2 - 16))
+
+#define FFT_METHOD_VALID(x) \
+        ((x) == UDSP_FFT_FFTPACK || (x) == UDSP_FFT_NATIVE)
+
+static inline size_t
+align_up(const size_t x, const size_t a)
+{
+    return (x + a - 1) / a * a;
+}
+
+static struct udsp_plan *
+state_plan(udsp_state_t *restrict st, struct udsp_plan *restrict plan)
+{
+    struct _udsp_fft_state *fft_st;
+    assert(st != NULL);
+    assert(plan != NULL);
+    fft_st = &(st->fft_state);
+    plan->size = fft_st->size;
+    plan->batch = 1;
+    plan->method = fft_st->method;
+    plan->kind = PLAN_REAL;
+    plan->weights = fft_st->weights;
+    plan->rbuf = fft_st->rbuf;
+    plan->cbuf = fft_st->cbuf;
+    plan->work = (float *) &(fft_st->cbuf[half_size(fft_st->size)]);
+    return plan;
+}
+
+/*
+ * Fast Fourier transform initialization
+ */
+
+#if !defined(RFFTI1)
+#define RFFTI1 rffti1_
+#endif
+extern void RFFTI1(const size_t *, float *restrict, float *restrict);
+
+#if !defined(CFFTI1)
+#define CFFTI1 cffti1_
+#endif
+extern void CFFTI1(const size_t *, float *restrict, float *restrict);
+
+#if !defined(COSTI)
+#define COSTI costi_
+#endif
+extern void COSTI(const size_t *, float *restrict);
+
+#if !defined(SINTI)
+#define SINTI sinti_
+#endif
+extern void SINTI(const size_t *, float *restrict);
+
+#if !defined(COSQI)
+#define COSQI cosqi_
+#endif
+extern void COSQI(const size_t *, float *restrict);
+
+/*
+ * The twiddle factors of complex transforms are cached apart from
+ * those of real transforms of the same method and length, under the
+ * key of the method with TWIDDLES_COMPLEX set.
+ */
+#define TWIDDLES_COMPLEX 0x100
+
+/*
+ * The twiddle factors of the double transforms of a state are cached
+ * under the key of the native method with TWIDDLES_DOUBLE set.
+ */
+#define TWIDDLES_DOUBLE 0x400
+
+/*
+ * The tables of the cosine and sine transforms do not depend on the
+ * method:  those of FFTPACK's transforms of types I, and of its
+ * quarter-wave transforms, which compute types II and III, and the
+ * factors of type IV.
+ */
+#define TWIDDLES_COST 0x200
+#define TWIDDLES_SINT 0x201
+#define TWIDDLES_COSQ 0x202
+#define TWIDDLES_QUARTER 0x203
+
+static inline int
+twiddles_key(const int fft_method, const int kind)
+{
+    return (kind == PLAN_COMPLEX) ? (fft_method | TWIDDLES_COMPLEX)
+        : fft_method;
+}
+
+static size_t
+weights_size(const int key, const size_t n)
+{
+    switch (key) {
+        case UDSP_FFT_FFTPACK:
+            return n + 15;
+        case UDSP_FFT_NATIVE:
+            return fftn_weights_size(n);
+        case UDSP_FFT_FFTPACK | TWIDDLES_COMPLEX:
+            return 2 * n + 15;
+        case UDSP_FFT_NATIVE | TWIDDLES_COMPLEX:
+            return fftn_complex_weights_size(n);
+        case UDSP_FFT_NATIVE | TWIDDLES_DOUBLE:
+            /* in floats */
+            return 2 * fftn_weights_size_d(n);
+        case TWIDDLES_COST:
+        case TWIDDLES_SINT:
+        case TWIDDLES_COSQ:
+            return 3 * n + 15;
+        case TWIDDLES_QUARTER:
+            return 2 * n;
+        default:
+            ;
+    }
+    return 0;
+}
+
+static size_t
+work_size(const int fft_method, const size_t n)
+{
+    switch (fft_method) {
+        case UDSP_FFT_FFTPACK:
+            return n;
+        case UDSP_FFT_NATIVE:
+            return fftn_work_size(n);
+        default:
+            ;
+    }
+    return 0;
+}
+
+/*
+ * FFTPACK computes a batch one transform at a time, staged in the
+ * plan's buffers;  the native transform computes up to batch
+ * transforms together.
+ */
+static size_t
+complex_work_size(const int fft_method, const size_t n)
+{
+    switch (fft_method) {
+        case UDSP_FFT_FFTPACK:
+            return 2 * n;
+        case UDSP_FFT_NATIVE:
+            return fftn_complex_work_size(n);
+        default:
+            ;
+    }
+    return 0;
+}
+
+static size_t
+batch_work_size(const int fft_method, const size_t n, const size_t batch)
+{
+    switch (fft_method) {
+        case UDSP_FFT_FFTPACK:
+            return work_size(fft_method, n);
+        case UDSP_FFT_NATIVE:
+            return max(work_size(fft_method, n),
+                fftn_batch_work_size(n, batch));
+        default:
+            ;
+    }
+    return 0;
+}
+
+static void
+fftpack_fft_init(float *restrict weights, const size_t n)
+{
+    assert(weights != NULL);
+    assert(n > 0);
+    assert(n < PLAN_SIZE_MAX);
+    if (n > 1) {
+        RFFTI1(&n, &weights[0], &weights[n]);
+    }
+    return;
+}
+
+static void
+fftpack_cfft_init(float *restrict weights, const size_t n)
+{
+    assert(weights != NULL);
+    assert(n > 0);
+    assert(n < PLAN_SIZE_MAX);
+    if (n > 1) {
+        CFFTI1(&n, &weights[0], &weights[2 * n]);
+    }
+    return;
+}
+
+static void
+fftpack_trig_init(const int key, float *restrict weights, const size_t n)
+{
+    assert(weights != NULL);
+    assert(n > 0);
+    assert(n < PLAN_SIZE_MAX);
+    /* the routines leave the tables of the shortest lengths unset */
+    zero_real(weights, weights_size(key, n));
+    switch (key) {
+        case TWIDDLES_COST:
+            COSTI(&n, weights);
+            break;
+        case TWIDDLES_SINT:
+            SINTI(&n, weights);
+            break;
+        case TWIDDLES_COSQ:
+            COSQI(&n, weights);
+            break;
+        default:
+            ;
+    }
+    return;
+}
+
+/*
+ * Type IV of even length n is computed by a complex transform of
+ * length n / 2, with the factors exp(-i pi k / n) applied before and
+ * exp(-i pi (4 k + 1) / (4 n)) after;  of odd length, from types II
+ * of x times cos and sin (pi (2 k + 1) / (4 n)).
+ */
+static void
+quarter_init(float *restrict weights, const size_t n)
+{
+    const double pi = 3.14159265358979323846264338327950288;
+    size_t k, m;
+    double a;
+    assert(weights != NULL);
+    assert(n > 0);
+    if (n % 2 == 0) {
+        m = n / 2;
+        for (k = 0; k < m; k++) {
+            a = pi * (double) k / (double) n;
+            weights[k] = (float) cos(a);
+            weights[m + k] = (float) sin(a);
+            a = pi * (double) (4 * k + 1) / (double) (4 * n);
+            weights[2 * m + k] = (float) cos(a);
+            weights[3 * m + k] = (float) sin(a);
+        }
+    } else {
+        for (k = 0; k < n; k++) {
+            a = pi * (double) (2 * k + 1) / (double) (4 * n);
+            weights[k] = (float) cos(a);
+            weights[n + k] = (float) sin(a);
+        }
+    }
+    return;
+}
+
+/*
+ * The twiddle factors for a given length and key are computed
+ * once and shared by every plan and state in the process.  Cache
+ * entries are immutable once published and are never freed, so
+ * lookups take no lock;  only insertions are serialized.
+ */
+
+struct twiddles {
+    const struct twiddles *next;
+    size_t size;
+    int key;
+    int unused;     /* aligns the weights for the tables of doubles */
+    float weights[];
+};
+
+#define TWIDDLE_CACHE_BUCKETS 64
+
+static const struct twiddles *twiddle_cache[TWIDDLE_CACHE_BUCKETS];
+static pthread_mutex_t twiddle_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#if defined(__GNUC__)
+#define LOAD_ACQUIRE(p)         __atomic_load_n(&(p), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, x)     __atomic_store_n(&(p), (x), __ATOMIC_RELEASE)
+#define LOCKFREE_LOAD 1
+#else
+#define LOAD_ACQUIRE(p)         (p)
+#define STORE_RELEASE(p, x)     ((p) = (x))
+#define LOCKFREE_LOAD 0
+#endif
+
+static inline size_t
+twiddle_cache_hash(const int key, const size_t n)
+{
+    return ((n * 2654435761U) ^ (size_t) key) % TWIDDLE_CACHE_BUCKETS;
+}
+
+static const struct twiddles *
+twiddle_cache_find(const int key, const size_t n)
+{
+    const struct twiddles *tw;
+    tw = LOAD_ACQUIRE(twiddle_cache[twiddle_cache_hash(key, n)]);
+    while (tw != NULL) {
+        if (tw->size == n && tw->key == key) {
+            break;
+        }
+        tw = tw->next;
+    }
+    return tw;
+}
+
+static const struct twiddles *
+twiddle_cache_insert(const int key, const size_t n)
+{
+    struct twiddles *tw;
+    size_t h;
+    h = twiddle_cache_hash(key, n);
+    tw = malloc(sizeof(struct twiddles)
+        + weights_size(key, n) * sizeof(float));
+    if (tw == NULL) {
+        return NULL;
+    }
+    tw->size = n;
+    tw->key = key;
+    switch (key) {
+        case UDSP_FFT_FFTPACK:
+            fftpack_fft_init(tw->weights, n);
+            break;
+        case UDSP_FFT_NATIVE:
+            fftn_init(tw->weights, n);
+            break;
+        case UDSP_FFT_FFTPACK | TWIDDLES_COMPLEX:
+            fftpack_cfft_init(tw->weights, n);
+            break;
+        case UDSP_FFT_NATIVE | TWIDDLES_COMPLEX:
+            fftn_complex_init(tw->weights, n);
+            break;
+        case UDSP_FFT_NATIVE | TWIDDLES_DOUBLE:
+            fftn_init_d((double *) tw->weights, n);
+            break;
+        case TWIDDLES_COST:
+        case TWIDDLES_SINT:
+        case TWIDDLES_COSQ:
+            fftpack_trig_init(key, tw->weights, n);
+            break;
+        case TWIDDLES_QUARTER:
+            quarter_init(tw->weights, n);
+            break;
+        default:
+            ;
+    }
+    tw->next = twiddle_cache[h];
+    STORE_RELEASE(twiddle_cache[h], (const struct twiddles *) tw);
+    return tw;
+}
+
+/* As twiddles_get, setting miss if the factors had to be computed */
+static const float *
+twiddles_lookup(const int key, const size_t n, int *restrict miss)
+{
+    const struct twiddles *tw;
+    assert(n > 0);
+    assert(miss != NULL);
+    *miss = 0;
+    if (LOCKFREE_LOAD) {
+        tw = twiddle_cache_find(key, n);
+        if (tw != NULL) {
+            return tw->weights;
+        }
+    }
+    (void) pthread_mutex_lock(&twiddle_cache_lock);
+    tw = twiddle_cache_find(key, n);
+    if (tw == NULL) {
+        tw = twiddle_cache_insert(key, n);
+        *miss = 1;
+    }
+    (void) pthread_mutex_unlock(&twiddle_cache_lock);
+    return (tw == NULL) ? NULL : tw->weights;
+}
+
+static const float *
+twiddles_get(const int key, const size_t n)
+{
+    int miss;
+    return twiddles_lookup(key, n, &miss);
+}
+
+static void
+fft_init(udsp_state_t *restrict st, const int fft_method, const size_t l,
+    const float *restrict x, const size_t n)
+{
+    struct _udsp_fft_state *fft_st;
+    int miss;
+    assert(st != NULL);
+    assert(FFT_METHOD_VALID(fft_method));
+    assert(l > 0);
+    assert(l < UDSP_FFT_SIZE_MAX);
+    fft_st = &(st->fft_state);
+    zero_real(fft_st->rbuf, l);
+    zero_complex(fft_st->cbuf, l);
+    if (x != NULL) {
+        assert(n > 0);
+        assert(n < UDSP_FFT_SIZE_MAX);
+        copy_real(fft_st->rbuf, x, min(l, n));
+        profile_copy(st, min(l, n) * sizeof(float));
+    }
+    if (fft_st->size == l && fft_st->method == fft_method) {
+        profile_twiddles(st, 0);
+        return;
+    }
+    fft_st->weights = twiddles_lookup(fft_method, l, &miss);
+    profile_twiddles(st, miss);
+    if (fft_st->weights == NULL) {
+        abort();
+    }
+    fft_st->size = l;
+    fft_st->method = fft_method;
+    return;
+}
+
+void
+udsp_fft_init(udsp_state_t *restrict st, const int fft_method,
+    const size_t n)
+{
+    assert(st != NULL);
+    assert(FFT_METHOD_VALID(fft_method));
+    assert(n > 0);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    fft_init(st, fft_method, n, NULL, 0);
+    st->fft_state.arith = 0;
+    return;
+}
+
+void
+udsp_set_arith(udsp_state_t *st, const int arith)
+{
+    assert(st != NULL);
+    assert(arith == UDSP_ARITH_SATURATE || arith == UDSP_ARITH_FAST);
+    st->fft_state.arith = arith;
+    return;
+}
+
+static size_t
+plan_work_size(const int fft_method, const int kind, const size_t n,
+    const size_t batch)
+{
+    if (kind == PLAN_COMPLEX) {
+        return complex_work_size(fft_method, n);
+    }
+    return batch_work_size(fft_method, n, batch);
+}
+
+static size_t
+plan_size(const int fft_method, const int kind, const size_t n,
+    const size_t batch)
+{
+    size_t size;
+    assert(FFT_METHOD_VALID(fft_method));
+    assert(n > 0);
+    assert(n < PLAN_SIZE_MAX);
+    assert(batch > 0);
+    assert(batch < PLAN_SIZE_MAX / n);
+    size = align_up(sizeof(struct udsp_plan), PLAN_ALIGN);
+    size += align_up(n * sizeof(float), PLAN_ALIGN);
+    size += align_up(n * sizeof(udsp_complex_t), PLAN_ALIGN);
+    size += align_up(plan_work_size(fft_method, kind, n, batch)
+        * sizeof(float), PLAN_ALIGN);
+    return size;
+}
+
+size_t
+udsp_plan_size(const int fft_method, const size_t n)
+{
+    return plan_size(fft_method, PLAN_REAL, n, 1);
+}
+
+static struct udsp_plan *
+plan_create(const int fft_method, const int kind, const size_t n,
+    const size_t batch)
+{
+    struct udsp_plan *plan;
+    const float *weights;
+    void *mem;
+    char *p;
+    assert(FFT_METHOD_VALID(fft_method));
+    assert(n > 0);
+    assert(n < PLAN_SIZE_MAX);
+    assert(batch > 0);
+    assert(batch < PLAN_SIZE_MAX / n);
+    weights = twiddles_get(twiddles_key(fft_method, kind), n);
+    if (weights == NULL) {
+        return NULL;
+    }
+    if (posix_memalign(&mem, PLAN_ALIGN,
+            plan_size(fft_method, kind, n, batch)) != 0) {
+        return NULL;
+    }
+    p = mem;
+    plan = mem;
+    p += align_up(sizeof(struct udsp_plan), PLAN_ALIGN);
+    plan->rbuf = (float *) p;
+    p += align_up(n * sizeof(float), PLAN_ALIGN);
+    plan->cbuf = (udsp_complex_t *) p;
+    p += align_up(n * sizeof(udsp_complex_t), PLAN_ALIGN);
+    plan->work = (float *) p;
+    plan->weights = weights;
+    plan->size = n;
+    plan->batch = batch;
+    plan->method = fft_method;
+    plan->kind = kind;
+    zero_real(plan->rbuf, n);
+    zero_complex(plan->cbuf, n);
+    return plan;
+}
+
+udsp_plan_t *
+udsp_plan_create(const int fft_method, const size_t n)
+{
+    return plan_create(fft_method, PLAN_REAL, n, 1);
+}
+
+udsp_plan_t *
+udsp_plan_create_batch(const int fft_method, const size_t n,
+    const size_t batch)
+{
+    return plan_create(fft_method, PLAN_REAL, n, batch);
+}
+
+udsp_plan_t *
+udsp_plan_create_complex(const int fft_method, const size_t n)
+{
+    return plan_create(fft_method, PLAN_COMPLEX, n, 1);
+}
+
+void
+udsp_plan_destroy(udsp_plan_t *plan)
+{
+    free(plan);
+    return;
+}
+
+size_t
+udsp_plan_length(const udsp_plan_t *plan)
+{
+    assert(plan != NULL);
+    return plan->size;
+}
+
+/*
+ * Fast Fourier transform
+ */
+
+#if !defined(UDSP_FFT_DEFAULT)
+#define UDSP_FFT_DEFAULT UDSP_FFT_FFTPACK
+#endif
+
+size_t
+udsp_fft_max_size(void)
+{
+    return UDSP_FFT_SIZE_MAX;
+}
+
+/*
+ * Both backends have passes for the factors 2, 3, 4 and 5;  other
+ * prime factors p take a direct DFT pass of order p times the length.
+ */
+size_t
+udsp_fft_fast_size(const size_t n)
+{
+    size_t best, p2, p3, p5;
+    assert(n > 0);
+    assert(n <= ((size_t) -1) / 5);
+    best = (size_t) -1;
+    for (p5 = 1; ; p5 *= 5) {
+        for (p3 = p5; ; p3 *= 3) {
+            for (p2 = p3; p2 < n; p2 *= 2) {
+                ;
+            }
+            best = min(best, p2);
+            if (p3 >= n) {
+                break;
+            }
+        }
+        if (p5 >= n) {
+            break;
+        }
+    }
+    return best;
+}
+
+#if !defined(RFFTF1)
+#define RFFTF1 rfftf1_
+#endif
+extern void RFFTF1(const size_t *, float *restrict, float *restrict,
+    const float *restrict, const float *restrict);
+
+/*
+ * FFTPACK computes the transform in place, as the real part of the
+ * first coefficient followed by the real and imaginary parts of the
+ * others.  Computed one float into y, this is the layout of the half
+ * spectrum but for the first imaginary part (and the last, for even n),
+ * which is zero.  The samples are read from the floats y[1] to y[n].
+ */
+static void
+fftpack_fft_placed(struct udsp_plan *restrict plan, udsp_complex_t *y)
+{
+    float *yf;
+    assert(plan != NULL);
+    assert(plan->size > 0);
+    assert(plan->size < PLAN_SIZE_MAX);
+    yf = (float *) &y[0];
+    if (plan->size > 1) {
+        RFFTF1(&(plan->size), &yf[1], plan->work,
+            &(plan->weights[0]), &(plan->weights[plan->size]));
+    }
+    yf[0] = yf[1];
+    yf[1] = 0.f;
+    if (plan->size % 2 == 0) {
+        yf[plan->size + 1] = 0.f;
+    }
+    return;
+}
+
+/*
+ * The samples x are first placed one float into y.
+ */
+static void
+fftpack_fft(struct udsp_plan *restrict plan,
+    const float *x, udsp_complex_t *y)
+{
+    float *yf;
+    size_t i;
+    assert(plan != NULL);
+    yf = (float *) &y[0];
+    for (i = plan->size; i-- > 0;) {
+        yf[i + 1] = x[i];
+    }
+    fftpack_fft_placed(plan, y);
+    return;
+}
+
+static void
+native_fft(struct udsp_plan *restrict plan,
+    const float *x, udsp_complex_t *y)
+{
+    assert(plan != NULL);
+    assert(plan->size > 0);
+    assert(plan->size < PLAN_SIZE_MAX);
+    fftn_forward(plan->size, plan->weights, x, y, plan->work);
+    return;
+}
+
+/*
+ * Compute the half spectrum, the first n / 2 + 1 coefficients, of the
+ * n samples x into y.  The arrays x and y may be the same.
+ */
+static void
+exec_rfft(struct udsp_plan *restrict plan,
+    const float *x, udsp_complex_t *y)
+{
+    assert(plan != NULL);
+    assert(plan->kind == PLAN_REAL);
+    assert(FFT_METHOD_VALID(plan->method));
+    assert(x != NULL);
+    assert(y != NULL);
+    switch (plan->method) {
+        case UDSP_FFT_FFTPACK:
+            fftpack_fft(plan, x, y);
+            break;
+        case UDSP_FFT_NATIVE:
+            native_fft(plan, x, y);
+            break;
+        default:
+            ;
+    }
+    return;
+}
+
+/*
+ * Fill the upper half of the spectrum of length n from the conjugates
+ * of the lower half.
+ */
+#define DEFINE_MIRROR_FN(NAME, TYPE)                            \
+        static void                                             \
+        NAME(TYPE *restrict x, const size_t n)                  \
+        {                                                       \
+            size_t i;                                           \
+            assert(x != NULL);                                  \
+            assert(n > 0);                                      \
+            for (i = 1; i < (n + 1) / 2; i++) {                 \
+                x[n - i].real = x[i].real;                      \
+                x[n - i].imag = -x[i].imag;                     \
+            }                                                   \
+            return;                                             \
+        }
+
+DEFINE_MIRROR_FN(mirror_complex, udsp_complex_t)
+DEFINE_MIRROR_FN(mirror_complex_d, udsp_complex_d_t)
+
+/*
+ * Return the input to transform:  x itself if it has the plan's length,
+ * or else x zero-padded or truncated into the plan's real buffer, or
+ * the real buffer if x is NULL.
+ */
+static const float *
+plan_input(struct udsp_plan *restrict plan,
+    const float *restrict x, const size_t n)
+{
+    assert(plan != NULL);
+    if (x == NULL) {
+        return plan->rbuf;
+    }
+    assert(n > 0);
+    if (n == plan->size) {
+        return x;
+    }
+    zero_real(plan->rbuf, plan->size);
+    copy_real(plan->rbuf, x, min(n, plan->size));
+    return plan->rbuf;
+}
+
+/*
+ * Compute the half spectrum of the input into result, or into the
+ * plan's complex buffer if result is NULL.
+ */
+static void
+plan_rfft(struct udsp_plan *restrict plan,
+    const float *restrict x, const size_t n,
+    udsp_complex_t *restrict result)
+{
+    assert(plan != NULL);
+    exec_rfft(plan, plan_input(plan, x, n),
+        (result != NULL) ? result : plan->cbuf);
+    return;
+}
+
+static void
+plan_fft(struct udsp_plan *restrict plan,
+    const float *restrict x, const size_t n,
+    udsp_complex_t *restrict result)
+{
+    udsp_complex_t *out;
+    assert(plan != NULL);
+    out = (result != NULL) ? result : plan->cbuf;
+    exec_rfft(plan, plan_input(plan, x, n), out);
+    mirror_complex(out, plan->size);
+    return;
+}
+
+void
+udsp_plan_fft(udsp_plan_t *restrict plan,
+    const float *restrict x, const size_t n,
+    udsp_complex_t *restrict result)
+{
+    assert(plan != NULL);
+    plan_fft(plan, x, n, result);
+    return;
+}
+
+/*
+ * Compute the half spectra of howmany transforms:  sample k of
+ * transform b is read from x[b * xd + k * xs], and coefficient k of
+ * its spectrum is written to y[b * yd + k * ys].
+ */
+static void
+exec_rfft_batch(struct udsp_plan *restrict plan, const size_t howmany,
+    const float *restrict x, const size_t xs, const size_t xd,
+    udsp_complex_t *restrict y, const size_t ys, const size_t yd)
+{
+    size_t b, k, nb;
+    assert(plan != NULL);
+    assert(plan->kind == PLAN_REAL);
+    assert(FFT_METHOD_VALID(plan->method));
+    switch (plan->method) {
+        case UDSP_FFT_FFTPACK:
+            for (b = 0; b < howmany; b++) {
+                for (k = 0; k < plan->size; k++) {
+                    plan->rbuf[k] = x[b * xd + k * xs];
+                }
+                fftpack_fft(plan, plan->rbuf, plan->cbuf);
+                for (k = 0; k < half_size(plan->size); k++) {
+                    y[b * yd + k * ys] = plan->cbuf[k];
+                }
+            }
+            break;
+        case UDSP_FFT_NATIVE:
+            for (b = 0; b < howmany; b += nb) {
+                nb = min(plan->batch, howmany - b);
+                fftn_forward_batch(plan->size, nb, plan->weights,
+                    &x[b * xd], xs, xd, &y[b * yd], ys, yd, plan->work);
+            }
+            break;
+        default:
+            ;
+    }
+    return;
+}
+
+void
+udsp_plan_execute_r2c(udsp_plan_t *restrict plan,
+    const float *x, udsp_complex_t *y)
+{
+    assert(plan != NULL);
+    assert(x != NULL);
+    assert(y != NULL);
+    exec_rfft(plan, x, y);
+    return;
+}
+
+void
+udsp_plan_execute_r2c_batch(udsp_plan_t *restrict plan, const size_t howmany,
+    const float *restrict x, const size_t istride, const size_t idist,
+    udsp_complex_t *restrict y, const size_t ostride, const size_t odist)
+{
+    assert(plan != NULL);
+    assert(x != NULL);
+    assert(y != NULL);
+    assert(istride > 0);
+    assert(ostride > 0);
+    exec_rfft_batch(plan, howmany, x, istride, idist, y, ostride, odist);
+    return;
+}
+
+void
+udsp_plan_rfft(udsp_plan_t *restrict plan,
+    const float *restrict x, const size_t n,
+    udsp_complex_t *restrict result)
+{
+    assert(plan != NULL);
+    plan_rfft(plan, x, n, result);
+    return;
+}
+
+void
+udsp_fft(udsp_state_t *restrict st,
+    const float *restrict x, const size_t n,
+    udsp_complex_t *restrict result)
+{
+    struct udsp_plan plan;
+    assert(st != NULL);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    plan_fft(state_plan(st, &plan), x, n, result);
+    return;
+}
+
+void
+udsp_rfft(udsp_state_t *restrict st,
+    const float *restrict x, const size_t n,
+    udsp_complex_t *restrict result)
+{
+    struct udsp_plan plan;
+    assert(st != NULL);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    plan_rfft(state_plan(st, &plan), x, n, result);
+    return;
+}
+
+/*
+ * Inverse fast Fourier transform
+ */
+
+#if !defined(RFFTB1)
+#define RFFTB1 rfftb1_
+#endif
+extern void RFFTB1(const size_t *, float *restrict, float *restrict,
+    const float *restrict, const float *restrict);
+
+/*
+ * The half spectrum is packed into x as FFTPACK expects, the reverse
+ * of the above, and divided by n in the same pass.  A product with
+ * 1 / n cannot overflow, so it needs no saturating arithmetic.
+ */
+static void
+fftpack_ifft(struct udsp_plan *restrict plan,
+    const udsp_complex_t *y, float *x)
+{
+    const float *yf;
+    float scale;
+    size_t i;
+    assert(plan != NULL);
+    assert(plan->size > 0);
+    assert(plan->size < PLAN_SIZE_MAX);
+    yf = (const float *) &y[0];
+    scale = 1.f / (float) plan->size;
+    x[0] = yf[0] * scale;
+    for (i = 1; i < plan->size; i++) {
+        x[i] = yf[i + 1] * scale;
+    }
+    if (plan->size > 1) {
+        RFFTB1(&(plan->size), x, plan->work,
+            &(plan->weights[0]), &(plan->weights[plan->size]));
+    }
+    return;
+}
+
+static void
+native_ifft(struct udsp_plan *restrict plan,
+    const udsp_complex_t *y, float *x)
+{
+    assert(plan != NULL);
+    assert(plan->size > 0);
+    assert(plan->size < PLAN_SIZE_MAX);
+    fftn_backward(plan->size, plan->weights, y, x, plan->work);
+    return;
+}
+
+/*
+ * Compute the n samples of the inverse FFT of the half spectrum y into
+ * x.  The arrays y and x may be the same.
+ */
+static void
+exec_irfft(struct udsp_plan *restrict plan,
+    const udsp_complex_t *y, float *x)
+{
+    assert(plan != NULL);
+    assert(plan->kind == PLAN_REAL);
+    assert(FFT_METHOD_VALID(plan->method));
+    assert(y != NULL);
+    assert(x != NULL);
+    switch (plan->method) {
+        case UDSP_FFT_FFTPACK:
+            fftpack_ifft(plan, y, x);
+            break;
+        case UDSP_FFT_NATIVE:
+            native_ifft(plan, y, x);
+            break;
+        default:
+            ;
+    }
+    return;
+}
+
+/*
+ * Compute the inverse FFT of the half spectrum x, or of the plan's
+ * complex buffer if x is NULL, into result, or into the plan's real
+ * buffer if result is NULL.  Only the first n / 2 + 1 coefficients are
+ * read;  a shorter x is first copied, zero-padded, into the complex
+ * buffer.
+ */
+static void
+plan_irfft(struct udsp_plan *restrict plan,
+    const udsp_complex_t *restrict x, const size_t n,
+    float *restrict result)
+{
+    const udsp_complex_t *in;
+    assert(plan != NULL);
+    in = plan->cbuf;
+    if (x != NULL) {
+        assert(n > 0);
+        if (n >= half_size(plan->size)) {
+            in = x;
+        } else {
+            zero_complex(plan->cbuf, half_size(plan->size));
+            copy_complex(plan->cbuf, x, n);
+        }
+    }
+    exec_irfft(plan, in, (result != NULL) ? result : plan->rbuf);
+    return;
+}
+
+void
+udsp_plan_ifft(udsp_plan_t *restrict plan,
+    const udsp_complex_t *restrict x, const size_t n,
+    float *restrict result)
+{
+    assert(plan != NULL);
+    plan_irfft(plan, x, n, result);
+    return;
+}
+
+/*
+ * The inverse of exec_rfft_batch:  coefficient k of transform b is
+ * read from y[b * yd + k * ys], and sample k of its inverse is written
+ * to x[b * xd + k * xs].
+ */
+static void
+exec_irfft_batch(struct udsp_plan *restrict plan, const size_t howmany,
+    const udsp_complex_t *restrict y, const size_t ys, const size_t yd,
+    float *restrict x, const size_t xs, const size_t xd)
+{
+    size_t b, k, nb;
+    assert(plan != NULL);
+    assert(plan->kind == PLAN_REAL);
+    assert(FFT_METHOD_VALID(plan->method));
+    switch (plan->method) {
+        case UDSP_FFT_FFTPACK:
+            for (b = 0; b < howmany; b++) {
+                for (k = 0; k < half_size(plan->size); k++) {
+                    plan->cbuf[k] = y[b * yd + k * ys];
+                }
+                fftpack_ifft(plan, plan->cbuf, plan->rbuf);
+                for (k = 0; k < plan->size; k++) {
+                    x[b * xd + k * xs] = plan->rbuf[k];
+                }
+            }
+            break;
+        case UDSP_FFT_NATIVE:
+            for (b = 0; b < howmany; b += nb) {
+                nb = min(plan->batch, howmany - b);
+                fftn_backward_batch(plan->size, nb, plan->weights,
+                    &y[b * yd], ys, yd, &x[b * xd], xs, xd, plan->work);
+            }
+            break;
+        default:
+            ;
+    }
+    return;
+}
+
+void
+udsp_plan_execute_c2r(udsp_plan_t *restrict plan,
+    const udsp_complex_t *y, float *x)
+{
+    assert(plan != NULL);
+    assert(y != NULL);
+    assert(x != NULL);
+    exec_irfft(plan, y, x);
+    return;
+}
+
+void
+udsp_plan_execute_c2r_batch(udsp_plan_t *restrict plan, const size_t howmany,
+    const udsp_complex_t *restrict y, const size_t istride,
+    const size_t idist,
+    float *restrict x, const size_t ostride, const size_t odist)
+{
+    assert(plan != NULL);
+    assert(y != NULL);
+    assert(x != NULL);
+    assert(istride > 0);
+    assert(ostride > 0);
+    exec_irfft_batch(plan, howmany, y, istride, idist, x, ostride, odist);
+    return;
+}
+
+void
+udsp_plan_irfft(udsp_plan_t *restrict plan,
+    const udsp_complex_t *restrict x, const size_t n,
+    float *restrict result)
+{
+    assert(plan != NULL);
+    plan_irfft(plan, x, n, result);
+    return;
+}
+
+void
+udsp_ifft(udsp_state_t *restrict st,
+    const udsp_complex_t *restrict x, const size_t n,
+    float *restrict result)
+{
+    struct udsp_plan plan;
+    assert(st != NULL);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    plan_irfft(state_plan(st, &plan), x, n, result);
+    return;
+}
+
+void
+udsp_irfft(udsp_state_t *restrict st,
+    const udsp_complex_t *restrict x, const size_t n,
+    float *restrict result)
+{
+    struct udsp_plan plan;
+    assert(st != NULL);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    plan_irfft(state_plan(st, &plan), x, n, result);
+    return;
+}
+
+/*
+ * Fixed-point input and output
+ *
+ * The samples of a fixed-point signal are scaled and converted on
+ * their way into the array the transform reads, which is zero-padded
+ * or truncated to the length of the plan in the same pass:  for
+ * FFTPACK the output array itself, one float in, transformed in place;
+ * for the native FFT the real buffer, which it splits into its work
+ * space.  Integers of more than 24 bits are rounded to floats.
+ */
+
+#define DEFINE_LOAD_FIXED_FN(NAME, TYPE)                        \
+        static void                                             \
+        NAME(float *restrict dst, const size_t size,            \
+            const TYPE *restrict x, const size_t n,             \
+            const float scale)                                  \
+        {                                                       \
+            size_t i, l;                                        \
+            l = min(n, size);                                   \
+            for (i = 0; i < l; i++) {                           \
+                dst[i] = scale * (float) x[i];                  \
+            }                                                   \
+            for (; i < size; i++) {                             \
+                dst[i] = 0.f;                                   \
+            }                                                   \
+            return;                                             \
+        }
+
+DEFINE_LOAD_FIXED_FN(load_s16, int16_t)
+DEFINE_LOAD_FIXED_FN(load_s32, int32_t)
+
+/*
+ * Compute the half spectrum of the n samples x, times scale, into
+ * result, or into the plan's complex buffer if result is NULL.
+ */
+#define DEFINE_PLAN_RFFT_FIXED_FN(NAME, TYPE, LOAD)                 \
+        static udsp_complex_t *                                     \
+        NAME(struct udsp_plan *restrict plan,                       \
+            const TYPE *restrict x, const size_t n,                 \
+            const float scale, udsp_complex_t *restrict result)     \
+        {                                                           \
+            udsp_complex_t *out;                                    \
+            assert(plan != NULL);                                   \
+            assert(plan->kind == PLAN_REAL);                        \
+            assert(FFT_METHOD_VALID(plan->method));                 \
+            assert(x != NULL);                                      \
+            assert(n > 0);                                          \
+            out = (result != NULL) ? result : plan->cbuf;           \
+            switch (plan->method) {                                 \
+                case UDSP_FFT_FFTPACK:                              \
+                    LOAD(&((float *) out)[1], plan->size,           \
+                        x, n, scale);                               \
+                    fftpack_fft_placed(plan, out);                  \
+                    break;                                          \
+                case UDSP_FFT_NATIVE:                               \
+                    LOAD(plan->rbuf, plan->size, x, n, scale);      \
+                    native_fft(plan, plan->rbuf, out);              \
+                    break;                                          \
+                default:                                            \
+                    ;                                               \
+            }                                                       \
+            return out;                                             \
+        }
+
+DEFINE_PLAN_RFFT_FIXED_FN(plan_rfft_s16, int16_t, load_s16)
+DEFINE_PLAN_RFFT_FIXED_FN(plan_rfft_s32, int32_t, load_s32)
+
+void
+udsp_fft_s16(udsp_state_t *restrict st,
+    const int16_t *restrict x, const size_t n, const float scale,
+    udsp_complex_t *restrict result)
+{
+    struct udsp_plan plan;
+    udsp_complex_t *out;
+    assert(st != NULL);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    out = plan_rfft_s16(state_plan(st, &plan), x, n, scale, result);
+    mirror_complex(out, plan.size);
+    return;
+}
+
+void
+udsp_fft_s32(udsp_state_t *restrict st,
+    const int32_t *restrict x, const size_t n, const float scale,
+    udsp_complex_t *restrict result)
+{
+    struct udsp_plan plan;
+    udsp_complex_t *out;
+    assert(st != NULL);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    out = plan_rfft_s32(state_plan(st, &plan), x, n, scale, result);
+    mirror_complex(out, plan.size);
+    return;
+}
+
+void
+udsp_rfft_s16(udsp_state_t *restrict st,
+    const int16_t *restrict x, const size_t n, const float scale,
+    udsp_complex_t *restrict result)
+{
+    struct udsp_plan plan;
+    assert(st != NULL);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    (void) plan_rfft_s16(state_plan(st, &plan), x, n, scale, result);
+    return;
+}
+
+void
+udsp_rfft_s32(udsp_state_t *restrict st,
+    const int32_t *restrict x, const size_t n, const float scale,
+    udsp_complex_t *restrict result)
+{
+    struct udsp_plan plan;
+    assert(st != NULL);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    (void) plan_rfft_s32(state_plan(st, &plan), x, n, scale, result);
+    return;
+}
+
+/*
+ * Round x to the nearest 16-bit integer, saturating, with NaN giving
+ * zero.
+ */
+static inline int16_t
+store_s16(const float x)
+{
+    if (x != x) {
+        return 0;
+    }
+    if (x >= (float) INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (x <= (float) INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t) lrintf(x);
+}
+
+void
+udsp_ifft_s16(udsp_state_t *restrict st,
+    const udsp_complex_t *restrict x, const size_t n, const float scale,
+    int16_t *restrict result)
+{
+    struct udsp_plan plan;
+    float inv;
+    size_t i;
+    assert(st != NULL);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    assert(scale != 0.f);
+    assert(result != NULL);
+    plan_irfft(state_plan(st, &plan), x, n, NULL);
+    inv = 1.f / scale;
+    for (i = 0; i < plan.size; i++) {
+        result[i] = store_s16(inv * plan.rbuf[i]);
+    }
+    return;
+}
+
+/*
+ * Complex fast Fourier transform
+ */
+
+#if !defined(CFFTF1)
+#define CFFTF1 cfftf1_
+#endif
+extern void CFFTF1(const size_t *, float *restrict, float *restrict,
+    const float *restrict, const float *restrict);
+
+#if !defined(CFFTB1)
+#define CFFTB1 cfftb1_
+#endif
+extern void CFFTB1(const size_t *, float *restrict, float *restrict,
+    const float *restrict, const float *restrict);
+
+/*
+ * FFTPACK computes the complex transform in place, on interleaved
+ * real and imaginary parts:  x is first copied into y, divided by n
+ * for the inverse transform.
+ */
+static void
+fftpack_cfft(struct udsp_plan *restrict plan,
+    const udsp_complex_t *x, udsp_complex_t *y, const int inverse)
+{
+    float scale;
+    size_t i;
+    assert(plan != NULL);
+    assert(plan->size > 0);
+    assert(plan->size < PLAN_SIZE_MAX);
+    if (inverse) {
+        scale = 1.f / (float) plan->size;
+        for (i = 0; i < plan->size; i++) {
+            y[i].real = x[i].real * scale;
+            y[i].imag = x[i].imag * scale;
+        }
+    } else if (x != y) {
+        copy_complex(y, x, plan->size);
+    }
+    if (plan->size == 1) {
+        return;
+    }
+    if (inverse) {
+        CFFTB1(&(plan->size), (float *) y, plan->work,
+            &(plan->weights[0]), &(plan->weights[2 * plan->size]));
+    } else {
+        CFFTF1(&(plan->size), (float *) y, plan->work,
+            &(plan->weights[0]), &(plan->weights[2 * plan->size]));
+    }
+    return;
+}
+
+/*
+ * Compute the FFT, or the inverse FFT divided by n, of the n points x
+ * into y.  The arrays x and y may be the same.
+ */
+static void
+exec_cfft(struct udsp_plan *restrict plan,
+    const udsp_complex_t *x, udsp_complex_t *y, const int inverse)
+{
+    assert(plan != NULL);
+    assert(plan->kind == PLAN_COMPLEX);
+    assert(FFT_METHOD_VALID(plan->method));
+    assert(x != NULL);
+    assert(y != NULL);
+    switch (plan->method) {
+        case UDSP_FFT_FFTPACK:
+            fftpack_cfft(plan, x, y, inverse);
+            break;
+        case UDSP_FFT_NATIVE:
+            if (inverse) {
+                fftn_complex_backward(plan->size, plan->weights, x, y,
+                    plan->work);
+            } else {
+                fftn_complex_forward(plan->size, plan->weights, x, y,
+                    plan->work);
+            }
+            break;
+        default:
+            ;
+    }
+    return;
+}
+
+/*
+ * Transform the first n points of x, zero-padded to the plan's length
+ * in the plan's complex buffer if n is shorter, into result.
+ */
+static void
+plan_cfft(struct udsp_plan *restrict plan,
+    const udsp_complex_t *restrict x, const size_t n,
+    udsp_complex_t *restrict result, const int inverse)
+{
+    const udsp_complex_t *in;
+    assert(plan != NULL);
+    assert(x != NULL);
+    assert(n > 0);
+    assert(result != NULL);
+    in = x;
+    if (n < plan->size) {
+        zero_complex(plan->cbuf, plan->size);
+        copy_complex(plan->cbuf, x, n);
+        in = plan->cbuf;
+    }
+    exec_cfft(plan, in, result, inverse);
+    return;
+}
+
+void
+udsp_plan_cfft(udsp_plan_t *restrict plan,
+    const udsp_complex_t *restrict x, const size_t n,
+    udsp_complex_t *restrict result)
+{
+    plan_cfft(plan, x, n, result, 0);
+    return;
+}
+
+void
+udsp_plan_icfft(udsp_plan_t *restrict plan,
+    const udsp_complex_t *restrict x, const size_t n,
+    udsp_complex_t *restrict result)
+{
+    plan_cfft(plan, x, n, result, 1);
+    return;
+}
+
+/*
+ * A state computes complex transforms of length n, at most its own,
+ * with the cached twiddle factors, staging a short input in its real
+ * buffer, which holds 2 UDSP_FFT_SIZE_MAX floats, and using its
+ * complex buffer as work space.
+ */
+static struct udsp_plan *
+state_complex_plan(udsp_state_t *restrict st,
+    struct udsp_plan *restrict plan, const size_t n)
+{
+    struct _udsp_fft_state *fft_st;
+    assert(st != NULL);
+    assert(plan != NULL);
+    fft_st = &(st->fft_state);
+    assert(FFT_METHOD_VALID(fft_st->method));
+    assert(n > 0);
+    assert(n <= fft_st->size);
+    assert(fft_st->size < UDSP_FFT_SIZE_MAX);
+    plan->size = n;
+    plan->batch = 1;
+    plan->method = fft_st->method;
+    plan->kind = PLAN_COMPLEX;
+    plan->weights = twiddles_get(
+        twiddles_key(fft_st->method, PLAN_COMPLEX), n);
+    if (plan->weights == NULL) {
+        abort();
+    }
+    plan->rbuf = NULL;
+    plan->cbuf = (udsp_complex_t *) fft_st->rbuf;
+    plan->work = (float *) fft_st->cbuf;
+    return plan;
+}
+
+void
+udsp_cfft(udsp_state_t *restrict st,
+    const udsp_complex_t *restrict x, const size_t n,
+    udsp_complex_t *restrict result)
+{
+    struct udsp_plan plan;
+    assert(st != NULL);
+    assert(x != NULL);
+    assert(result != NULL);
+    plan_cfft(state_complex_plan(st, &plan, st->fft_state.size),
+        x, n, result, 0);
+    return;
+}
+
+void
+udsp_icfft(udsp_state_t *restrict st,
+    const udsp_complex_t *restrict x, const size_t n,
+    udsp_complex_t *restrict result)
+{
+    struct udsp_plan plan;
+    assert(st != NULL);
+    assert(x != NULL);
+    assert(result != NULL);
+    plan_cfft(state_complex_plan(st, &plan, st->fft_state.size),
+        x, n, result, 1);
+    return;
+}
+
+/*
+ * Discrete cosine and sine transforms
+ *
+ * The transforms are unnormalized, as in FFTW:  type I of length l is
+ * its own inverse up to a factor of 2 (l - 1) for the cosine transform
+ * and 2 (l + 1) for the sine transform;  types II and III are inverses
+ * of each other, and type IV its own inverse, up to a factor of 2 l.
+ */
+
+#if !defined(COST)
+#define COST cost_
+#endif
+extern void COST(const size_t *, float *restrict, float *restrict);
+
+#if !defined(SINT)
+#define SINT sint_
+#endif
+extern void SINT(const size_t *, float *restrict, float *restrict);
+
+#if !defined(COSQF)
+#define COSQF cosqf_
+#endif
+extern void COSQF(const size_t *, float *restrict, float *restrict);
+
+#if !defined(COSQB)
+#define COSQB cosqb_
+#endif
+extern void COSQB(const size_t *, float *restrict, float *restrict);
+
+#if !defined(SINQF)
+#define SINQF sinqf_
+#endif
+extern void SINQF(const size_t *, float *restrict, float *restrict);
+
+#if !defined(SINQB)
+#define SINQB sinqb_
+#endif
+extern void SINQB(const size_t *, float *restrict, float *restrict);
+
+static const float *
+trig_weights(const int key, const size_t n)
+{
+    const float *weights;
+    weights = twiddles_get(key, n);
+    if (weights == NULL) {
+        abort();
+    }
+    return weights;
+}
+
+/*
+ * FFTPACK's routines use part of their table as scratch space, so a
+ * state works on a copy of the cached table in its complex buffer,
+ * which holds 4 UDSP_FFT_SIZE_MAX floats.
+ */
+static float *
+trig_work(struct _udsp_fft_state *restrict fft_st, const int key)
+{
+    float *work;
+    work = (float *) fft_st->cbuf;
+    copy_real(work, trig_weights(key, fft_st->size),
+        weights_size(key, fft_st->size));
+    return work;
+}
+
+/*
+ * Copy the first n samples of x, times scale, zero-padded or
+ * truncated to l samples, into y, in reverse order if reverse is set.
+ */
+static void
+trig_input(const float *restrict x, const size_t n, float *restrict y,
+    const size_t l, const float scale, const int reverse)
+{
+    size_t i, m;
+    m = min(l, n);
+    if (reverse) {
+        zero_real(y, l - m);
+        for (i = 0; i < m; i++) {
+            y[l - 1 - i] = x[i] * scale;
+        }
+    } else {
+        for (i = 0; i < m; i++) {
+            y[i] = x[i] * scale;
+        }
+        zero_real(&y[m], l - m);
+    }
+    return;
+}
+
+/*
+ * Compute the type IV cosine transform of the l samples of y in place
+ * (see quarter_init).
+ */
+static void
+dct4(udsp_state_t *restrict st, float *restrict y)
+{
+    struct _udsp_fft_state *fft_st;
+    struct udsp_plan plan;
+    const float *w;
+    udsp_complex_t *u;
+    float *v, *work;
+    size_t k, l, m;
+    float a, b;
+    fft_st = &(st->fft_state);
+    l = fft_st->size;
+    w = trig_weights(TWIDDLES_QUARTER, l);
+    if (l % 2 == 0) {
+        m = l / 2;
+        u = (udsp_complex_t *) fft_st->rbuf;
+        for (k = 0; k < m; k++) {
+            a = y[2 * k];
+            b = y[l - 1 - 2 * k];
+            u[k].real = a * w[k] + b * w[m + k];
+            u[k].imag = b * w[k] - a * w[m + k];
+        }
+        exec_cfft(state_complex_plan(st, &plan, m), u, u, 0);
+        for (k = 0; k < m; k++) {
+            a = u[k].real * w[2 * m + k] + u[k].imag * w[3 * m + k];
+            b = u[k].imag * w[2 * m + k] - u[k].real * w[3 * m + k];
+            y[2 * k] = 2.f * a;
+            y[l - 1 - 2 * k] = -2.f * b;
+        }
+    } else {
+        /* FFTPACK's type II is twice that of FFTW */
+        v = fft_st->rbuf;
+        for (k = 0; k < l; k++) {
+            v[k] = 0.5f * y[k] * w[l + k];
+            y[k] = 0.5f * y[k] * w[k];
+        }
+        work = trig_work(fft_st, TWIDDLES_COSQ);
+        COSQB(&l, y, work);
+        SINQB(&l, v, work);
+        for (k = 1; k < l; k++) {
+            y[k] -= v[k - 1];
+        }
+    }
+    return;
+}
+
+/*
+ * Compute the discrete cosine transform of the given type, 1 to 4, of
+ * the first n samples of x, zero-padded or truncated to the length of
+ * the state, into result.
+ */
+void
+udsp_dct(udsp_state_t *restrict st, const int type,
+    const float *restrict x, const size_t n, float *restrict result)
+{
+    struct _udsp_fft_state *fft_st;
+    size_t l;
+    assert(st != NULL);
+    assert(x != NULL);
+    assert(n > 0);
+    assert(result != NULL);
+    assert(type >= 1 && type <= 4);
+    fft_st = &(st->fft_state);
+    l = fft_st->size;
+    assert(l > 0);
+    assert(l < UDSP_FFT_SIZE_MAX);
+    switch (type) {
+        case 1:
+            assert(l > 1);
+            trig_input(x, n, result, l, 1.f, 0);
+            COST(&l, result, trig_work(fft_st, TWIDDLES_COST));
+            break;
+        case 2:
+            trig_input(x, n, result, l, 0.5f, 0);
+            COSQB(&l, result, trig_work(fft_st, TWIDDLES_COSQ));
+            break;
+        case 3:
+            trig_input(x, n, result, l, 1.f, 0);
+            COSQF(&l, result, trig_work(fft_st, TWIDDLES_COSQ));
+            break;
+        case 4:
+            trig_input(x, n, result, l, 1.f, 0);
+            dct4(st, result);
+            break;
+        default:
+            ;
+    }
+    return;
+}
+
+/*
+ * Compute the discrete sine transform of the given type, as udsp_dct.
+ * Type IV is that of the cosine transform of x reversed, with the sign
+ * of every other coefficient changed.
+ */
+void
+udsp_dst(udsp_state_t *restrict st, const int type,
+    const float *restrict x, const size_t n, float *restrict result)
+{
+    struct _udsp_fft_state *fft_st;
+    size_t k, l;
+    assert(st != NULL);
+    assert(x != NULL);
+    assert(n > 0);
+    assert(result != NULL);
+    assert(type >= 1 && type <= 4);
+    fft_st = &(st->fft_state);
+    l = fft_st->size;
+    assert(l > 0);
+    assert(l < UDSP_FFT_SIZE_MAX);
+    switch (type) {
+        case 1:
+            trig_input(x, n, result, l, 1.f, 0);
+            SINT(&l, result, trig_work(fft_st, TWIDDLES_SINT));
+            break;
+        case 2:
+            trig_input(x, n, result, l, 0.5f, 0);
+            SINQB(&l, result, trig_work(fft_st, TWIDDLES_COSQ));
+            break;
+        case 3:
+            trig_input(x, n, result, l, 1.f, 0);
+            SINQF(&l, result, trig_work(fft_st, TWIDDLES_COSQ));
+            break;
+        case 4:
+            trig_input(x, n, result, l, 1.f, 1);
+            dct4(st, result);
+            for (k = 1; k < l; k += 2) {
+                result[k] = -result[k];
+            }
+            break;
+        default:
+            ;
+    }
+    return;
+}
+
+/*
+ * Circular shift
+ */
+
+void
+udsp_fft_shift(udsp_complex_t *restrict x, const size_t n)
+{
+    assert(x != NULL);
+    assert(n > 0);
+    if (n % 2 == 0) {
+        circ_shift_complex(x, n, n / 2);
+    } else {
+        circ_shift_complex(x, n, (n + 1) / 2);
+    }
+    return;
+}
+
+void
+udsp_ifft_shift(udsp_complex_t *restrict x, const size_t n)
+{
+    assert(x != NULL);
+    assert(n > 0);
+    if (n % 2 == 0) {
+        circ_shift_complex(x, n, n / 2);
+    } else {
+        circ_shift_complex(x, n, (n - 1) / 2);
+    }
+    return;
+}
+
+/*
+ * Convolution
+ */
+
+typedef void (*conv_step_t)(udsp_state_t *restrict,
+            const float *restrict, const size_t,
+            const float *restrict, const size_t,
+            float *restrict);
+
+typedef void (*conv_step_d_t)(udsp_state_d_t *restrict,
+            const double *restrict, const size_t,
+            const double *restrict, const size_t,
+            double *restrict);
+
+#define CONV_FAMILY_PROTO(NAME, STATE, REAL)            \
+        void                                            \
+        NAME(STATE st[2],                               \
+            const REAL *restrict x, const size_t m,     \
+            const REAL *restrict y, const size_t n,     \
+            REAL *restrict result)
+
+/* as CONV_FAMILY_PROTO, with the state declared as in udsp.h */
+#define CONV_ENTRY_PROTO(NAME, STATE, REAL)             \
+        void                                            \
+        NAME(STATE *restrict st,                        \
+            const REAL *restrict x, const size_t m,     \
+            const REAL *restrict y, const size_t n,     \
+            REAL *restrict result)
+
+#define CONV_STEPS_MAX 4
+
+#define DEFINE_EXEC_CONV_STEPS_FN(NAME, STEP, STATE, REAL)      \
+        static inline void                                      \
+        NAME(const STEP steps[], STATE st[2],                   \
+            const REAL *restrict x, const size_t m,             \
+            const REAL *restrict y, const size_t n,             \
+            REAL *restrict result)                              \
+        {                                                       \
+            size_t i;                                           \
+            assert(steps != NULL);                              \
+            for (i = 0; i < CONV_STEPS_MAX; i++) {              \
+                if (steps[i] == NULL) {                         \
+                    break;                                      \
+                }                                               \
+                (*steps[i])(st, x, m, y, n, result);            \
+            }                                                   \
+            return;                                             \
+        }
+
+DEFINE_EXEC_CONV_STEPS_FN(exec_conv_steps, conv_step_t,
+    udsp_state_t, float)
+DEFINE_EXEC_CONV_STEPS_FN(exec_conv_steps_d, conv_step_d_t,
+    udsp_state_d_t, double)
+
+#define CONV_PRE_FFT     0
+#define CONV_POST_FFT    1
+#define CONV_PRE_IFFT    2
+#define CONV_POST_IFFT   3
+
+static void
+mul_spectrum(const int fast, udsp_complex_t *restrict x,
+    const udsp_complex_t *restrict y, const size_t l)
+{
+    float a, b, c, d;
+    size_t i;
+    assert(x != NULL);
+    assert(y != NULL);
+    if (fast
+            && arith_mul_safe((const float *) x, 2 * l)
+            && arith_mul_safe((const float *) y, 2 * l)) {
+        for (i = 0; i < l; i++) {
+            a = x[i].real;
+            b = x[i].imag;
+            c = y[i].real;
+            d = y[i].imag;
+            x[i].real = a * c - b * d;
+            x[i].imag = a * d + b * c;
+        }
+        return;
+    }
+    for (i = 0; i < l; i++) {
+        mul_complex(&x[i], &x[i], &y[i]);
+    }
+    return;
+}
+
+static inline void
+fft_mul(struct _udsp_fft_state *restrict st1,
+    struct _udsp_fft_state *restrict st2)
+{
+    assert(st1 != NULL);
+    assert(st2 != NULL);
+    assert(st1->size > 0);
+    assert(st1->size < UDSP_FFT_SIZE_MAX);
+    assert(st1->size >= st2->size);
+    mul_spectrum(arith_fast(st1), st1->cbuf, st2->cbuf,
+        half_size(st1->size));
+    return;
+}
+
+/*
+ * Direct convolution
+ *
+ * The convolution of short signals is cheaper computed directly, as
+ * the correlation of the longer signal, padded with zeros, with the
+ * shorter reversed:  about l q multiply-adds for the l outputs and the
+ * q samples of the shorter signal, a lane of the native kernels at a
+ * time, against about s log2(s) for the transforms of the fast length
+ * s.  The constants, in nanoseconds, are measured on x86-64 (AVX-512)
+ * with FFTPACK, the default method, and the default arithmetic.
+ */
+
+#define CONV_DIRECT_MAC     0.75
+#define CONV_DIRECT_POINT   1.5
+#define CONV_FFT_POINT      3.5
+#define CONV_FFT_FIXED      500.0
+
+/*
+ * The same in double precision, with the native FFT and plain
+ * arithmetic.
+ */
+#define CONV_DIRECT_MAC_D   0.4
+#define CONV_FFT_POINT_D    2.0
+
+static int
+conv_direct_cheaper(const size_t m, const size_t n, const size_t size,
+    const size_t lanes, const double mac, const double fft_point)
+{
+    double direct, fft, l;
+    l = (double) (m + n - 1);
+    direct = mac * l * (double) min(m, n) / (double) lanes
+        + CONV_DIRECT_POINT * l;
+    fft = fft_point * (double) size * log2((double) size)
+        + CONV_FFT_FIXED;
+    return (direct < fft);
+}
+
+/*
+ * Plain arithmetic is used only if no sum of products can overflow,
+ * even after removing the means, whatever the arithmetic policy;
+ * otherwise the saturating transforms are used.
+ */
+static int
+conv_direct_safe(const float *restrict x, const size_t m,
+    const float *restrict y, const size_t n)
+{
+    double bound;
+    bound = (double) flt_absmax(x, m) * (double) flt_absmax(y, n)
+        * (double) min(m, n);
+    return (bound < (double) FLT_MAX / 4.0);
+}
+
+/*
+ * Convolve the m samples in the real buffer of st[0] with the n in
+ * that of st[1], into the former, using their complex buffers, which
+ * hold 4 UDSP_FFT_SIZE_MAX floats, for the padded and reversed signals.
+ */
+static void
+conv_direct(udsp_state_t st[2], const size_t m, const size_t n)
+{
+    const float *u, *v;
+    float *a, *b;
+    size_t i, p, q;
+    a = (float *) st[0].fft_state.cbuf;
+    b = (float *) st[1].fft_state.cbuf;
+    u = st[0].fft_state.rbuf;
+    v = st[1].fft_state.rbuf;
+    p = m;
+    q = n;
+    if (m < n) {
+        u = st[1].fft_state.rbuf;
+        v = st[0].fft_state.rbuf;
+        p = n;
+        q = m;
+    }
+    zero_real(a, q - 1);
+    copy_real(&a[q - 1], u, p);
+    zero_real(&a[p + q - 1], q - 1);
+    for (i = 0; i < q; i++) {
+        b[i] = v[q - 1 - i];
+    }
+    fftn_correlate(a, p + 2 * (q - 1), b, q, st[0].fft_state.rbuf);
+    return;
+}
+
+static void
+conv(udsp_state_t st[2],
+    const float *restrict x, const size_t m,
+    const float *restrict y, const size_t n,
+    float *restrict result,
+    const conv_step_t steps[][CONV_STEPS_MAX])
+{
+    size_t l, size;
+    uint64_t t;
+
+    assert(st != NULL);
+    assert(x != NULL);
+    assert(y != NULL);
+    assert(m > 0);
+    assert(m < UDSP_FFT_SIZE_MAX);
+    assert(n > 0);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    assert(steps != NULL);
+
+    profile_conv(&st[0]);
+    profile_start(&t);
+
+    l = m + n - 1;
+    size = udsp_fft_fast_size(l);
+    if (size >= UDSP_FFT_SIZE_MAX) {
+        size = l;
+    }
+
+    /* the steps in the frequency domain have no direct counterpart */
+    if (conv_direct_cheaper(m, n, size, fftn_lanes(), CONV_DIRECT_MAC,
+            CONV_FFT_POINT) && conv_direct_safe(x, m, y, n)) {
+        copy_real(st[0].fft_state.rbuf, x, m);
+        copy_real(st[1].fft_state.rbuf, y, n);
+        profile_copy(&st[0], (m + n) * sizeof(float));
+        exec_conv_steps(steps[CONV_PRE_FFT], st, x, m, y, n, result);
+        profile_stage(&st[0], UDSP_PROFILE_PRE_FFT, &t);
+        conv_direct(st, m, n);
+        profile_stage(&st[0], UDSP_PROFILE_DIRECT, &t);
+        exec_conv_steps(steps[CONV_POST_IFFT], st, x, m, y, n, result);
+        if (result != NULL) {
+            copy_real(result, st[0].fft_state.rbuf, l);
+            profile_copy(&st[0], l * sizeof(float));
+        }
+        profile_stage(&st[0], UDSP_PROFILE_POST_IFFT, &t);
+        return;
+    }
+
+    fft_init(&st[0], UDSP_FFT_DEFAULT, size, x, m);
+    fft_init(&st[1], UDSP_FFT_DEFAULT, size, y, n);
+
+    exec_conv_steps(steps[CONV_PRE_FFT], st, x, m, y, n, result);
+    profile_stage(&st[0], UDSP_PROFILE_PRE_FFT, &t);
+    udsp_rfft(&st[0], NULL, 0, NULL);
+    udsp_rfft(&st[1], NULL, 0, NULL);
+    profile_stage(&st[0], UDSP_PROFILE_FFT, &t);
+    exec_conv_steps(steps[CONV_POST_FFT], st, x, m, y, n, result);
+    profile_stage(&st[0], UDSP_PROFILE_POST_FFT, &t);
+
+    fft_mul(&(st[0].fft_state), &(st[1].fft_state));
+    profile_stage(&st[0], UDSP_PROFILE_MUL, &t);
+
+    exec_conv_steps(steps[CONV_PRE_IFFT], st, x, m, y, n, result);
+    profile_stage(&st[0], UDSP_PROFILE_PRE_IFFT, &t);
+    udsp_irfft(&st[0], NULL, 0, NULL);
+    profile_stage(&st[0], UDSP_PROFILE_IFFT, &t);
+    exec_conv_steps(steps[CONV_POST_IFFT], st, x, m, y, n, result);
+
+    if (result != NULL) {
+        copy_real(result, st[0].fft_state.rbuf, l);
+        profile_copy(&st[0], l * sizeof(float));
+    }
+    profile_stage(&st[0], UDSP_PROFILE_POST_IFFT, &t);
+
+    return;
+}
+
+CONV_FAMILY_PROTO(udsp_conv, udsp_state_t, float)
+{
+    assert(st != NULL);
+    assert(x != NULL);
+    assert(m > 0);
+    assert(m < UDSP_FFT_SIZE_MAX);
+    assert(n > 0);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    assert(result != NULL);
+    conv(st, x, m, y, n, result,
+        (const conv_step_t [][CONV_STEPS_MAX]) {
+            [CONV_PRE_FFT] = {NULL},
+            [CONV_POST_FFT] = {NULL},
+            [CONV_PRE_IFFT] = {NULL},
+            [CONV_POST_IFFT] = {NULL},
+        }
+    );
+    return;
+}
+
+/*
+ * Cross-covariance
+ */
+
+#define DEFINE_TIME_DOMAIN_REVERSE_FN(NAME, STATE, REAL, REVERSE)  \
+        static                                                     \
+        CONV_FAMILY_PROTO(NAME, STATE, REAL)                       \
+        {                                                          \
+            assert(st != NULL);                                    \
+            assert(st[1].fft_state.rbuf != NULL);                  \
+            assert(n > 0);                                         \
+            assert(n < UDSP_FFT_SIZE_MAX);                         \
+            (void) x;                                              \
+            (void) y;                                              \
+            (void) m;                                              \
+            (void) result;                                         \
+            REVERSE(st[1].fft_state.rbuf, n);                      \
+            return;                                                \
+        }
+
+DEFINE_TIME_DOMAIN_REVERSE_FN(time_domain_reverse,
+    udsp_state_t, float, reverse_real)
+DEFINE_TIME_DOMAIN_REVERSE_FN(time_domain_reverse_d,
+    udsp_state_d_t, double, reverse_real_d)
+
+static
+CONV_FAMILY_PROTO(time_domain_normalize, udsp_state_t, float)
+{
+    assert(st != NULL);
+    assert(st[0].fft_state.rbuf != NULL);
+    assert(m > 0);
+    assert(m < UDSP_FFT_SIZE_MAX);
+    assert(n > 0);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    (void) x;
+    (void) y;
+    (void) result;
+    arith_normalize_real(arith_fast(&(st[0].fft_state)),
+        st[0].fft_state.rbuf, m + n - 1, max(m, n));
+    return;
+}
+
+static const conv_step_t xcov_steps[][CONV_STEPS_MAX] = {
+    [CONV_PRE_FFT] = {
+        &time_domain_reverse,
+        NULL
+    },
+    [CONV_POST_FFT] = {NULL},
+    [CONV_PRE_IFFT] = {NULL},
+    [CONV_POST_IFFT] = {
+        &time_domain_normalize,
+        NULL
+    },
+};
+
+CONV_FAMILY_PROTO(udsp_xcov, udsp_state_t, float)
+{
+    assert(st != NULL);
+    assert(x != NULL);
+    assert(m > 0);
+    assert(m < UDSP_FFT_SIZE_MAX);
+    assert(n > 0);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    assert(result != NULL);
+    conv(st, x, m, y, n, result, xcov_steps);
+    return;
+}
+
+/*
+ * Cross-correlation
+ */
+
+static inline int
+demean_plain(const int fast, const float *restrict x, const size_t n)
+{
+    return fast && flt_absmax(x, n) < FLT_MAX / (float) (2 * n);
+}
+
+static inline float
+mean_real(const int plain, const float *restrict x, const size_t n)
+{
+    float sum;
+    size_t i;
+    if (plain) {
+        sum = 0.f;
+        for (i = 0; i < n; i++) {
+            sum += x[i];
+        }
+        return sum / (float) n;
+    }
+    return flt_div(flt_sum(x, n), (float) n);
+}
+
+static inline void
+demean_real(const int fast, float *restrict x, const size_t n)
+{
+    float mean;
+    size_t i;
+    int plain;
+    plain = demean_plain(fast, x, n);
+    mean = mean_real(plain, x, n);
+    if (plain) {
+        for (i = 0; i < n; i++) {
+            x[i] -= mean;
+        }
+        return;
+    }
+    for (i = 0; i < n; i++) {
+        x[i] = flt_add(x[i], -mean);
+    }
+    return;
+}
+
+static
+CONV_FAMILY_PROTO(time_domain_demean, udsp_state_t, float)
+{
+    assert(st != NULL);
+    assert(m > 0);
+    assert(m < UDSP_FFT_SIZE_MAX);
+    assert(n > 0);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    (void) x;
+    (void) y;
+    (void) result;
+    demean_real(arith_fast(&(st[0].fft_state)), st[0].fft_state.rbuf, m);
+    demean_real(arith_fast(&(st[0].fft_state)), st[1].fft_state.rbuf, n);
+    return;
+}
+
+static const conv_step_t xcor_steps[][CONV_STEPS_MAX] = {
+    [CONV_PRE_FFT] = {
+        &time_domain_demean,
+        &time_domain_reverse,
+        NULL
+    },
+    [CONV_POST_FFT] = {NULL},
+    [CONV_PRE_IFFT] = {NULL},
+    [CONV_POST_IFFT] = {
+        &time_domain_normalize,
+        NULL
+    },
+};
+
+CONV_FAMILY_PROTO(udsp_xcor, udsp_state_t, float)
+{
+    conv(st, x, m, y, n, result, xcor_steps);
+    return;
+}
+
+/*
+ * Normalized cross-correlation
+ */
+
+static
+CONV_FAMILY_PROTO(time_domain_demean_template, udsp_state_t, float)
+{
+    assert(st != NULL);
+    assert(n > 0);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    (void) x;
+    (void) y;
+    (void) m;
+    (void) result;
+    demean_real(arith_fast(&(st[0].fft_state)), st[1].fft_state.rbuf, n);
+    return;
+}
+
+/*
+ * Divide the correlations with the demeaned template by the norms of
+ * the template and of each window of the signal under it, from sums
+ * of the window and its squares kept in double precision as it slides.
+ * A window whose variance is within the rounding error of these sums,
+ * relative to the energy of the whole signal, correlates with nothing.
+ */
+static void
+nxcor_normalize(const float *restrict c,
+    const float *restrict x, const size_t m,
+    const float *restrict y, const size_t n,
+    float *restrict result)
+{
+    double e, ey, my, r, s, s2, v;
+    size_t i;
+    my = 0.;
+    for (i = 0; i < n; i++) {
+        my += (double) y[i];
+    }
+    my /= (double) n;
+    ey = 0.;
+    for (i = 0; i < n; i++) {
+        ey += ((double) y[i] - my) * ((double) y[i] - my);
+    }
+    e = 0.;
+    for (i = 0; i < m; i++) {
+        e += (double) x[i] * (double) x[i];
+    }
+    e *= DBL_EPSILON * (double) m;
+    s = 0.;
+    s2 = 0.;
+    for (i = 0; i < n - 1; i++) {
+        s += (double) x[i];
+        s2 += (double) x[i] * (double) x[i];
+    }
+    for (i = 0; i < m - n + 1; i++) {
+        s += (double) x[i + n - 1];
+        s2 += (double) x[i + n - 1] * (double) x[i + n - 1];
+        v = s2 - s * s / (double) n;
+        if (v <= e || ey <= 0.) {
+            result[i] = 0.f;
+        } else {
+            r = (double) c[i] / sqrt(v * ey);
+            result[i] = (float) ((r > 1.) ? 1. : ((r < -1.) ? -1. : r));
+        }
+        s -= (double) x[i];
+        s2 -= (double) x[i] * (double) x[i];
+    }
+    return;
+}
+
+CONV_ENTRY_PROTO(udsp_nxcor, udsp_state_t, float)
+{
+    assert(st != NULL);
+    assert(x != NULL);
+    assert(y != NULL);
+    assert(m < UDSP_FFT_SIZE_MAX);
+    assert(n > 0);
+    assert(n <= m);
+    assert(result != NULL);
+    conv(st, x, m, y, n, NULL,
+        (const conv_step_t [][CONV_STEPS_MAX]) {
+            [CONV_PRE_FFT] = {
+                &time_domain_demean_template,
+                &time_domain_reverse,
+                NULL
+            },
+            [CONV_POST_FFT] = {NULL},
+            [CONV_PRE_IFFT] = {NULL},
+            [CONV_POST_IFFT] = {NULL},
+        }
+    );
+    nxcor_normalize(&(st[0].fft_state.rbuf[n - 1]), x, m, y, n, result);
+    return;
+}
+
+/*
+ * Lag-limited correlation
+ *
+ * Only the lags -L, ..., L of the correlation d(k) = sum_j u[j + k] s[j]
+ * of the longer signal u, of length p, with the shorter s, of length q,
+ * are computed, in whichever of three ways the cost model of the
+ * direct convolution estimates cheapest:  directly, as l = 2 L + 1
+ * outputs of the native kernels;  by FFTs of blocks of s against the
+ * segments of u under them at those lags;  or by the full convolution,
+ * if it fits in a state.  If no transform is short enough and the
+ * products could overflow, the lags are computed directly with
+ * saturating arithmetic.
+ */
+
+/*
+ * Copy the elements lo - pad, ..., lo - pad + len - 1 of x, of length
+ * m, less its mean, into dst, with zeros outside of x.
+ */
+static void
+lag_window(const int plain, float *restrict dst,
+    const float *restrict x, const size_t m,
+    const size_t lo, const size_t pad, const size_t len, const float mean)
+{
+    size_t i, t;
+    for (t = 0; t < len; t++) {
+        i = lo + t;
+        if (i < pad || i - pad >= m) {
+            dst[t] = 0.f;
+        } else if (plain) {
+            dst[t] = x[i - pad] - mean;
+        } else {
+            dst[t] = flt_add(x[i - pad], -mean);
+        }
+    }
+    return;
+}
+
+struct lag_signal {
+    const float *x;
+    size_t n;
+    float mean;
+    int plain;
+};
+
+static void
+lag_direct(udsp_state_t st[2], const struct lag_signal *u,
+    const struct lag_signal *s, const size_t lags, float *restrict z)
+{
+    float *a, *b;
+    a = (float *) st[0].fft_state.cbuf;
+    b = (float *) st[1].fft_state.cbuf;
+    lag_window(u->plain, a, u->x, u->n, 0, lags, 2 * lags + s->n, u->mean);
+    lag_window(s->plain, b, s->x, s->n, 0, 0, s->n, s->mean);
+    fftn_correlate(a, 2 * lags + s->n, b, s->n, z);
+    return;
+}
+
+/*
+ * As lag_direct, with saturating arithmetic, for signals whose sums of
+ * products could overflow when no transform is short enough.
+ */
+static void
+lag_direct_saturate(udsp_state_t st[2], const struct lag_signal *u,
+    const struct lag_signal *s, const size_t lags, float *restrict z)
+{
+    float *a, *b;
+    float sum;
+    size_t i, j;
+    a = (float *) st[0].fft_state.cbuf;
+    b = (float *) st[1].fft_state.cbuf;
+    lag_window(u->plain, a, u->x, u->n, 0, lags, 2 * lags + s->n, u->mean);
+    lag_window(s->plain, b, s->x, s->n, 0, 0, s->n, s->mean);
+    for (i = 0; i < 2 * lags + 1; i++) {
+        sum = 0.f;
+        for (j = 0; j < s->n; j++) {
+            sum = flt_add(sum, flt_mul(a[i + j], b[j]));
+        }
+        z[i] = sum;
+    }
+    return;
+}
+
+/*
+ * The transforms of length size hold a block of s of size - 2 L
+ * samples, reversed, and the segment of u 2 L longer under it, so that
+ * the circular convolution has the 2 L + 1 lags free of wrap-around.
+ * The cheapest of the lengths from about 4 L, doubling up to a single
+ * block, is returned, with its cost, or zero if none is small enough.
+ */
+static double
+lag_fft_cost(const size_t size)
+{
+    return CONV_FFT_POINT * (double) size * log2((double) size)
+        + CONV_FFT_FIXED;
+}
+
+static size_t
+lag_blocks_size(const size_t q, const size_t lags, double *cost)
+{
+    size_t best, l, last, size;
+    double c;
+    best = 0;
+    *cost = HUGE_VAL;
+    last = udsp_fft_fast_size(q + 2 * lags);
+    l = max(4 * lags + 2, 64);
+    for (;;) {
+        size = min(udsp_fft_fast_size(l), last);
+        if (size >= UDSP_FFT_SIZE_MAX) {
+            break;
+        }
+        c = lag_fft_cost(size)
+            * (double) ((q + size - 2 * lags - 1) / (size - 2 * lags));
+        if (c < *cost) {
+            best = size;
+            *cost = c;
+        }
+        if (size == last) {
+            break;
+        }
+        l *= 2;
+    }
+    return best;
+}
+
+static void
+lag_blocks(udsp_state_t st[2], const struct lag_signal *u,
+    const struct lag_signal *s, const size_t lags, const size_t size,
+    float *restrict z)
+{
+    size_t b, c, k;
+    k = size - 2 * lags;
+    zero_real(z, 2 * lags + 1);
+    for (b = 0; b < s->n; b += k) {
+        c = min(k, s->n - b);
+        fft_init(&st[0], UDSP_FFT_DEFAULT, size, NULL, 0);
+        fft_init(&st[1], UDSP_FFT_DEFAULT, size, NULL, 0);
+        lag_window(u->plain, st[0].fft_state.rbuf, u->x, u->n,
+            b, lags, c + 2 * lags, u->mean);
+        lag_window(s->plain, st[1].fft_state.rbuf, s->x, s->n,
+            b, 0, c, s->mean);
+        reverse_real(st[1].fft_state.rbuf, c);
+        udsp_rfft(&st[0], NULL, 0, NULL);
+        udsp_rfft(&st[1], NULL, 0, NULL);
+        fft_mul(&(st[0].fft_state), &(st[1].fft_state));
+        udsp_irfft(&st[0], NULL, 0, NULL);
+        add_real(arith_fast(&(st[0].fft_state)), z,
+            &(st[0].fft_state.rbuf[c - 1]), 2 * lags + 1);
+    }
+    return;
+}
+
+static void
+xcov_lags(udsp_state_t st[2],
+    const float *restrict x, const size_t m,
+    const float *restrict y, const size_t n,
+    const size_t lags, float *restrict result,
+    const conv_step_t steps[][CONV_STEPS_MAX], const int demean)
+{
+    struct lag_signal sx, sy;
+    const struct lag_signal *u, *s;
+    double direct, blocks, full;
+    size_t i, k, l, size, full_size, le;
+    float *z;
+    int fast;
+
+    fast = arith_fast(&(st[0].fft_state));
+    u = (m >= n) ? &sx : &sy;
+    s = (m >= n) ? &sy : &sx;
+    le = min(lags, max(m, n) - 1);
+    l = 2 * le + 1;
+    z = &result[lags - le];
+    zero_real(result, 2 * lags + 1);
+
+    direct = HUGE_VAL;
+    if (conv_direct_safe(x, m, y, n)) {
+        direct = CONV_DIRECT_MAC * (double) l * (double) min(m, n)
+            / (double) fftn_lanes()
+            + CONV_DIRECT_POINT * (double) (l + min(m, n));
+    }
+    size = lag_blocks_size(min(m, n), le, &blocks);
+    /* the full convolution must fit in a state */
+    full = HUGE_VAL;
+    if (m + n - 1 < UDSP_FFT_SIZE_MAX) {
+        full_size = udsp_fft_fast_size(m + n - 1);
+        if (full_size >= UDSP_FFT_SIZE_MAX) {
+            full_size = m + n - 1;
+        }
+        full = lag_fft_cost(full_size);
+    }
+
+    if (full < HUGE_VAL && full <= direct && full <= blocks) {
+        conv(st, x, m, y, n, NULL, steps);
+        /* the lag k - le is at k - le + n - 1 in the full result */
+        for (i = 0; i < l; i++) {
+            k = i + n - 1;
+            if (k >= le && k - le < m + n - 1) {
+                z[i] = st[0].fft_state.rbuf[k - le];
+            }
+        }
+        return;
+    }
+
+    sx.x = x;
+    sx.n = m;
+    sy.x = y;
+    sy.n = n;
+    sx.plain = demean_plain(fast, x, m);
+    sy.plain = demean_plain(fast, y, n);
+    sx.mean = demean ? mean_real(sx.plain, x, m) : 0.f;
+    sy.mean = demean ? mean_real(sy.plain, y, n) : 0.f;
+    if (blocks < direct) {
+        lag_blocks(st, u, s, le, size, z);
+    } else if (direct < HUGE_VAL) {
+        lag_direct(st, u, s, le, z);
+    } else {
+        lag_direct_saturate(st, u, s, le, z);
+    }
+    if (u != &sx) {
+        reverse_real(z, l);
+    }
+    arith_normalize_real(fast, z, l, max(m, n));
+    return;
+}
+
+#define CONV_LAGS_PROTO(NAME)                           \
+        void                                            \
+        NAME(udsp_state_t *restrict st,                 \
+            const float *restrict x, const size_t m,    \
             const float *restrict y, const size_t n,    \
-            float *restrict result)
+            const size_t lags, float *restrict result)
+
+CONV_LAGS_PROTO(udsp_xcov_lags)
+{
+    assert(st != NULL);
+    assert(x != NULL);
+    assert(y != NULL);
+    assert(m > 0);
+    assert(m < UDSP_FFT_SIZE_MAX);
+    assert(n > 0);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    assert(lags < UDSP_FFT_SIZE_MAX);
+    assert(result != NULL);
+    xcov_lags(st, x, m, y, n, lags, result, xcov_steps, 0);
+    return;
+}
+
+CONV_LAGS_PROTO(udsp_xcor_lags)
+{
+    assert(st != NULL);
+    assert(x != NULL);
+    assert(y != NULL);
+    assert(m > 0);
+    assert(m < UDSP_FFT_SIZE_MAX);
+    assert(n > 0);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    assert(lags < UDSP_FFT_SIZE_MAX);
+    assert(result != NULL);
+    xcov_lags(st, x, m, y, n, lags, result, xcor_steps, 1);
+    return;
+}
+
+#undef CONV_LAGS_PROTO
+
+/*
+ * Correlation matrix
+ *
+ * The correlation of channels i and j is the inverse transform of the
+ * product of the spectrum of i with the conjugate of that of j, so
+ * each channel, less its mean, is transformed once, into a length at
+ * least 2 n - 1 which leaves the n - 1 negative lags at the end.
+ */
+
+struct udsp_xcor_matrix {
+    struct udsp_plan *plan;
+    size_t channels;
+    size_t n;
+    udsp_complex_t *spectra;
+    udsp_complex_t *work;
+};
+
+static void
+mul_spectrum_conj(const int fast, udsp_complex_t *restrict z,
+    const udsp_complex_t *restrict x, const udsp_complex_t *restrict y,
+    const size_t l)
+{
+    udsp_complex_t c;
+    float a, b, d, e;
+    size_t i;
+    if (fast
+            && arith_mul_safe((const float *) x, 2 * l)
+            && arith_mul_safe((const float *) y, 2 * l)) {
+        for (i = 0; i < l; i++) {
+            a = x[i].real;
+            b = x[i].imag;
+            d = y[i].real;
+            e = y[i].imag;
+            z[i].real = a * d + b * e;
+            z[i].imag = b * d - a * e;
+        }
+        return;
+    }
+    for (i = 0; i < l; i++) {
+        c.real = y[i].real;
+        c.imag = -y[i].imag;
+        mul_complex(&z[i], &x[i], &c);
+    }
+    return;
+}
+
+udsp_xcor_matrix_t *
+udsp_xcor_matrix_create(const int fft_method, const size_t channels,
+    const size_t n)
+{
+    struct udsp_xcor_matrix *xm;
+    struct udsp_plan *plan;
+    void *mem;
+    char *p;
+    size_t h, l, size;
+    assert(FFT_METHOD_VALID(fft_method));
+    assert(channels > 0);
+    assert(n > 0);
+    assert(n < PLAN_SIZE_MAX / 4);
+    l = udsp_fft_fast_size(2 * n - 1);
+    h = half_size(l);
+    if (channels > ((size_t) -1) / sizeof(udsp_complex_t) / h) {
+        return NULL;
+    }
+    plan = plan_create(fft_method, PLAN_REAL, l, 1);
+    if (plan == NULL) {
+        return NULL;
+    }
+    size = align_up(sizeof(struct udsp_xcor_matrix), PLAN_ALIGN);
+    size += align_up(channels * h * sizeof(udsp_complex_t), PLAN_ALIGN);
+    size += align_up(h * sizeof(udsp_complex_t), PLAN_ALIGN);
+    if (posix_memalign(&mem, PLAN_ALIGN, size) != 0) {
+        udsp_plan_destroy(plan);
+        return NULL;
+    }
+    p = mem;
+    xm = mem;
+    p += align_up(sizeof(struct udsp_xcor_matrix), PLAN_ALIGN);
+    xm->spectra = (udsp_complex_t *) p;
+    p += align_up(channels * h * sizeof(udsp_complex_t), PLAN_ALIGN);
+    xm->work = (udsp_complex_t *) p;
+    xm->plan = plan;
+    xm->channels = channels;
+    xm->n = n;
+    return xm;
+}
+
+void
+udsp_xcor_matrix_destroy(udsp_xcor_matrix_t *xm)
+{
+    if (xm != NULL) {
+        udsp_plan_destroy(xm->plan);
+    }
+    free(xm);
+    return;
+}
+
+size_t
+udsp_xcor_matrix_pairs(const udsp_xcor_matrix_t *xm, const int upper)
+{
+    assert(xm != NULL);
+    if (upper) {
+        return xm->channels * (xm->channels + 1) / 2;
+    }
+    return xm->channels * xm->channels;
+}
+
+/* the channels of pair k, in row-major order */
+static void
+xcor_matrix_pair(const struct udsp_xcor_matrix *restrict xm,
+    const int upper, const size_t k, size_t *restrict i, size_t *restrict j)
+{
+    size_t r;
+    if (!upper) {
+        *i = k / xm->channels;
+        *j = k % xm->channels;
+        return;
+    }
+    r = k;
+    for (*i = 0; r >= xm->channels - *i; (*i)++) {
+        r -= xm->channels - *i;
+    }
+    *j = *i + r;
+    return;
+}
+
+static void
+xcor_matrix_forward(struct udsp_xcor_matrix *restrict xm,
+    struct udsp_plan *restrict plan, udsp_complex_t *restrict work,
+    const float *restrict x, const size_t c)
+{
+    const int fast = (UDSP_ARITH_DEFAULT == UDSP_ARITH_FAST);
+    float *u;
+    float mean;
+    size_t i;
+    int plain;
+    u = (float *) work;
+    plain = demean_plain(fast, x, xm->n);
+    mean = mean_real(plain, x, xm->n);
+    for (i = 0; i < xm->n; i++) {
+        u[i] = plain ? x[i] - mean : flt_add(x[i], -mean);
+    }
+    zero_real(&u[xm->n], plan->size - xm->n);
+    exec_rfft(plan, u, &(xm->spectra[c * half_size(plan->size)]));
+    return;
+}
+
+static void
+xcor_matrix_inverse(struct udsp_xcor_matrix *restrict xm,
+    struct udsp_plan *restrict plan, udsp_complex_t *restrict work,
+    const size_t i, const size_t j, float *restrict result)
+{
+    const int fast = (UDSP_ARITH_DEFAULT == UDSP_ARITH_FAST);
+    const float *r;
+    size_t h, l, n;
+    l = plan->size;
+    h = half_size(l);
+    n = xm->n;
+    mul_spectrum_conj(fast, work,
+        &(xm->spectra[i * h]), &(xm->spectra[j * h]), h);
+    exec_irfft(plan, work, (float *) work);
+    r = (const float *) work;
+    copy_real(result, &r[l - (n - 1)], n - 1);
+    copy_real(&result[n - 1], r, n);
+    arith_normalize_real(fast, result, 2 * n - 1, n);
+    return;
+}
+
+void
+udsp_xcor_matrix(udsp_xcor_matrix_t *restrict xm,
+    const float *restrict x, const size_t xd, const int upper,
+    float *restrict result, const size_t rd)
+{
+    size_t c, i, j, k;
+    assert(xm != NULL);
+    assert(x != NULL);
+    assert(xd >= xm->n);
+    assert(result != NULL);
+    assert(rd >= 2 * xm->n - 1);
+    for (c = 0; c < xm->channels; c++) {
+        xcor_matrix_forward(xm, xm->plan, xm->work, &x[c * xd], c);
+    }
+    for (k = 0; k < udsp_xcor_matrix_pairs(xm, upper); k++) {
+        xcor_matrix_pair(xm, upper, k, &i, &j);
+        xcor_matrix_inverse(xm, xm->plan, xm->work, i, j, &result[k * rd]);
+    }
+    return;
+}
+
+/*
+ * Periodogram
+ */
+
+static void
+square_complex(udsp_complex_t *result, const udsp_complex_t *x)
+{
+    float a, b;
+    a = x->real;
+    b = x->imag;
+    result->real = flt_add(flt_mul(a, a), flt_mul(b, b));
+    result->imag = 0.f;
+    return;
+}
+
+static inline void
+fft_square(struct _udsp_fft_state *restrict st)
+{
+    udsp_complex_t *restrict x;
+    float a, b;
+    size_t i, l;
+    assert(st != NULL);
+    assert(st->size > 0);
+    assert(st->size < UDSP_FFT_SIZE_MAX);
+    l = half_size(st->size);
+    if (arith_fast(st) && arith_mul_safe((const float *) st->cbuf, 2 * l)) {
+        x = st->cbuf;
+        for (i = 0; i < l; i++) {
+            a = x[i].real;
+            b = x[i].imag;
+            x[i].real = a * a + b * b;
+            x[i].imag = 0.f;
+        }
+        return;
+    }
+    for (i = 0; i < l; i++) {
+        square_complex(&(st->cbuf[i]), &(st->cbuf[i]));
+    }
+    return;
+}
+
+void
+udsp_pow(udsp_state_t *st,
+    const float *restrict x, const size_t n,
+    float *restrict result)
+{
+    size_t i;
+    float pow_max;
+
+    assert(st != NULL);
+    assert(x != NULL);
+    assert(n > 0);
+    assert(n < UDSP_FFT_SIZE_MAX);
+
+    fft_init(st, UDSP_FFT_DEFAULT, n, x, n);
+    udsp_rfft(st, NULL, 0, NULL);
+    fft_square(&(st->fft_state));
+    pow_max = st->fft_state.cbuf[0].real;
+    arith_normalize_real(arith_fast(&(st->fft_state)),
+        (float *) st->fft_state.cbuf, 2 * half_size(n), pow_max);
+
+    if (result != NULL) {
+        for (i = 0; i < half_size(n); i++) {
+            result[i] = st->fft_state.cbuf[i].real;
+        }
+        for (; i < n; i++) {
+            result[i] = st->fft_state.cbuf[n - i].real;
+        }
+    }
+
+    return;
+}
+
+/*
+ * Double precision
+ *
+ * The double variants of the transforms, convolutions and periodogram
+ * use a state of double buffers.  FFTPACK is compiled in single
+ * precision only, so they are computed by the native FFT, with
+ * plain IEEE arithmetic, whatever the method of the state.
+ */
+
+static void
+fft_init_d(udsp_state_d_t *restrict st, const int fft_method,
+    const size_t l, const double *restrict x, const size_t n)
+{
+    struct _udsp_fft_state_d *fft_st;
+    assert(st != NULL);
+    assert(FFT_METHOD_VALID(fft_method));
+    assert(l > 0);
+    assert(l < UDSP_FFT_SIZE_MAX);
+    fft_st = &(st->fft_state);
+    zero_real_d(fft_st->rbuf, l);
+    zero_complex_d(fft_st->cbuf, l);
+    if (x != NULL) {
+        assert(n > 0);
+        assert(n < UDSP_FFT_SIZE_MAX);
+        copy_real_d(fft_st->rbuf, x, min(l, n));
+    }
+    if (fft_st->size == l && fft_st->method == fft_method) {
+        return;
+    }
+    assert(offsetof(struct twiddles, weights) % sizeof(double) == 0);
+    fft_st->weights = (const double *) twiddles_get(
+        UDSP_FFT_NATIVE | TWIDDLES_DOUBLE, l);
+    if (fft_st->weights == NULL) {
+        abort();
+    }
+    fft_st->size = l;
+    fft_st->method = fft_method;
+    return;
+}
+
+void
+udsp_fft_init_d(udsp_state_d_t *restrict st, const int fft_method,
+    const size_t n)
+{
+    assert(st != NULL);
+    assert(FFT_METHOD_VALID(fft_method));
+    assert(n > 0);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    fft_init_d(st, fft_method, n, NULL, 0);
+    return;
+}
+
+/*
+ * The work space of the transforms is the upper part of the complex
+ * buffer, as for a single precision state.
+ */
+static inline double *
+state_work_d(struct _udsp_fft_state_d *restrict st)
+{
+    return (double *) &(st->cbuf[half_size(st->size)]);
+}
+
+/*
+ * Compute the half spectrum of x, zero-padded or truncated to the
+ * length of the state, or of the real buffer if x is NULL, into
+ * result, or into the complex buffer if result is NULL.
+ */
+static void
+state_rfft_d(struct _udsp_fft_state_d *restrict st,
+    const double *restrict x, const size_t n,
+    udsp_complex_d_t *restrict result)
+{
+    const double *in;
+    assert(st != NULL);
+    assert(st->size > 0);
+    in = st->rbuf;
+    if (x != NULL) {
+        assert(n > 0);
+        in = x;
+        if (n != st->size) {
+            zero_real_d(st->rbuf, st->size);
+            copy_real_d(st->rbuf, x, min(n, st->size));
+            in = st->rbuf;
+        }
+    }
+    fftn_forward_d(st->size, st->weights, in,
+        (result != NULL) ? result : st->cbuf, state_work_d(st));
+    return;
+}
+
+/*
+ * The inverse of state_rfft_d:  only the first n / 2 + 1 coefficients
+ * of x are read, and a shorter x is first zero-padded.
+ */
+static void
+state_irfft_d(struct _udsp_fft_state_d *restrict st,
+    const udsp_complex_d_t *restrict x, const size_t n,
+    double *restrict result)
+{
+    const udsp_complex_d_t *in;
+    assert(st != NULL);
+    assert(st->size > 0);
+    in = st->cbuf;
+    if (x != NULL) {
+        assert(n > 0);
+        in = x;
+        if (n < half_size(st->size)) {
+            zero_complex_d(st->cbuf, half_size(st->size));
+            copy_complex_d(st->cbuf, x, n);
+            in = st->cbuf;
+        }
+    }
+    fftn_backward_d(st->size, st->weights, in,
+        (result != NULL) ? result : st->rbuf, state_work_d(st));
+    return;
+}
+
+void
+udsp_fft_d(udsp_state_d_t *restrict st,
+    const double *restrict x, const size_t n,
+    udsp_complex_d_t *restrict result)
+{
+    assert(st != NULL);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    state_rfft_d(&(st->fft_state), x, n, result);
+    mirror_complex_d((result != NULL) ? result : st->fft_state.cbuf,
+        st->fft_state.size);
+    return;
+}
+
+void
+udsp_ifft_d(udsp_state_d_t *restrict st,
+    const udsp_complex_d_t *restrict x, const size_t n,
+    double *restrict result)
+{
+    assert(st != NULL);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    state_irfft_d(&(st->fft_state), x, n, result);
+    return;
+}
+
+static void
+mul_spectrum_d(udsp_complex_d_t *restrict x,
+    const udsp_complex_d_t *restrict y, const size_t l)
+{
+    double a, b, c, d;
+    size_t i;
+    assert(x != NULL);
+    assert(y != NULL);
+    for (i = 0; i < l; i++) {
+        a = x[i].real;
+        b = x[i].imag;
+        c = y[i].real;
+        d = y[i].imag;
+        x[i].real = a * c - b * d;
+        x[i].imag = a * d + b * c;
+    }
+    return;
+}
+
+/*
+ * As conv_direct, in double precision.
+ */
+static void
+conv_direct_d(udsp_state_d_t st[2], const size_t m, const size_t n)
+{
+    const double *u, *v;
+    double *a, *b;
+    size_t i, p, q;
+    a = (double *) st[0].fft_state.cbuf;
+    b = (double *) st[1].fft_state.cbuf;
+    u = st[0].fft_state.rbuf;
+    v = st[1].fft_state.rbuf;
+    p = m;
+    q = n;
+    if (m < n) {
+        u = st[1].fft_state.rbuf;
+        v = st[0].fft_state.rbuf;
+        p = n;
+        q = m;
+    }
+    zero_real_d(a, q - 1);
+    copy_real_d(&a[q - 1], u, p);
+    zero_real_d(&a[p + q - 1], q - 1);
+    for (i = 0; i < q; i++) {
+        b[i] = v[q - 1 - i];
+    }
+    fftn_correlate_d(a, p + 2 * (q - 1), b, q, st[0].fft_state.rbuf);
+    return;
+}
+
+static void
+conv_d(udsp_state_d_t st[2],
+    const double *restrict x, const size_t m,
+    const double *restrict y, const size_t n,
+    double *restrict result,
+    const conv_step_d_t steps[][CONV_STEPS_MAX])
+{
+    size_t l, size;
+
+    assert(st != NULL);
+    assert(x != NULL);
+    assert(y != NULL);
+    assert(m > 0);
+    assert(m < UDSP_FFT_SIZE_MAX);
+    assert(n > 0);
+    assert(n < UDSP_FFT_SIZE_MAX);
+    assert(steps != NULL);
+
+    l = m + n - 1;
+    size = udsp_fft_fast_size(l);
+    if (size >= UDSP_FFT_SIZE_MAX) {
+        size = l;
+    }
+
+    if (conv_direct_cheaper(m, n, size, fftn_lanes_d(), CONV_DIRECT_MAC_D,
+            CONV_FFT_POINT_D)) {
+        copy_real_d(st[0].fft_state.rbuf, x, m);
+        copy_real_d(st[1].fft_state.rbuf, y, n);
+        exec_conv_steps_d(steps[CONV_PRE_FFT], st, x, m, y, n, result);
+        conv_direct_d(st, m, n);
+        exec_conv_steps_d(steps[CONV_POST_IFFT], st, x, m, y, n, result);
+        if (result != NULL) {
+            copy_real_d(result, st[0].fft_state.rbuf, l);
+        }
+        return;
+    }
+
+    fft_init_d(&st[0], UDSP_FFT_NATIVE, size, x, m);
+    fft_init_d(&st[1], UDSP_FFT_NATIVE, size, y, n);
+
+    exec_conv_steps_d(steps[CONV_PRE_FFT], st, x, m, y, n, result);
+    state_rfft_d(&(st[0].fft_state), NULL, 0, NULL);
+    state_rfft_d(&(st[1].fft_state), NULL, 0, NULL);
+    exec_conv_steps_d(steps[CONV_POST_FFT], st, x, m, y, n, result);
+
+    mul_spectrum_d(st[0].fft_state.cbuf, st[1].fft_state.cbuf,
+        half_size(size));
+
+    exec_conv_steps_d(steps[CONV_PRE_IFFT], st, x, m, y, n, result);
+    state_irfft_d(&(st[0].fft_state), NULL, 0, NULL);
+    exec_conv_steps_d(steps[CONV_POST_IFFT], st, x, m, y, n, result);
+
+    if (result != NULL) {
+        copy_real_d(result, st[0].fft_state.rbuf, l);
+    }
+
+    return;
+}
+
+CONV_ENTRY_PROTO(udsp_conv_d, udsp_state_d_t, double)
+{
+    assert(result != NULL);
+    conv_d(st, x, m, y, n, result,
+        (const conv_step_d_t [][CONV_STEPS_MAX]) {
+            [CONV_PRE_FFT] = {NULL},
+            [CONV_POST_FFT] = {NULL},
+            [CONV_PRE_IFFT] = {NULL},
+            [CONV_POST_IFFT] = {NULL},
+        }
+    );
+    return;
+}
+
+static
+CONV_FAMILY_PROTO(time_domain_normalize_d, udsp_state_d_t, double)
+{
+    double denom;
+    size_t i;
+    assert(st != NULL);
+    (void) x;
+    (void) y;
+    (void) result;
+    denom = (double) max(m, n);
+    for (i = 0; i < m + n - 1; i++) {
+        st[0].fft_state.rbuf[i] /= denom;
+    }
+    return;
+}
+
+static inline void
+demean_real_d(double *restrict x, const size_t n)
+{
+    double mean;
+    size_t i;
+    mean = 0.;
+    for (i = 0; i < n; i++) {
+        mean += x[i];
+    }
+    mean /= (double) n;
+    for (i = 0; i < n; i++) {
+        x[i] -= mean;
+    }
+    return;
+}
+
+static
+CONV_FAMILY_PROTO(time_domain_demean_d, udsp_state_d_t, double)
+{
+    assert(st != NULL);
+    (void) x;
+    (void) y;
+    (void) result;
+    demean_real_d(st[0].fft_state.rbuf, m);
+    demean_real_d(st[1].fft_state.rbuf, n);
+    return;
+}
+
+static const conv_step_d_t xcov_steps_d[][CONV_STEPS_MAX] = {
+    [CONV_PRE_FFT] = {
+        &time_domain_reverse_d,
+        NULL
+    },
+    [CONV_POST_FFT] = {NULL},
+    [CONV_PRE_IFFT] = {NULL},
+    [CONV_POST_IFFT] = {
+        &time_domain_normalize_d,
+        NULL
+    },
+};
+
+static const conv_step_d_t xcor_steps_d[][CONV_STEPS_MAX] = {
+    [CONV_PRE_FFT] = {
+        &time_domain_demean_d,
+        &time_domain_reverse_d,
+        NULL
+    },
+    [CONV_POST_FFT] = {NULL},
+    [CONV_PRE_IFFT] = {NULL},
+    [CONV_POST_IFFT] = {
+        &time_domain_normalize_d,
+        NULL
+    },
+};
+
+CONV_ENTRY_PROTO(udsp_xcov_d, udsp_state_d_t, double)
+{
+    assert(result != NULL);
+    conv_d(st, x, m, y, n, result, xcov_steps_d);
+    return;
+}
+
+CONV_ENTRY_PROTO(udsp_xcor_d, udsp_state_d_t, double)
+{
+    assert(result != NULL);
+    conv_d(st, x, m, y, n, result, xcor_steps_d);
+    return;
+}
+
+void
+udsp_pow_d(udsp_state_d_t *st,
+    const double *restrict x, const size_t n,
+    double *restrict result)
+{
+    udsp_complex_d_t *restrict c;
+    double a, b, pow_max;
+    size_t i;
+
+    assert(st != NULL);
+    assert(x != NULL);
+    assert(n > 0);
+    assert(n < UDSP_FFT_SIZE_MAX);
+
+    fft_init_d(st, UDSP_FFT_NATIVE, n, x, n);
+    state_rfft_d(&(st->fft_state), NULL, 0, NULL);
+    c = st->fft_state.cbuf;
+    for (i = 0; i < half_size(n); i++) {
+        a = c[i].real;
+        b = c[i].imag;
+        c[i].real = a * a + b * b;
+        c[i].imag = 0.;
+    }
+    pow_max = c[0].real;
+    for (i = 0; i < half_size(n); i++) {
+        c[i].real /= pow_max;
+    }
+
+    if (result != NULL) {
+        for (i = 0; i < half_size(n); i++) {
+            result[i] = c[i].real;
+        }
+        for (; i < n; i++) {
+            result[i] = c[n - i].real;
+        }
+    }
+
+    return;
+}
+
+/*
+ * Welch's method
+ *
+ * The signal is cut into segments of length l, one every l - overlap
+ * samples, which are windowed and transformed in batches by the
+ * estimator's plan.  The power of the segments of a batch is summed
+ * into a partial sum, and the partial sums into the result in order,
+ * so the estimate does not depend on where the batches are computed.
+ */
+
+struct udsp_welch {
+    struct udsp_plan *plan;
+    size_t step;
+    int sides;
+    double norm;
+    float *window;
+    float *segments;
+    udsp_complex_t *spectra;
+    float *partial;
+};
+
+/* the number of samples transformed in a batch */
+#define WELCH_BATCH_POINTS 16384
+
+/* the window is periodic, as for spectral analysis */
+static void
+window_init(float *restrict w, const size_t l, const int window)
+{
+    const double tpi = 6.28318530717958647692528676655900577;
+    double a;
+    size_t j;
+    for (j = 0; j < l; j++) {
+        a = tpi * (double) j / (double) l;
+        switch (window) {
+            case UDSP_WINDOW_HANN:
+                w[j] = (float) (0.5 - 0.5 * cos(a));
+                break;
+            case UDSP_WINDOW_HAMMING:
+                w[j] = (float) (0.54 - 0.46 * cos(a));
+                break;
+            case UDSP_WINDOW_BLACKMAN:
+                w[j] = (float) (0.42 - 0.5 * cos(a) + 0.08 * cos(2. * a));
+                break;
+            default:
+                w[j] = 1.f;
+        }
+    }
+    return;
+}
+
+static size_t
+welch_batch_size(const size_t l)
+{
+    return max(1, WELCH_BATCH_POINTS / l);
+}
+
+udsp_welch_t *
+udsp_welch_create(const int fft_method, const size_t l,
+    const size_t overlap, const int window, const int sides,
+    const int scaling)
+{
+    struct udsp_welch *welch;
+    struct udsp_plan *plan;
+    void *mem;
+    char *p;
+    size_t b, j, size;
+    double sum;
+    assert(FFT_METHOD_VALID(fft_method));
+    assert(l > 0);
+    assert(l < PLAN_SIZE_MAX);
+    assert(overlap < l);
+    assert(window >= UDSP_WINDOW_RECT && window <= UDSP_WINDOW_BLACKMAN);
+    assert(sides == UDSP_WELCH_ONESIDED || sides == UDSP_WELCH_TWOSIDED);
+    assert(scaling == UDSP_WELCH_DENSITY
+        || scaling == UDSP_WELCH_SPECTRUM);
+    b = welch_batch_size(l);
+    plan = plan_create(fft_method, PLAN_REAL, l, b);
+    if (plan == NULL) {
+        return NULL;
+    }
+    size = align_up(sizeof(struct udsp_welch), PLAN_ALIGN);
+    size += align_up(l * sizeof(float), PLAN_ALIGN);
+    size += align_up(b * l * sizeof(float), PLAN_ALIGN);
+    size += align_up(b * half_size(l) * sizeof(udsp_complex_t), PLAN_ALIGN);
+    size += align_up(half_size(l) * sizeof(float), PLAN_ALIGN);
+    if (posix_memalign(&mem, PLAN_ALIGN, size) != 0) {
+        udsp_plan_destroy(plan);
+        return NULL;
+    }
+    p = mem;
+    welch = mem;
+    p += align_up(sizeof(struct udsp_welch), PLAN_ALIGN);
+    welch->window = (float *) p;
+    p += align_up(l * sizeof(float), PLAN_ALIGN);
+    welch->segments = (float *) p;
+    p += align_up(b * l * sizeof(float), PLAN_ALIGN);
+    welch->spectra = (udsp_complex_t *) p;
+    p += align_up(b * half_size(l) * sizeof(udsp_complex_t), PLAN_ALIGN);
+    welch->partial = (float *) p;
+    welch->plan = plan;
+    welch->step = l - overlap;
+    welch->sides = sides;
+    window_init(welch->window, l, window);
+    sum = 0.;
+    for (j = 0; j < l; j++) {
+        if (scaling == UDSP_WELCH_DENSITY) {
+            sum += (double) welch->window[j] * welch->window[j];
+        } else {
+            sum += welch->window[j];
+        }
+    }
+    welch->norm = (scaling == UDSP_WELCH_DENSITY) ? sum : sum * sum;
+    return welch;
+}
 
-#define CONV_STEPS_MAX 4
+void
+udsp_welch_destroy(udsp_welch_t *welch)
+{
+    if (welch != NULL) {
+        udsp_plan_destroy(welch->plan);
+    }
+    free(welch);
+    return;
+}
+
+size_t
+udsp_welch_length(const udsp_welch_t *welch)
+{
+    assert(welch != NULL);
+    if (welch->sides == UDSP_WELCH_ONESIDED) {
+        return half_size(welch->plan->size);
+    }
+    return welch->plan->size;
+}
+
+/*
+ * A signal shorter than a segment is zero-padded to one segment;  the
+ * samples after the last full segment are ignored.
+ */
+static size_t
+welch_segments(const struct udsp_welch *welch, const size_t n)
+{
+    if (n <= welch->plan->size) {
+        return 1;
+    }
+    return (n - welch->plan->size) / welch->step + 1;
+}
+
+static size_t
+welch_batches(const struct udsp_welch *welch, const size_t n)
+{
+    return (welch_segments(welch, n) + welch->plan->batch - 1)
+        / welch->plan->batch;
+}
+
+static void
+add_power(const int fast, float *restrict y,
+    const udsp_complex_t *restrict x, const size_t n)
+{
+    size_t i;
+    float a, b;
+    if (fast && arith_mul_safe((const float *) x, 2 * n)) {
+        for (i = 0; i < n; i++) {
+            a = x[i].real;
+            b = x[i].imag;
+            y[i] += a * a + b * b;
+        }
+        return;
+    }
+    for (i = 0; i < n; i++) {
+        a = x[i].real;
+        b = x[i].imag;
+        y[i] = flt_add(y[i], flt_add(flt_mul(a, a), flt_mul(b, b)));
+    }
+    return;
+}
+
+/*
+ * Sum the power of the segments of batch i of x into partial, with the
+ * given plan and buffers.
+ */
+static void
+welch_batch(const struct udsp_welch *restrict welch,
+    struct udsp_plan *restrict plan,
+    const float *restrict x, const size_t n, const size_t i,
+    float *restrict segments, udsp_complex_t *restrict spectra,
+    float *restrict partial)
+{
+    const int fast = (UDSP_ARITH_DEFAULT == UDSP_ARITH_FAST);
+    size_t b, j, l, h, m, nb, start;
+    l = plan->size;
+    h = half_size(l);
+    nb = min(plan->batch, welch_segments(welch, n) - i * plan->batch);
+    for (b = 0; b < nb; b++) {
+        start = (i * plan->batch + b) * welch->step;
+        m = min(l, n - start);
+        for (j = 0; j < m; j++) {
+            segments[b * l + j] = x[start + j] * welch->window[j];
+        }
+        zero_real(&segments[b * l + m], l - m);
+    }
+    exec_rfft_batch(plan, nb, segments, 1, l, spectra, 1, h);
+    zero_real(partial, h);
+    for (b = 0; b < nb; b++) {
+        add_power(fast, partial, &spectra[b * h], h);
+    }
+    return;
+}
+
+/*
+ * Scale the sum of the power of the segments in result, and fold or
+ * mirror the spectrum.  The Nyquist coefficient of an even length has
+ * no mirror image, and is not doubled for the one-sided estimate.
+ */
+static void
+welch_finish(const struct udsp_welch *restrict welch, const size_t n,
+    float *restrict result)
+{
+    size_t k, l, h, m;
+    float scale;
+    l = welch->plan->size;
+    h = half_size(l);
+    scale = (float) (1. / (welch->norm * (double) welch_segments(welch, n)));
+    for (k = 0; k < h; k++) {
+        result[k] *= scale;
+    }
+    if (welch->sides == UDSP_WELCH_ONESIDED) {
+        m = (l % 2 == 0) ? h - 1 : h;
+        for (k = 1; k < m; k++) {
+            result[k] *= 2.f;
+        }
+    } else {
+        for (k = h; k < l; k++) {
+            result[k] = result[l - k];
+        }
+    }
+    return;
+}
+
+void
+udsp_welch(udsp_welch_t *restrict welch,
+    const float *restrict x, const size_t n, float *restrict result)
+{
+    const int fast = (UDSP_ARITH_DEFAULT == UDSP_ARITH_FAST);
+    size_t i, h;
+    assert(welch != NULL);
+    assert(x != NULL);
+    assert(n > 0);
+    assert(result != NULL);
+    h = half_size(welch->plan->size);
+    zero_real(result, h);
+    for (i = 0; i < welch_batches(welch, n); i++) {
+        welch_batch(welch, welch->plan, x, n, i,
+            welch->segments, welch->spectra, welch->partial);
+        add_real(fast, result, welch->partial, h);
+    }
+    welch_finish(welch, n, result);
+    return;
+}
+
+/*
+ * Streaming convolution
+ *
+ * The convolver filters a stream by overlap-save:  each block of l new
+ * samples, preceded by at least the last n - 1 samples of the stream,
+ * as many as make a fast transform length, is transformed, multiplied
+ * by the transform of the kernel, and transformed back, and the last l
+ * samples of the result are the convolution for that block.  Each
+ * output sample is returned one block after its input sample.
+ *
+ * A kernel longer than the block is split into uniform partitions of
+ * the block length, each transformed once.  The transforms of the last
+ * frames of the stream are kept in a delay line, and the output of a
+ * block is the inverse transform of the sum of the products of the
+ * frame p blocks old with partition p, so the cost of a block grows
+ * with the number of partitions but not with the length of its
+ * transforms, which is about twice the block.
+ *
+ * The sum is bounded by twice the largest magnitude of the frames
+ * times the sum of the largest of each partition;  while that is
+ * finite, plain arithmetic gives the same result as saturating.
+ */
+
+struct udsp_convolver {
+    struct udsp_plan plan;
+    size_t n;
+    size_t block;
+    size_t pos;
+    size_t parts;
+    size_t ring;
+    double gain;
+    float *peaks;
+    udsp_complex_t *kernel;
+    udsp_complex_t *delay;
+    udsp_complex_t *spectrum;
+    float *input;
+};
+
+/* the default transform length, in multiples of the kernel length */
+#define CONVOLVER_SIZE_FACTOR 4
+
+static size_t
+convolver_fft_size(const size_t n, const size_t block)
+{
+    if (block > 0 && n > block) {
+        return udsp_fft_fast_size(2 * block);
+    }
+    if (block > 0) {
+        return udsp_fft_fast_size(block + n - 1);
+    }
+    return udsp_fft_fast_size(CONVOLVER_SIZE_FACTOR * n);
+}
+
+udsp_convolver_t *
+udsp_convolver_create(const int fft_method,
+    const float *restrict h, const size_t n, const size_t block)
+{
+    struct udsp_convolver *cv;
+    const float *weights;
+    void *mem;
+    char *p;
+    size_t j, k, l, parts, size;
+    assert(FFT_METHOD_VALID(fft_method));
+    assert(h != NULL);
+    assert(n > 0);
+    assert(n < PLAN_SIZE_MAX / CONVOLVER_SIZE_FACTOR);
+    assert(block < PLAN_SIZE_MAX / 2 - n);
+    l = convolver_fft_size(n, block);
+    k = (block > 0 && n > block) ? block : n;
+    parts = (n + k - 1) / k;
+    weights = twiddles_get(fft_method, l);
+    if (weights == NULL) {
+        return NULL;
+    }
+    size = align_up(sizeof(struct udsp_convolver), PLAN_ALIGN);
+    size += 2 * align_up(parts * half_size(l) * sizeof(udsp_complex_t),
+        PLAN_ALIGN);
+    size += align_up(half_size(l) * sizeof(udsp_complex_t), PLAN_ALIGN);
+    size += align_up(l * sizeof(float), PLAN_ALIGN);
+    size += align_up(parts * sizeof(float), PLAN_ALIGN);
+    size += align_up(work_size(fft_method, l) * sizeof(float), PLAN_ALIGN);
+    if (posix_memalign(&mem, PLAN_ALIGN, size) != 0) {
+        return NULL;
+    }
+    p = mem;
+    cv = mem;
+    p += align_up(sizeof(struct udsp_convolver), PLAN_ALIGN);
+    cv->kernel = (udsp_complex_t *) p;
+    p += align_up(parts * half_size(l) * sizeof(udsp_complex_t),
+        PLAN_ALIGN);
+    cv->delay = (udsp_complex_t *) p;
+    p += align_up(parts * half_size(l) * sizeof(udsp_complex_t),
+        PLAN_ALIGN);
+    cv->spectrum = (udsp_complex_t *) p;
+    p += align_up(half_size(l) * sizeof(udsp_complex_t), PLAN_ALIGN);
+    cv->input = (float *) p;
+    p += align_up(l * sizeof(float), PLAN_ALIGN);
+    cv->peaks = (float *) p;
+    p += align_up(parts * sizeof(float), PLAN_ALIGN);
+    cv->plan.size = l;
+    cv->plan.batch = 1;
+    cv->plan.method = fft_method;
+    cv->plan.kind = PLAN_REAL;
+    cv->plan.weights = weights;
+    cv->plan.rbuf = NULL;
+    cv->plan.cbuf = NULL;
+    cv->plan.work = (float *) p;
+    cv->n = n;
+    cv->block = (block > 0) ? block : l - (n - 1);
+    cv->parts = parts;
+    cv->gain = 0.;
+    for (j = 0; j < parts; j++) {
+        zero_real(cv->input, l);
+        copy_real(cv->input, &h[j * k], min(k, n - j * k));
+        exec_rfft(&(cv->plan), cv->input,
+            &(cv->kernel[j * half_size(l)]));
+        cv->gain += flt_absmax((const float *) &(cv->kernel[j
+            * half_size(l)]), 2 * half_size(l));
+    }
+    udsp_convolver_reset(cv);
+    return cv;
+}
+
+void
+udsp_convolver_destroy(udsp_convolver_t *cv)
+{
+    free(cv);
+    return;
+}
+
+size_t
+udsp_convolver_latency(const udsp_convolver_t *cv)
+{
+    assert(cv != NULL);
+    return cv->block;
+}
+
+void
+udsp_convolver_reset(udsp_convolver_t *cv)
+{
+    assert(cv != NULL);
+    zero_real(cv->input, cv->plan.size);
+    zero_complex(cv->delay, cv->parts * half_size(cv->plan.size));
+    zero_real(cv->peaks, cv->parts);
+    zero_complex(cv->spectrum, half_size(cv->plan.size));
+    cv->pos = 0;
+    cv->ring = 0;
+    return;
+}
+
+static void
+mac_spectrum(const int plain, udsp_complex_t *restrict z,
+    const udsp_complex_t *restrict x, const udsp_complex_t *restrict y,
+    const size_t l)
+{
+    udsp_complex_t c;
+    float a, b, d, e;
+    size_t i;
+    if (plain) {
+        for (i = 0; i < l; i++) {
+            a = x[i].real;
+            b = x[i].imag;
+            d = y[i].real;
+            e = y[i].imag;
+            z[i].real += a * d - b * e;
+            z[i].imag += a * e + b * d;
+        }
+        return;
+    }
+    for (i = 0; i < l; i++) {
+        mul_complex(&c, &x[i], &y[i]);
+        z[i].real = flt_add(z[i].real, c.real);
+        z[i].imag = flt_add(z[i].imag, c.imag);
+    }
+    return;
+}
+
+/*
+ * Filter the full block of input, leaving the output in the spectrum
+ * array, from the float at l - block, and keep the last l - block
+ * samples.
+ */
+static void
+convolver_block(struct udsp_convolver *restrict cv)
+{
+    const int fast = (UDSP_ARITH_DEFAULT == UDSP_ARITH_FAST);
+    udsp_complex_t *frame;
+    size_t h, i, j, l;
+    int plain;
+    assert(cv != NULL);
+    l = cv->plan.size;
+    h = half_size(l);
+    frame = &(cv->delay[cv->ring * h]);
+    exec_rfft(&(cv->plan), cv->input, frame);
+    cv->peaks[cv->ring] = flt_absmax((const float *) frame, 2 * h);
+    plain = fast || 2. * (double) flt_absmax(cv->peaks, cv->parts)
+        * cv->gain < (double) FLT_MAX;
+    zero_complex(cv->spectrum, h);
+    for (j = 0; j < cv->parts; j++) {
+        frame = &(cv->delay[((cv->ring + cv->parts - j) % cv->parts) * h]);
+        mac_spectrum(plain, cv->spectrum, frame, &(cv->kernel[j * h]), h);
+    }
+    exec_irfft(&(cv->plan), cv->spectrum, (float *) cv->spectrum);
+    cv->ring = (cv->ring + 1) % cv->parts;
+    for (i = 0; i < l - cv->block; i++) {
+        cv->input[i] = cv->input[cv->block + i];
+    }
+    return;
+}
+
+void
+udsp_convolver_process(udsp_convolver_t *restrict cv,
+    const float *restrict x, const size_t m, float *restrict result)
+{
+    const float *out;
+    size_t i, k, l;
+    assert(cv != NULL);
+    assert(x != NULL);
+    assert(result != NULL);
+    l = cv->plan.size;
+    out = &((const float *) cv->spectrum)[l - cv->block];
+    i = 0;
+    while (i < m) {
+        k = min(cv->block - cv->pos, m - i);
+        copy_real(&(cv->input[l - cv->block + cv->pos]), &x[i], k);
+        copy_real(&result[i], &out[cv->pos], k);
+        cv->pos += k;
+        i += k;
+        if (cv->pos == cv->block) {
+            convolver_block(cv);
+            cv->pos = 0;
+        }
+    }
+    return;
+}
+
+/*
+ * Short-time Fourier transform
+ *
+ * The analysis stream keeps the last l samples in a ring buffer, and
+ * transforms them, times the window, every hop samples from the l-th
+ * on.  The synthesis stream adds each inverse transform, times the
+ * window, to the last l - hop samples of the sum of the previous ones,
+ * and emits the first hop samples divided by the sum of the squares of
+ * the windows that overlap them.
+ */
+
+struct udsp_stft {
+    struct udsp_plan plan;
+    size_t hop;
+    size_t pos;
+    size_t need;
+    int inverse;
+    float *window;
+    float *norm;
+    float *buffer;
+    float *input;
+    udsp_complex_t *spectrum;
+};
+
+static struct udsp_stft *
+stft_create(const int fft_method, const size_t l, const size_t hop,
+    const int window, const int inverse)
+{
+    struct udsp_stft *stft;
+    const float *weights;
+    void *mem;
+    char *p;
+    size_t size;
+    assert(FFT_METHOD_VALID(fft_method));
+    assert(l > 0);
+    assert(l < PLAN_SIZE_MAX);
+    assert(hop > 0);
+    assert(window >= UDSP_WINDOW_RECT && window <= UDSP_WINDOW_BLACKMAN);
+    weights = twiddles_get(fft_method, l);
+    if (weights == NULL) {
+        return NULL;
+    }
+    size = align_up(sizeof(struct udsp_stft), PLAN_ALIGN);
+    size += 3 * align_up(l * sizeof(float), PLAN_ALIGN);
+    size += align_up(hop * sizeof(float), PLAN_ALIGN);
+    size += align_up(half_size(l) * sizeof(udsp_complex_t), PLAN_ALIGN);
+    size += align_up(work_size(fft_method, l) * sizeof(float), PLAN_ALIGN);
+    if (posix_memalign(&mem, PLAN_ALIGN, size) != 0) {
+        return NULL;
+    }
+    p = mem;
+    stft = mem;
+    p += align_up(sizeof(struct udsp_stft), PLAN_ALIGN);
+    stft->window = (float *) p;
+    p += align_up(l * sizeof(float), PLAN_ALIGN);
+    stft->buffer = (float *) p;
+    p += align_up(l * sizeof(float), PLAN_ALIGN);
+    stft->input = (float *) p;
+    p += align_up(l * sizeof(float), PLAN_ALIGN);
+    stft->norm = (float *) p;
+    p += align_up(hop * sizeof(float), PLAN_ALIGN);
+    stft->spectrum = (udsp_complex_t *) p;
+    p += align_up(half_size(l) * sizeof(udsp_complex_t), PLAN_ALIGN);
+    stft->plan.size = l;
+    stft->plan.batch = 1;
+    stft->plan.method = fft_method;
+    stft->plan.kind = PLAN_REAL;
+    stft->plan.weights = weights;
+    stft->plan.rbuf = NULL;
+    stft->plan.cbuf = NULL;
+    stft->plan.work = (float *) p;
+    stft->hop = hop;
+    stft->inverse = inverse;
+    window_init(stft->window, l, window);
+    udsp_stft_reset(stft);
+    return stft;
+}
+
+udsp_stft_t *
+udsp_stft_create(const int fft_method, const size_t l, const size_t hop,
+    const int window)
+{
+    return stft_create(fft_method, l, hop, window, 0);
+}
+
+/*
+ * The inverse needs every sample to be covered by a window:  hop must
+ * not exceed l, and no sum of the squares of the window at the offsets
+ * j, j + hop, j + 2 hop, ... may be zero.
+ */
+udsp_stft_t *
+udsp_istft_create(const int fft_method, const size_t l, const size_t hop,
+    const int window)
+{
+    struct udsp_stft *stft;
+    size_t i, j;
+    double sum;
+    assert(hop <= l);
+    stft = stft_create(fft_method, l, hop, window, 1);
+    if (stft == NULL) {
+        return NULL;
+    }
+    for (j = 0; j < hop; j++) {
+        sum = 0.;
+        for (i = j; i < l; i += hop) {
+            sum += (double) stft->window[i] * stft->window[i];
+        }
+        if (sum < FLT_EPSILON) {
+            udsp_stft_destroy(stft);
+            return NULL;
+        }
+        stft->norm[j] = (float) (1. / sum);
+    }
+    return stft;
+}
+
+void
+udsp_stft_destroy(udsp_stft_t *stft)
+{
+    free(stft);
+    return;
+}
+
+void
+udsp_stft_reset(udsp_stft_t *stft)
+{
+    assert(stft != NULL);
+    zero_real(stft->buffer, stft->plan.size);
+    stft->pos = 0;
+    stft->need = stft->plan.size;
+    return;
+}
+
+size_t
+udsp_stft_frames(const udsp_stft_t *stft, const size_t m)
+{
+    assert(stft != NULL);
+    assert(!stft->inverse);
+    if (m < stft->need) {
+        return 0;
+    }
+    return (m - stft->need) / stft->hop + 1;
+}
+
+/*
+ * Append the m samples x to the ring buffer, of which only the last l
+ * are kept.
+ */
+static void
+stft_write(struct udsp_stft *restrict stft, const float *restrict x,
+    const size_t m)
+{
+    size_t i, k, l;
+    l = stft->plan.size;
+    i = (m > l) ? m - l : 0;
+    while (i < m) {
+        k = min(l - stft->pos, m - i);
+        copy_real(&(stft->buffer[stft->pos]), &x[i], k);
+        stft->pos = (stft->pos + k) % l;
+        i += k;
+    }
+    return;
+}
+
+/*
+ * Transform the last l samples, windowed as they are copied out of the
+ * ring, into frame f of the given kind.
+ */
+static void
+stft_frame(struct udsp_stft *restrict stft, const int output,
+    void *restrict frames, const size_t f)
+{
+    const int fast = (UDSP_ARITH_DEFAULT == UDSP_ARITH_FAST);
+    udsp_complex_t *y;
+    float *out;
+    size_t i, k, l, h;
+    l = stft->plan.size;
+    h = half_size(l);
+    k = l - stft->pos;
+    for (i = 0; i < k; i++) {
+        stft->input[i] = stft->buffer[stft->pos + i] * stft->window[i];
+    }
+    for (; i < l; i++) {
+        stft->input[i] = stft->buffer[i - k] * stft->window[i];
+    }
+    if (output == UDSP_STFT_COMPLEX) {
+        exec_rfft(&(stft->plan), stft->input,
+            &((udsp_complex_t *) frames)[f * h]);
+        return;
+    }
+    y = stft->spectrum;
+    exec_rfft(&(stft->plan), stft->input, y);
+    out = &((float *) frames)[f * h];
+    zero_real(out, h);
+    add_power(fast, out, y, h);
+    if (output == UDSP_STFT_MAGNITUDE) {
+        for (i = 0; i < h; i++) {
+            out[i] = sqrtf(out[i]);
+        }
+    }
+    return;
+}
+
+size_t
+udsp_stft_process(udsp_stft_t *restrict stft,
+    const float *restrict x, const size_t m, const int output,
+    void *restrict frames)
+{
+    size_t i, k, f;
+    assert(stft != NULL);
+    assert(!stft->inverse);
+    assert(x != NULL);
+    assert(output == UDSP_STFT_COMPLEX || output == UDSP_STFT_MAGNITUDE
+        || output == UDSP_STFT_POWER);
+    f = 0;
+    i = 0;
+    while (i < m) {
+        k = min(stft->need, m - i);
+        stft_write(stft, &x[i], k);
+        stft->need -= k;
+        i += k;
+        if (stft->need == 0) {
+            assert(frames != NULL);
+            stft_frame(stft, output, frames, f);
+            stft->need = stft->hop;
+            f++;
+        }
+    }
+    return f;
+}
+
+void
+udsp_istft_process(udsp_stft_t *restrict stft,
+    const udsp_complex_t *restrict frames, const size_t count,
+    float *restrict result)
+{
+    const float *w;
+    float *sum;
+    size_t f, i, l, h, hop;
+    assert(stft != NULL);
+    assert(stft->inverse);
+    assert(frames != NULL);
+    assert(result != NULL);
+    l = stft->plan.size;
+    h = half_size(l);
+    hop = stft->hop;
+    w = stft->window;
+    sum = stft->buffer;
+    for (f = 0; f < count; f++) {
+        exec_irfft(&(stft->plan), &frames[f * h], stft->input);
+        for (i = 0; i < l; i++) {
+            sum[i] += stft->input[i] * w[i];
+        }
+        for (i = 0; i < hop; i++) {
+            result[f * hop + i] = sum[i] * stft->norm[i];
+        }
+        for (i = 0; i < l - hop; i++) {
+            sum[i] = sum[hop + i];
+        }
+        zero_real(&sum[l - hop], hop);
+    }
+    return;
+}
+
+/*
+ * Goertzel algorithm
+ *
+ * The bins are computed in blocks, each sample updating the recurrence
+ * of every bin of the block in turn, so that the loop over the bins is
+ * vectorized.  The recurrences are computed in double precision, since
+ * their error grows with n for the bins near 0 and n / 2.
+ */
+
+#define GOERTZEL_BLOCK 16
+
+static void
+goertzel_block(const float *restrict x, const size_t n,
+    const float *restrict bins, const size_t count,
+    udsp_complex_t *restrict result)
+{
+    const double tpi = 6.28318530717958647692528676655900577;
+    double c[GOERTZEL_BLOCK], s1[GOERTZEL_BLOCK], s2[GOERTZEL_BLOCK];
+    double a, re, im, s0;
+    size_t b, j;
+    assert(count <= GOERTZEL_BLOCK);
+    for (b = 0; b < count; b++) {
+        c[b] = 2. * cos(tpi * bins[b] / (double) n);
+        s1[b] = 0.;
+        s2[b] = 0.;
+    }
+    for (j = 0; j < n; j++) {
+        for (b = 0; b < count; b++) {
+            s0 = x[j] + c[b] * s1[b] - s2[b];
+            s2[b] = s1[b];
+            s1[b] = s0;
+        }
+    }
+    /* X = exp(-i w (n - 1)) (s1 - exp(-i w) s2) */
+    for (b = 0; b < count; b++) {
+        a = tpi * bins[b] / (double) n;
+        re = s1[b] - cos(a) * s2[b];
+        im = sin(a) * s2[b];
+        a *= (double) (n - 1);
+        result[b].real = (float) (re * cos(a) + im * sin(a));
+        result[b].imag = (float) (im * cos(a) - re * sin(a));
+    }
+    return;
+}
+
+/*
+ * Compute the DFT of the n samples x at the given count bins, in units
+ * of the n-point DFT, which need not be integers.
+ */
+void
+udsp_goertzel(const float *restrict x, const size_t n,
+    const float *restrict bins, const size_t count,
+    udsp_complex_t *restrict result)
+{
+    size_t b;
+    assert(x != NULL);
+    assert(n > 0);
+    assert(bins != NULL);
+    assert(result != NULL);
+    for (b = 0; b < count; b += GOERTZEL_BLOCK) {
+        goertzel_block(x, n, &bins[b], min(GOERTZEL_BLOCK, count - b),
+            &result[b]);
+    }
+    return;
+}
+
+/*
+ * Sliding discrete Fourier transform
+ *
+ * The tracker holds the DFT of the last n samples at each of its bins,
+ * and updates it for every new sample x by
+ *
+ *     S <- exp(2 pi i k / n) (S + x - x')
+ *
+ * where x' is the sample that leaves the window, kept in a ring
+ * buffer.  The recurrence is not damped, so it is computed in double
+ * precision, with the bins in separate arrays of real and imaginary
+ * parts for the loop over them to be vectorized.
+ */
+
+struct udsp_sdft {
+    size_t n;
+    size_t count;
+    size_t pos;
+    float *ring;
+    double *cr;
+    double *ci;
+    double *re;
+    double *im;
+};
+
+udsp_sdft_t *
+udsp_sdft_create(const size_t n, const size_t *restrict bins,
+    const size_t count)
+{
+    const double tpi = 6.28318530717958647692528676655900577;
+    struct udsp_sdft *sd;
+    void *mem;
+    char *p;
+    size_t b, size;
+    double a;
+    assert(n > 0);
+    assert(n < PLAN_SIZE_MAX);
+    assert(bins != NULL);
+    assert(count > 0);
+    assert(count < PLAN_SIZE_MAX);
+    size = align_up(sizeof(struct udsp_sdft), PLAN_ALIGN);
+    size += align_up(n * sizeof(float), PLAN_ALIGN);
+    size += 4 * align_up(count * sizeof(double), PLAN_ALIGN);
+    if (posix_memalign(&mem, PLAN_ALIGN, size) != 0) {
+        return NULL;
+    }
+    p = mem;
+    sd = mem;
+    p += align_up(sizeof(struct udsp_sdft), PLAN_ALIGN);
+    sd->ring = (float *) p;
+    p += align_up(n * sizeof(float), PLAN_ALIGN);
+    sd->cr = (double *) p;
+    p += align_up(count * sizeof(double), PLAN_ALIGN);
+    sd->ci = (double *) p;
+    p += align_up(count * sizeof(double), PLAN_ALIGN);
+    sd->re = (double *) p;
+    p += align_up(count * sizeof(double), PLAN_ALIGN);
+    sd->im = (double *) p;
+    sd->n = n;
+    sd->count = count;
+    for (b = 0; b < count; b++) {
+        assert(bins[b] < n);
+        a = tpi * (double) bins[b] / (double) n;
+        sd->cr[b] = cos(a);
+        sd->ci[b] = sin(a);
+    }
+    udsp_sdft_reset(sd);
+    return sd;
+}
+
+void
+udsp_sdft_destroy(udsp_sdft_t *sd)
+{
+    free(sd);
+    return;
+}
 
-static inline void
-exec_conv_steps(const conv_step_t steps[], udsp_state_t st[2],
-    const float *restrict x, const size_t m,
-    const float *restrict y, const size_t n,
-    float *restrict result)
+void
+udsp_sdft_reset(udsp_sdft_t *sd)
 {
-    size_t i;
-    assert(steps != NULL);
-    for (i = 0; i < CONV_STEPS_MAX; i++) {
-        if (steps[i] == NULL) {
-            break;
-        }
-        (*steps[i])(st, x, m, y, n, result);
+    size_t b;
+    assert(sd != NULL);
+    zero_real(sd->ring, sd->n);
+    for (b = 0; b < sd->count; b++) {
+        sd->re[b] = 0.;
+        sd->im[b] = 0.;
     }
+    sd->pos = 0;
     return;
 }
 
-#define CONV_PRE_FFT     0
-#define CONV_POST_FFT    1
-#define CONV_PRE_IFFT    2
-#define CONV_POST_IFFT   3
-
-static inline void
-fft_mul(struct _udsp_fft_state *restrict st1,
-    struct _udsp_fft_state *restrict st2)
+void
+udsp_sdft_get(const udsp_sdft_t *restrict sd,
+    udsp_complex_t *restrict result)
 {
-    size_t i;
-    assert(st1 != NULL);
-    assert(st2 != NULL);
-    assert(st1->size > 0);
-    assert(st1->size < UDSP_FFT_SIZE_MAX);
-    assert(st1->size >= st2->size);
-    for (i = 0; i < st1->size; i++) {
-        mul_complex(&(st1->cbuf[i]),
-            &(st1->cbuf[i]), &(st2->cbuf[i]));
+    size_t b;
+    assert(sd != NULL);
+    assert(result != NULL);
+    for (b = 0; b < sd->count; b++) {
+        result[b].real = (float) sd->re[b];
+        result[b].imag = (float) sd->im[b];
     }
     return;
 }
 
-static void
-conv(udsp_state_t st[2],
+void
+udsp_sdft_process(udsp_sdft_t *restrict sd,
     const float *restrict x, const size_t m,
-    const float *restrict y, const size_t n,
-    float *restrict result,
-    const conv_step_t steps[][CONV_STEPS_MAX])
+    udsp_complex_t *restrict result)
 {
-    size_t l;
-
-    assert(st != NULL);
+    double *restrict re, *restrict im;
+    const double *restrict cr, *restrict ci;
+    double a, d;
+    size_t b, i, count;
+    assert(sd != NULL);
     assert(x != NULL);
-    assert(y != NULL);
-    assert(m > 0);
-    assert(m < UDSP_FFT_SIZE_MAX);
-    assert(n > 0);
-    assert(n < UDSP_FFT_SIZE_MAX);
-    assert(steps != NULL);
+    re = sd->re;
+    im = sd->im;
+    cr = sd->cr;
+    ci = sd->ci;
+    count = sd->count;
+    for (i = 0; i < m; i++) {
+        d = (double) x[i] - sd->ring[sd->pos];
+        sd->ring[sd->pos] = x[i];
+        sd->pos = (sd->pos + 1 == sd->n) ? 0 : sd->pos + 1;
+        for (b = 0; b < count; b++) {
+            a = re[b] + d;
+            re[b] = a * cr[b] - im[b] * ci[b];
+            im[b] = a * ci[b] + im[b] * cr[b];
+        }
+        if (result != NULL) {
+            udsp_sdft_get(sd, &result[i * count]);
+        }
+    }
+    return;
+}
 
-    l = m + n - 1;
+/*
+ * Batches on a thread pool
+ *
+ * The items of a pooled transform are the chunks of batch transforms
+ * of the plan;  the items of a pooled convolution are its pairs of
+ * signals.  Every worker has its own plan or pair of states, allocated
+ * by the calling thread before the job starts.  If they cannot be
+ * allocated, the job is run on the calling thread alone.
+ */
 
-    fft_init(&st[0], UDSP_FFT_DEFAULT, l, x, m);
-    fft_init(&st[1], UDSP_FFT_DEFAULT, l, y, n);
+#define POOL_SLOT_PLAN  0
+#define POOL_SLOT_STATE 1
 
-    exec_conv_steps(steps[CONV_PRE_FFT], st, x, m, y, n, result);
-    udsp_fft(&st[0], NULL, 0, NULL);
-    udsp_fft(&st[1], NULL, 0, NULL);
-    exec_conv_steps(steps[CONV_POST_FFT], st, x, m, y, n, result);
+struct pool_fft_job {
+    udsp_pool_t *pool;
+    struct udsp_plan *plan;
+    int inverse;
+    size_t howmany;
+    const void *in;
+    size_t is, id;
+    void *out;
+    size_t os, od;
+};
 
-    fft_mul(&(st[0].fft_state), &(st[1].fft_state));
+struct pool_conv_job {
+    udsp_pool_t *pool;
+    conv_step_t op;
+    const float *x;
+    size_t m, xd;
+    const float *y;
+    size_t n, yd;
+    float *result;
+    size_t rd;
+};
 
-    exec_conv_steps(steps[CONV_PRE_IFFT], st, x, m, y, n, result);
-    udsp_ifft(&st[0], NULL, 0, NULL);
-    exec_conv_steps(steps[CONV_POST_IFFT], st, x, m, y, n, result);
+static int
+pool_plans(udsp_pool_t *pool, const struct udsp_plan *plan)
+{
+    struct udsp_plan *p;
+    void **slot;
+    size_t w;
+    for (w = 1; w < udsp_pool_threads(pool); w++) {
+        slot = pool_scratch(pool, w, POOL_SLOT_PLAN);
+        p = *slot;
+        if (p != NULL && p->method == plan->method
+                && p->size == plan->size && p->batch == plan->batch) {
+            continue;
+        }
+        udsp_plan_destroy(p);
+        *slot = udsp_plan_create_batch(plan->method, plan->size,
+            plan->batch);
+        if (*slot == NULL) {
+            return 0;
+        }
+    }
+    return 1;
+}
 
-    if (result != NULL) {
-        copy_real(result, st[0].fft_state.rbuf, l);
+static void
+pool_fft_item(void *arg, const size_t i, const size_t w)
+{
+    struct pool_fft_job *job = arg;
+    struct udsp_plan *plan;
+    size_t b, nb;
+    plan = job->plan;
+    if (w > 0) {
+        plan = *pool_scratch(job->pool, w, POOL_SLOT_PLAN);
+    }
+    b = i * plan->batch;
+    nb = min(plan->batch, job->howmany - b);
+    if (job->inverse) {
+        exec_irfft_batch(plan, nb,
+            &((const udsp_complex_t *) job->in)[b * job->id],
+            job->is, job->id,
+            &((float *) job->out)[b * job->od], job->os, job->od);
+    } else {
+        exec_rfft_batch(plan, nb,
+            &((const float *) job->in)[b * job->id], job->is, job->id,
+            &((udsp_complex_t *) job->out)[b * job->od],
+            job->os, job->od);
     }
+    return;
+}
 
+static void
+pool_fft(udsp_pool_t *pool, struct pool_fft_job *job)
+{
+    size_t i, count;
+    assert(job->plan->batch > 0);
+    count = (job->howmany + job->plan->batch - 1) / job->plan->batch;
+    if (pool_plans(pool, job->plan)) {
+        pool_run(pool, &pool_fft_item, job, count);
+    } else {
+        for (i = 0; i < count; i++) {
+            pool_fft_item(job, i, 0);
+        }
+    }
     return;
 }
 
-CONV_FAMILY_PROTO(udsp_conv)
+void
+udsp_pool_execute_r2c_batch(udsp_pool_t *pool, udsp_plan_t *plan,
+    const size_t howmany,
+    const float *restrict x, const size_t istride, const size_t idist,
+    udsp_complex_t *restrict y, const size_t ostride, const size_t odist)
 {
-    assert(st != NULL);
+    struct pool_fft_job job;
+    assert(pool != NULL);
+    assert(plan != NULL);
     assert(x != NULL);
-    assert(m > 0);
-    assert(m < UDSP_FFT_SIZE_MAX);
-    assert(n > 0);
-    assert(n < UDSP_FFT_SIZE_MAX);
-    assert(result != NULL);
-    conv(st, x, m, y, n, result,
-        (const conv_step_t [][CONV_STEPS_MAX]) {
-            [CONV_PRE_FFT] = {NULL},
-            [CONV_POST_FFT] = {NULL},
-            [CONV_PRE_IFFT] = {NULL},
-            [CONV_POST_IFFT] = {NULL},
-        }
-    );
+    assert(y != NULL);
+    assert(istride > 0);
+    assert(ostride > 0);
+    job.pool = pool;
+    job.plan = plan;
+    job.inverse = 0;
+    job.howmany = howmany;
+    job.in = x;
+    job.is = istride;
+    job.id = idist;
+    job.out = y;
+    job.os = ostride;
+    job.od = odist;
+    pool_fft(pool, &job);
+    return;
+}
+
+void
+udsp_pool_execute_c2r_batch(udsp_pool_t *pool, udsp_plan_t *plan,
+    const size_t howmany,
+    const udsp_complex_t *restrict y, const size_t istride,
+    const size_t idist,
+    float *restrict x, const size_t ostride, const size_t odist)
+{
+    struct pool_fft_job job;
+    assert(pool != NULL);
+    assert(plan != NULL);
+    assert(y != NULL);
+    assert(x != NULL);
+    assert(istride > 0);
+    assert(ostride > 0);
+    job.pool = pool;
+    job.plan = plan;
+    job.inverse = 1;
+    job.howmany = howmany;
+    job.in = y;
+    job.is = istride;
+    job.id = idist;
+    job.out = x;
+    job.os = ostride;
+    job.od = odist;
+    pool_fft(pool, &job);
     return;
 }
 
 /*
- * Cross-covariance
+ * A large native transform is computed by one plan, with its chunks
+ * spread over the pool;  any other is computed by the calling thread.
  */
-
-static
-CONV_FAMILY_PROTO(time_domain_reverse)
+static float *
+pool_large_scratch(udsp_pool_t *pool, const struct udsp_plan *plan)
 {
-    assert(st != NULL);
-    assert(st[1].fft_state.rbuf != NULL);
-    assert(n > 0);
-    assert(n < UDSP_FFT_SIZE_MAX);
-    (void) x;
-    (void) y;
-    (void) m;
-    (void) result;
-    reverse_real(st[1].fft_state.rbuf, n);
-    return;
+    size_t size;
+    assert(plan->kind == PLAN_REAL);
+    if (plan->method != UDSP_FFT_NATIVE) {
+        return NULL;
+    }
+    size = fftn_large_size(plan->size);
+    if (size == 0) {
+        return NULL;
+    }
+    return pool_buffer(pool, udsp_pool_threads(pool) * size);
 }
 
-static
-CONV_FAMILY_PROTO(time_domain_normalize)
+void
+udsp_pool_execute_r2c(udsp_pool_t *pool, udsp_plan_t *plan,
+    const float *x, udsp_complex_t *y)
 {
-    assert(st != NULL);
-    assert(st[0].fft_state.rbuf != NULL);
-    assert(m > 0);
-    assert(m < UDSP_FFT_SIZE_MAX);
-    assert(n > 0);
-    assert(n < UDSP_FFT_SIZE_MAX);
-    (void) x;
-    (void) y;
-    (void) result;
-    normalize_real(st[0].fft_state.rbuf, st[0].fft_state.size,
-        max(m, n));
+    float *scratch;
+    assert(pool != NULL);
+    assert(plan != NULL);
+    assert(x != NULL);
+    assert(y != NULL);
+    scratch = pool_large_scratch(pool, plan);
+    if (scratch == NULL) {
+        exec_rfft(plan, x, y);
+        return;
+    }
+    fftn_forward_pool(plan->size, plan->weights, x, y, plan->work,
+        pool, scratch);
     return;
 }
 
-CONV_FAMILY_PROTO(udsp_xcov)
+void
+udsp_pool_execute_c2r(udsp_pool_t *pool, udsp_plan_t *plan,
+    const udsp_complex_t *y, float *x)
 {
-    assert(st != NULL);
+    float *scratch;
+    assert(pool != NULL);
+    assert(plan != NULL);
+    assert(y != NULL);
     assert(x != NULL);
-    assert(m > 0);
-    assert(m < UDSP_FFT_SIZE_MAX);
-    assert(n > 0);
-    assert(n < UDSP_FFT_SIZE_MAX);
-    assert(result != NULL);
-    conv(st, x, m, y, n, result,
-        (const conv_step_t [][CONV_STEPS_MAX]) {
-            [CONV_PRE_FFT] = {
-                &time_domain_reverse,
-                NULL
-            },
-            [CONV_POST_FFT] = {NULL},
-            [CONV_PRE_IFFT] = {NULL},
-            [CONV_POST_IFFT] = {
-                &time_domain_normalize,
-                NULL
-            },
-        }
-    );
+    scratch = pool_large_scratch(pool, plan);
+    if (scratch == NULL) {
+        exec_irfft(plan, y, x);
+        return;
+    }
+    fftn_backward_pool(plan->size, plan->weights, y, x, plan->work,
+        pool, scratch);
     return;
 }
 
 /*
- * Cross-correlation
+ * Allocate the states of the workers, in order, and return how many
+ * have them.  They are zeroed so that no transform plan is found in
+ * them.
  */
-
-static inline void
-demean_real(float *restrict x, const size_t n)
+static size_t
+pool_states(udsp_pool_t *pool)
 {
-    float mean;
-    size_t i;
-    mean = flt_div(flt_sum(x, n), (float) n);
-    for (i = 0; i < n; i++) {
-        x[i] = flt_add(x[i], -mean);
+    void **slot;
+    size_t w;
+    for (w = 0; w < udsp_pool_threads(pool); w++) {
+        slot = pool_scratch(pool, w, POOL_SLOT_STATE);
+        if (*slot == NULL) {
+            *slot = calloc(2, sizeof(udsp_state_t));
+            if (*slot == NULL) {
+                break;
+            }
+        }
     }
-    return;
+    return w;
 }
 
-static
-CONV_FAMILY_PROTO(time_domain_demean)
+static void
+pool_conv_item(void *arg, const size_t i, const size_t w)
 {
-    assert(st != NULL);
-    assert(m > 0);
-    assert(m < UDSP_FFT_SIZE_MAX);
-    assert(n > 0);
-    assert(n < UDSP_FFT_SIZE_MAX);
-    (void) x;
-    (void) y;
-    (void) result;
-    demean_real(st[0].fft_state.rbuf, m);
-    demean_real(st[1].fft_state.rbuf, n);
+    struct pool_conv_job *job = arg;
+    udsp_state_t *st;
+    st = *pool_scratch(job->pool, w, POOL_SLOT_STATE);
+    (*job->op)(st, &(job->x[i * job->xd]), job->m,
+        &(job->y[i * job->yd]), job->n, &(job->result[i * job->rd]));
     return;
 }
 
-CONV_FAMILY_PROTO(udsp_xcor)
+/*
+ * If only the calling thread has its states, the job is run on it
+ * alone;  if it has none, nothing is computed and zero is returned.
+ */
+static int
+pool_conv(udsp_pool_t *pool, const conv_step_t op, const size_t howmany,
+    const float *restrict x, const size_t m, const size_t xd,
+    const float *restrict y, const size_t n, const size_t yd,
+    float *restrict result, const size_t rd)
 {
-    conv(st, x, m, y, n, result,
-        (const conv_step_t [][CONV_STEPS_MAX]) {
-            [CONV_PRE_FFT] = {
-                &time_domain_demean,
-                &time_domain_reverse,
-                NULL
-            },
-            [CONV_POST_FFT] = {NULL},
-            [CONV_PRE_IFFT] = {NULL},
-            [CONV_POST_IFFT] = {
-                &time_domain_normalize,
-                NULL
-            },
-        }
-    );
-    return;
+    struct pool_conv_job job;
+    size_t i, count;
+    assert(pool != NULL);
+    assert(x != NULL);
+    assert(y != NULL);
+    assert(result != NULL);
+    job.pool = pool;
+    job.op = op;
+    job.x = x;
+    job.m = m;
+    job.xd = xd;
+    job.y = y;
+    job.n = n;
+    job.yd = yd;
+    job.result = result;
+    job.rd = rd;
+    count = pool_states(pool);
+    if (count == 0) {
+        return 0;
+    }
+    if (count == udsp_pool_threads(pool)) {
+        pool_run(pool, &pool_conv_item, &job, howmany);
+        return 1;
+    }
+    for (i = 0; i < howmany; i++) {
+        pool_conv_item(&job, i, 0);
+    }
+    return 1;
 }
 
+#define CONV_FAMILY_POOL(NAME, OP)                                  \
+        int                                                         \
+        NAME(udsp_pool_t *pool, const size_t howmany,               \
+            const float *restrict x, const size_t m, const size_t xd, \
+            const float *restrict y, const size_t n, const size_t yd, \
+            float *restrict result, const size_t rd)                \
+        {                                                           \
+            return pool_conv(pool, &OP, howmany, x, m, xd, y, n, yd, \
+                result, rd);                                        \
+        }
+
+CONV_FAMILY_POOL(udsp_pool_conv, udsp_conv)
+CONV_FAMILY_POOL(udsp_pool_xcov, udsp_xcov)
+CONV_FAMILY_POOL(udsp_pool_xcor, udsp_xcor)
+
+#undef CONV_FAMILY_POOL
+
 /*
- * Periodogram
+ * The items of a pooled Welch estimate are its batches of segments.
+ * The calling thread uses the estimator's plan and buffers;  the other
+ * workers, their own plans and a part of the pool's buffer, which also
+ * holds the partial sums of every batch.
  */
 
-static void
-square_complex(udsp_complex_t *result, const udsp_complex_t *x)
+struct pool_welch_job {
+    udsp_pool_t *pool;
+    struct udsp_welch *welch;
+    const float *x;
+    size_t n;
+    float *buffer;
+    float *partials;
+};
+
+static size_t
+welch_worker_size(const struct udsp_welch *welch)
 {
-    float a, b;
-    a = x->real;
-    b = x->imag;
-    result->real = flt_add(flt_mul(a, a), flt_mul(b, b));
-    result->imag = 0.f;
-    return;
+    size_t l;
+    l = welch->plan->size;
+    return welch->plan->batch * (l + 2 * half_size(l));
 }
 
-static inline void
-fft_square(struct _udsp_fft_state *restrict st)
+static void
+pool_welch_item(void *arg, const size_t i, const size_t w)
 {
-    size_t i;
-    assert(st != NULL);
-    assert(st->size > 0);
-    assert(st->size < UDSP_FFT_SIZE_MAX);
-    for (i = 0; i < st->size; i++) {
-        square_complex(&(st->cbuf[i]), &(st->cbuf[i]));
+    struct pool_welch_job *job = arg;
+    struct udsp_welch *welch;
+    struct udsp_plan *plan;
+    float *segments;
+    udsp_complex_t *spectra;
+    welch = job->welch;
+    plan = welch->plan;
+    segments = welch->segments;
+    spectra = welch->spectra;
+    if (w > 0) {
+        plan = *pool_scratch(job->pool, w, POOL_SLOT_PLAN);
+        segments = &(job->buffer[(w - 1) * welch_worker_size(welch)]);
+        spectra = (udsp_complex_t *)
+            &segments[welch->plan->batch * welch->plan->size];
     }
+    welch_batch(welch, plan, job->x, job->n, i, segments, spectra,
+        &(job->partials[i * half_size(welch->plan->size)]));
     return;
 }
 
 void
-udsp_pow(udsp_state_t *st,
-    const float *restrict x, const size_t n,
-    float *restrict result)
+udsp_pool_welch(udsp_pool_t *pool, udsp_welch_t *welch,
+    const float *restrict x, const size_t n, float *restrict result)
 {
-    size_t i;
-    float pow_max;
-
-    assert(st != NULL);
+    const int fast = (UDSP_ARITH_DEFAULT == UDSP_ARITH_FAST);
+    struct pool_welch_job job;
+    size_t i, h, count, size;
+    assert(pool != NULL);
+    assert(welch != NULL);
     assert(x != NULL);
     assert(n > 0);
-    assert(n < UDSP_FFT_SIZE_MAX);
+    assert(result != NULL);
+    h = half_size(welch->plan->size);
+    count = welch_batches(welch, n);
+    size = (udsp_pool_threads(pool) - 1) * welch_worker_size(welch);
+    job.buffer = NULL;
+    if (count > 1 && pool_plans(pool, welch->plan)) {
+        job.buffer = pool_buffer(pool, size + count * h);
+    }
+    if (job.buffer == NULL) {
+        udsp_welch(welch, x, n, result);
+        return;
+    }
+    job.pool = pool;
+    job.welch = welch;
+    job.x = x;
+    job.n = n;
+    job.partials = &(job.buffer[size]);
+    pool_run(pool, &pool_welch_item, &job, count);
+    zero_real(result, h);
+    for (i = 0; i < count; i++) {
+        add_real(fast, result, &(job.partials[i * h]), h);
+    }
+    welch_finish(welch, n, result);
+    return;
+}
 
-    fft_init(st, UDSP_FFT_DEFAULT, n, x, n);
-    udsp_fft(st, NULL, 0, NULL);
-    fft_square(&(st->fft_state));
-    pow_max = st->fft_state.cbuf[0].real;
-    normalize_real((float *) st->fft_state.cbuf, 2 * n, pow_max);
+/*
+ * A pooled correlation matrix transforms the channels, then the pairs,
+ * as two jobs.  The calling thread uses the matrix's plan and buffer;
+ * the other workers, their own plans and a part of the pool's buffer.
+ */
 
-    if (result != NULL) {
-        for (i = 0; i < n; i++) {
-            result[i] = st->fft_state.cbuf[i].real;
-        }
+struct pool_xcor_matrix_job {
+    udsp_pool_t *pool;
+    struct udsp_xcor_matrix *xm;
+    const float *x;
+    size_t xd;
+    int upper;
+    float *result;
+    size_t rd;
+    float *buffer;
+};
+
+static void
+pool_xcor_matrix_worker(const struct pool_xcor_matrix_job *job,
+    const size_t w, struct udsp_plan **plan, udsp_complex_t **work)
+{
+    *plan = job->xm->plan;
+    *work = job->xm->work;
+    if (w > 0) {
+        *plan = *pool_scratch(job->pool, w, POOL_SLOT_PLAN);
+        *work = (udsp_complex_t *) &(job->buffer[(w - 1)
+            * 2 * half_size(job->xm->plan->size)]);
     }
+    return;
+}
+
+static void
+pool_xcor_matrix_forward(void *arg, const size_t i, const size_t w)
+{
+    struct pool_xcor_matrix_job *job = arg;
+    struct udsp_plan *plan;
+    udsp_complex_t *work;
+    pool_xcor_matrix_worker(job, w, &plan, &work);
+    xcor_matrix_forward(job->xm, plan, work, &(job->x[i * job->xd]), i);
+    return;
+}
+
+static void
+pool_xcor_matrix_inverse(void *arg, const size_t k, const size_t w)
+{
+    struct pool_xcor_matrix_job *job = arg;
+    struct udsp_plan *plan;
+    udsp_complex_t *work;
+    size_t i, j;
+    pool_xcor_matrix_worker(job, w, &plan, &work);
+    xcor_matrix_pair(job->xm, job->upper, k, &i, &j);
+    xcor_matrix_inverse(job->xm, plan, work, i, j,
+        &(job->result[k * job->rd]));
+    return;
+}
 
+void
+udsp_pool_xcor_matrix(udsp_pool_t *pool, udsp_xcor_matrix_t *xm,
+    const float *restrict x, const size_t xd, const int upper,
+    float *restrict result, const size_t rd)
+{
+    struct pool_xcor_matrix_job job;
+    size_t size;
+    assert(pool != NULL);
+    assert(xm != NULL);
+    assert(x != NULL);
+    assert(xd >= xm->n);
+    assert(result != NULL);
+    assert(rd >= 2 * xm->n - 1);
+    size = (udsp_pool_threads(pool) - 1) * 2 * half_size(xm->plan->size);
+    job.buffer = NULL;
+    if (pool_plans(pool, xm->plan)) {
+        job.buffer = pool_buffer(pool, max(size, 1));
+    }
+    if (job.buffer == NULL) {
+        udsp_xcor_matrix(xm, x, xd, upper, result, rd);
+        return;
+    }
+    job.pool = pool;
+    job.xm = xm;
+    job.x = x;
+    job.xd = xd;
+    job.upper = upper;
+    job.result = result;
+    job.rd = rd;
+    pool_run(pool, &pool_xcor_matrix_forward, &job, xm->channels);
+    pool_run(pool, &pool_xcor_matrix_inverse, &job,
+        udsp_xcor_matrix_pairs(xm, upper));
     return;
 }
@@ -17,6 +17,7 @@
 #define UDSP_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 struct udsp_complex {
     float real;
@@ -25,16 +26,46 @@ struct udsp_complex {
 
 typedef struct udsp_complex udsp_complex_t;
 
+struct udsp_complex_d {
+    double real;
+    double imag;
+};
+
+typedef struct udsp_complex_d udsp_complex_d_t;
+
 #if !defined(UDSP_FFT_SIZE_MAX)
 #define UDSP_FFT_SIZE_MAX (64 * 1024)
 #endif
 
+#define UDSP_PROFILE_PRE_FFT 0
+#define UDSP_PROFILE_FFT 1
+#define UDSP_PROFILE_POST_FFT 2
+#define UDSP_PROFILE_MUL 3
+#define UDSP_PROFILE_PRE_IFFT 4
+#define UDSP_PROFILE_IFFT 5
+#define UDSP_PROFILE_POST_IFFT 6
+#define UDSP_PROFILE_DIRECT 7
+#define UDSP_PROFILE_STAGES 8
+
+struct udsp_profile {
+    uint64_t ns[UDSP_PROFILE_STAGES];
+    uint64_t calls[UDSP_PROFILE_STAGES];
+    uint64_t convs;
+    uint64_t twiddle_hits;
+    uint64_t twiddle_misses;
+    uint64_t bytes_copied;
+};
+
+typedef struct udsp_profile udsp_profile_t;
+
 struct _udsp_fft_state {
-    float weights[2 * UDSP_FFT_SIZE_MAX + 16];
+    const float *weights;
     float rbuf[2 * UDSP_FFT_SIZE_MAX];
     udsp_complex_t cbuf[2 * UDSP_FFT_SIZE_MAX];
     size_t size;
     int method;
+    int arith;
+    struct udsp_profile profile;
 };
 
 struct udsp_state {
@@ -44,36 +75,308 @@ struct udsp_state {
 
 typedef struct udsp_state udsp_state_t;
 
+struct _udsp_fft_state_d {
+    const double *weights;
+    double rbuf[2 * UDSP_FFT_SIZE_MAX];
+    udsp_complex_d_t cbuf[2 * UDSP_FFT_SIZE_MAX];
+    size_t size;
+    int method;
+};
+
+struct udsp_state_d {
+    struct _udsp_fft_state_d fft_state;
+    char pad[64 - sizeof(struct _udsp_fft_state_d) % 64];
+};
+
+typedef struct udsp_state_d udsp_state_d_t;
+
+typedef struct udsp_plan udsp_plan_t;
+
 #define UDSP_FFT_FFTPACK 1
+#define UDSP_FFT_NATIVE 2
+
+#define UDSP_ARITH_SATURATE 1
+#define UDSP_ARITH_FAST 2
 
 size_t udsp_fft_max_size(void);
 
+size_t udsp_fft_fast_size(const size_t);
+
+size_t udsp_plan_size(const int, const size_t);
+
+udsp_plan_t *udsp_plan_create(const int, const size_t);
+
+udsp_plan_t *udsp_plan_create_batch(const int, const size_t, const size_t);
+
+udsp_plan_t *udsp_plan_create_complex(const int, const size_t);
+
+void udsp_plan_destroy(udsp_plan_t *);
+
+size_t udsp_plan_length(const udsp_plan_t *);
+
+void udsp_plan_fft(udsp_plan_t *restrict,
+    const float *restrict, const size_t, udsp_complex_t *restrict);
+
+void udsp_plan_ifft(udsp_plan_t *restrict,
+    const udsp_complex_t *restrict, const size_t, float *restrict);
+
+void udsp_plan_rfft(udsp_plan_t *restrict,
+    const float *restrict, const size_t, udsp_complex_t *restrict);
+
+void udsp_plan_irfft(udsp_plan_t *restrict,
+    const udsp_complex_t *restrict, const size_t, float *restrict);
+
+void udsp_plan_execute_r2c(udsp_plan_t *restrict,
+    const float *, udsp_complex_t *);
+
+void udsp_plan_execute_c2r(udsp_plan_t *restrict,
+    const udsp_complex_t *, float *);
+
+void udsp_plan_cfft(udsp_plan_t *restrict,
+    const udsp_complex_t *restrict, const size_t, udsp_complex_t *restrict);
+
+void udsp_plan_icfft(udsp_plan_t *restrict,
+    const udsp_complex_t *restrict, const size_t, udsp_complex_t *restrict);
+
+void udsp_plan_execute_r2c_batch(udsp_plan_t *restrict, const size_t,
+    const float *restrict, const size_t, const size_t,
+    udsp_complex_t *restrict, const size_t, const size_t);
+
+void udsp_plan_execute_c2r_batch(udsp_plan_t *restrict, const size_t,
+    const udsp_complex_t *restrict, const size_t, const size_t,
+    float *restrict, const size_t, const size_t);
+
 void udsp_fft_init(udsp_state_t *restrict,
     const int, const size_t);
 
+void udsp_set_arith(udsp_state_t *, const int);
+
+int udsp_profile_get(const udsp_state_t *, udsp_profile_t *);
+
+void udsp_profile_reset(udsp_state_t *);
+
 void udsp_fft(udsp_state_t *restrict,
     const float *restrict, const size_t, udsp_complex_t *restrict);
 
 void udsp_ifft(udsp_state_t *restrict,
     const udsp_complex_t *restrict, const size_t, float *restrict);
 
+void udsp_rfft(udsp_state_t *restrict,
+    const float *restrict, const size_t, udsp_complex_t *restrict);
+
+void udsp_irfft(udsp_state_t *restrict,
+    const udsp_complex_t *restrict, const size_t, float *restrict);
+
+void udsp_fft_s16(udsp_state_t *restrict,
+    const int16_t *restrict, const size_t, const float,
+    udsp_complex_t *restrict);
+
+void udsp_fft_s32(udsp_state_t *restrict,
+    const int32_t *restrict, const size_t, const float,
+    udsp_complex_t *restrict);
+
+void udsp_rfft_s16(udsp_state_t *restrict,
+    const int16_t *restrict, const size_t, const float,
+    udsp_complex_t *restrict);
+
+void udsp_rfft_s32(udsp_state_t *restrict,
+    const int32_t *restrict, const size_t, const float,
+    udsp_complex_t *restrict);
+
+void udsp_ifft_s16(udsp_state_t *restrict,
+    const udsp_complex_t *restrict, const size_t, const float,
+    int16_t *restrict);
+
+void udsp_cfft(udsp_state_t *restrict,
+    const udsp_complex_t *restrict, const size_t, udsp_complex_t *restrict);
+
+void udsp_icfft(udsp_state_t *restrict,
+    const udsp_complex_t *restrict, const size_t, udsp_complex_t *restrict);
+
+void udsp_dct(udsp_state_t *restrict, const int,
+    const float *restrict, const size_t, float *restrict);
+
+void udsp_dst(udsp_state_t *restrict, const int,
+    const float *restrict, const size_t, float *restrict);
+
 void udsp_fft_shift(udsp_complex_t *restrict, const size_t);
 
 void udsp_ifft_shift(udsp_complex_t *restrict, const size_t);
 
-#define CONV_FAMILY_DECL(NAME)                      \
+#define CONV_FAMILY_DECL(NAME, STATE, REAL)         \
+        void NAME(STATE *restrict,                  \
+            const REAL *restrict, const size_t,     \
+            const REAL *restrict, const size_t,     \
+            REAL *restrict);
+
+CONV_FAMILY_DECL(udsp_conv, udsp_state_t, float)
+CONV_FAMILY_DECL(udsp_xcov, udsp_state_t, float)
+CONV_FAMILY_DECL(udsp_xcor, udsp_state_t, float)
+CONV_FAMILY_DECL(udsp_nxcor, udsp_state_t, float)
+CONV_FAMILY_DECL(udsp_conv_d, udsp_state_d_t, double)
+CONV_FAMILY_DECL(udsp_xcov_d, udsp_state_d_t, double)
+CONV_FAMILY_DECL(udsp_xcor_d, udsp_state_d_t, double)
+
+#undef CONV_FAMILY_DECL
+
+#define CONV_LAGS_DECL(NAME)                        \
         void NAME(udsp_state_t *restrict,           \
             const float *restrict, const size_t,    \
             const float *restrict, const size_t,    \
-            float *restrict);
+            const size_t, float *restrict);
 
-CONV_FAMILY_DECL(udsp_conv)
-CONV_FAMILY_DECL(udsp_xcov)
-CONV_FAMILY_DECL(udsp_xcor)
+CONV_LAGS_DECL(udsp_xcov_lags)
+CONV_LAGS_DECL(udsp_xcor_lags)
 
-#undef CONV_FAMILY_DECL
+#undef CONV_LAGS_DECL
 
 void udsp_pow(udsp_state_t *,
     const float *restrict, const size_t, float *restrict);
 
+void udsp_fft_init_d(udsp_state_d_t *restrict,
+    const int, const size_t);
+
+void udsp_fft_d(udsp_state_d_t *restrict,
+    const double *restrict, const size_t, udsp_complex_d_t *restrict);
+
+void udsp_ifft_d(udsp_state_d_t *restrict,
+    const udsp_complex_d_t *restrict, const size_t, double *restrict);
+
+void udsp_pow_d(udsp_state_d_t *,
+    const double *restrict, const size_t, double *restrict);
+
+typedef struct udsp_welch udsp_welch_t;
+
+#define UDSP_WINDOW_RECT 1
+#define UDSP_WINDOW_HANN 2
+#define UDSP_WINDOW_HAMMING 3
+#define UDSP_WINDOW_BLACKMAN 4
+
+#define UDSP_WELCH_ONESIDED 1
+#define UDSP_WELCH_TWOSIDED 2
+
+#define UDSP_WELCH_DENSITY 1
+#define UDSP_WELCH_SPECTRUM 2
+
+udsp_welch_t *udsp_welch_create(const int, const size_t, const size_t,
+    const int, const int, const int);
+
+void udsp_welch_destroy(udsp_welch_t *);
+
+size_t udsp_welch_length(const udsp_welch_t *);
+
+void udsp_welch(udsp_welch_t *restrict,
+    const float *restrict, const size_t, float *restrict);
+
+typedef struct udsp_xcor_matrix udsp_xcor_matrix_t;
+
+udsp_xcor_matrix_t *udsp_xcor_matrix_create(const int, const size_t,
+    const size_t);
+
+void udsp_xcor_matrix_destroy(udsp_xcor_matrix_t *);
+
+size_t udsp_xcor_matrix_pairs(const udsp_xcor_matrix_t *, const int);
+
+void udsp_xcor_matrix(udsp_xcor_matrix_t *restrict,
+    const float *restrict, const size_t, const int,
+    float *restrict, const size_t);
+
+typedef struct udsp_convolver udsp_convolver_t;
+
+udsp_convolver_t *udsp_convolver_create(const int,
+    const float *restrict, const size_t, const size_t);
+
+void udsp_convolver_destroy(udsp_convolver_t *);
+
+size_t udsp_convolver_latency(const udsp_convolver_t *);
+
+void udsp_convolver_reset(udsp_convolver_t *);
+
+void udsp_convolver_process(udsp_convolver_t *restrict,
+    const float *restrict, const size_t, float *restrict);
+
+typedef struct udsp_stft udsp_stft_t;
+
+#define UDSP_STFT_COMPLEX 1
+#define UDSP_STFT_MAGNITUDE 2
+#define UDSP_STFT_POWER 3
+
+udsp_stft_t *udsp_stft_create(const int, const size_t, const size_t,
+    const int);
+
+udsp_stft_t *udsp_istft_create(const int, const size_t, const size_t,
+    const int);
+
+void udsp_stft_destroy(udsp_stft_t *);
+
+void udsp_stft_reset(udsp_stft_t *);
+
+size_t udsp_stft_frames(const udsp_stft_t *, const size_t);
+
+size_t udsp_stft_process(udsp_stft_t *restrict,
+    const float *restrict, const size_t, const int, void *restrict);
+
+void udsp_istft_process(udsp_stft_t *restrict,
+    const udsp_complex_t *restrict, const size_t, float *restrict);
+
+void udsp_goertzel(const float *restrict, const size_t,
+    const float *restrict, const size_t, udsp_complex_t *restrict);
+
+typedef struct udsp_sdft udsp_sdft_t;
+
+udsp_sdft_t *udsp_sdft_create(const size_t, const size_t *restrict,
+    const size_t);
+
+void udsp_sdft_destroy(udsp_sdft_t *);
+
+void udsp_sdft_reset(udsp_sdft_t *);
+
+void udsp_sdft_get(const udsp_sdft_t *restrict, udsp_complex_t *restrict);
+
+void udsp_sdft_process(udsp_sdft_t *restrict,
+    const float *restrict, const size_t, udsp_complex_t *restrict);
+
+typedef struct udsp_pool udsp_pool_t;
+
+udsp_pool_t *udsp_pool_create(const size_t);
+
+void udsp_pool_destroy(udsp_pool_t *);
+
+size_t udsp_pool_threads(const udsp_pool_t *);
+
+void udsp_pool_execute_r2c(udsp_pool_t *, udsp_plan_t *,
+    const float *, udsp_complex_t *);
+
+void udsp_pool_execute_c2r(udsp_pool_t *, udsp_plan_t *,
+    const udsp_complex_t *, float *);
+
+void udsp_pool_execute_r2c_batch(udsp_pool_t *, udsp_plan_t *,
+    const size_t,
+    const float *restrict, const size_t, const size_t,
+    udsp_complex_t *restrict, const size_t, const size_t);
+
+void udsp_pool_execute_c2r_batch(udsp_pool_t *, udsp_plan_t *,
+    const size_t,
+    const udsp_complex_t *restrict, const size_t, const size_t,
+    float *restrict, const size_t, const size_t);
+
+#define CONV_FAMILY_POOL_DECL(NAME)                             \
+        int NAME(udsp_pool_t *, const size_t,                   \
+            const float *restrict, const size_t, const size_t,  \
+            const float *restrict, const size_t, const size_t,  \
+            float *restrict, const size_t);
+
+CONV_FAMILY_POOL_DECL(udsp_pool_conv)
+CONV_FAMILY_POOL_DECL(udsp_pool_xcov)
+CONV_FAMILY_POOL_DECL(udsp_pool_xcor)
+
+#undef CONV_FAMILY_POOL_DECL
+
+void udsp_pool_welch(udsp_pool_t *, udsp_welch_t *,
+    const float *restrict, const size_t, float *restrict);
+
+void udsp_pool_xcor_matrix(udsp_pool_t *, udsp_xcor_matrix_t *,
+    const float *restrict, const size_t, const int,
+    float *restrict, const size_t);
+
 #endif